@@ -3,7 +3,8 @@ mkdir -p opk
 cp build/enigmistica opk
 cp opendingux/default.gcw0.desktop opk
 cp opendingux/icon.png opk
-cp ../projects/msvc2017/Crosswords/chess.png opk
-cp ../projects/msvc2017/Crosswords/font.png opk
+# sprites are decoded and packed on the host, the game mmaps the result instead of decoding PNGs
+${HOSTCXX:-c++} -std=c++11 -O2 -I../src ../tools/assetpack.cpp -lz -o build/assetpack || exit 1
+build/assetpack --format argb8888 opk/assets.bin ../projects/msvc2017/Crosswords/font.png ../projects/msvc2017/Crosswords/chess.png ../projects/msvc2017/Crosswords/checkers.png || exit 1
 mksquashfs opk enigmistica.opk -all-root -noappend -no-exports -no-xattrs -no-progress > /dev/null
 # rm -rf opk
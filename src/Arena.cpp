@@ -0,0 +1,41 @@
+#include "Arena.h"
+
+#include <cstdlib>
+#include <new>
+
+/* the global operators are replaced only to count, the memory still comes from malloc;
+   each thread has its own count so that a frame isn't charged for the other threads */
+namespace
+{
+  thread_local u64 counter = 0;
+
+  void* counted(size_t size)
+  {
+    ++counter;
+    return malloc(size ? size : 1);
+  }
+}
+
+u64 heap::allocations() { return counter; }
+
+void* operator new(size_t size)
+{
+  if (void* p = counted(size))
+    return p;
+  throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+  if (void* p = counted(size))
+    return p;
+  throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return counted(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return counted(size); }
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { free(p); }
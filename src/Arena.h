@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Common.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/* bump allocator for data which lives until the end of a frame: allocating moves
+   a pointer, freeing does nothing and reset() drops everything at once; a frame
+   which needs more than the block spills into blocks of its own, which are merged
+   into a single larger block at the next reset, so once the size of a busy frame
+   is known the arena doesn't touch the heap anymore */
+class Arena
+{
+private:
+  std::unique_ptr<u8[]> _block;
+  size_t _capacity;
+  size_t _used;
+
+  std::vector<std::unique_ptr<u8[]>> _spills;
+  size_t _spilled;
+
+  size_t _peak;
+
+  void* spill(size_t size)
+  {
+    _spills.emplace_back(new u8[size]);
+    _spilled += size;
+    return _spills.back().get();
+  }
+
+public:
+  Arena(size_t capacity = 16 * 1024) : _block(new u8[capacity]), _capacity(capacity), _used(0), _spilled(0), _peak(0) { }
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  /* alignment up to that of new[], which aligns the block */
+  void* allocate(size_t size, size_t alignment)
+  {
+    const size_t offset = (_used + alignment - 1) & ~(alignment - 1);
+
+    if (offset + size > _capacity)
+      return spill(size);
+
+    _used = offset + size;
+    return _block.get() + offset;
+  }
+
+  void reset()
+  {
+    _peak = std::max(_peak, _used + _spilled);
+
+    if (_spilled)
+    {
+      /* with room for a slightly busier frame, alignment padding included */
+      _capacity = std::max(_capacity, _used + _spilled) * 2;
+      _block.reset(new u8[_capacity]);
+      _spills.clear();
+      _spilled = 0;
+    }
+
+    _used = 0;
+  }
+
+  size_t used() const { return _used + _spilled; }
+  size_t capacity() const { return _capacity; }
+  size_t peak() const { return _peak; }
+};
+
+/* with the full pre C++11 interface, which the string of older libstdc++ still wants */
+template<typename T>
+class ArenaAllocator
+{
+public:
+  using value_type = T;
+  using pointer = T*;
+  using const_pointer = const T*;
+  using reference = T&;
+  using const_reference = const T&;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+
+  template<typename U> struct rebind { using other = ArenaAllocator<U>; };
+
+  Arena* arena;
+
+  ArenaAllocator(Arena& arena) : arena(&arena) { }
+  template<typename U> ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) { }
+
+  T* allocate(size_t count, const void* = nullptr) { return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T))); }
+  void deallocate(T*, size_t) { }
+
+  size_t max_size() const { return size_t(-1) / sizeof(T); }
+
+  template<typename U, typename... Args> void construct(U* p, Args&&... args) { ::new(static_cast<void*>(p)) U(std::forward<Args>(args)...); }
+  template<typename U> void destroy(U* p) { p->~U(); }
+
+  template<typename U> bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+  template<typename U> bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+};
+
+/* transient render text, gone when the next frame starts */
+using frame_string = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+
+/* operator new calls made by the calling thread, see Arena.cpp; the steady state of a
+   frame should leave the count of the render thread unchanged, whatever the analysis
+   or the pool threads are doing meanwhile */
+namespace heap
+{
+  u64 allocations();
+}
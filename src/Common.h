@@ -1,13 +1,20 @@
 #pragma once
 
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <algorithm>
 #include <string>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 #define LOGD(x, ...) printf(x "\n", __VA_ARGS__)
 #define LOGDD(x) printf(x "\n")
 
 using u8 = uint8_t;
+using u16 = uint16_t;
 using u32 = uint32_t;
 using u64 = uint64_t;
 
@@ -16,6 +23,26 @@ using s32 = int32_t;
 using utf8_string = std::string;
 using utf8_char = std::string::value_type;
 
+inline u32 popcount(u64 value)
+{
+#if defined(_MSC_VER)
+  return static_cast<u32>(__popcnt64(value));
+#else
+  return static_cast<u32>(__builtin_popcountll(value));
+#endif
+}
+
+inline u32 countTrailingZeros(u64 value)
+{
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward64(&index, value);
+  return index;
+#else
+  return static_cast<u32>(__builtin_ctzll(value));
+#endif
+}
+
 template<typename T>
 struct bit_mask
 {
@@ -126,6 +153,7 @@ struct point_t
   point_t(coord_t x, coord_t y) : x(x), y(y) { }
 
   bool operator==(const point_t& o) const { return x == o.x && y == o.y; }
+  bool operator!=(const point_t& o) const { return !(*this == o); }
 
   point_t operator+(coord_t d) const { return { x + d, y + d }; }
   point_t operator+(const point_t& d) const { return { x + d.x, y + d.y }; }
@@ -163,6 +191,19 @@ struct rect_t
   coord_t y() const { return origin.y; }
   coord_t w() const { return size.w; }
   coord_t h() const { return size.h; }
+
+  bool isEmpty() const { return size.w <= 0 || size.h <= 0; }
+
+  /* smallest rect containing both, empty rects are ignored */
+  rect_t united(const rect_t& o) const
+  {
+    if (isEmpty()) return o;
+    else if (o.isEmpty()) return *this;
+
+    const coord_t x1 = std::min(x(), o.x()), y1 = std::min(y(), o.y());
+    const coord_t x2 = std::max(x() + w(), o.x() + o.w()), y2 = std::max(y() + h(), o.y() + o.h());
+    return rect_t(x1, y1, x2 - x1, y2 - y1);
+  }
 };
 
 struct color_t
@@ -171,6 +212,9 @@ struct color_t
 
   color_t(u8 r, u8 g, u8 b) : color_t(r, g, b, 255) { }
   color_t(u8 r, u8 g, u8 b, u8 a) : r(r), g(g), b(b), a(a) { }
+
+  bool operator==(const color_t& o) const { return r == o.r && g == o.g && b == o.b && a == o.a; }
+  bool operator!=(const color_t& o) const { return !(*this == o); }
 };
 
 using path = std::string;
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Common.h"
+
+#if _WIN32
+#include <fstream>
+#include <vector>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* read only view of a whole file, mmapped where the platform allows it */
+class MappedFile
+{
+private:
+  const u8* _data;
+  size_t _size;
+
+#if _WIN32
+  std::vector<u8> _buffer;
+#endif
+
+public:
+  MappedFile() : _data(nullptr), _size(0) { }
+  ~MappedFile() { close(); }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool open(const path& path)
+  {
+    close();
+
+#if _WIN32
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in)
+      return false;
+
+    _buffer.resize(static_cast<size_t>(in.tellg()));
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(_buffer.data()), _buffer.size());
+
+    _data = _buffer.data();
+    _size = _buffer.size();
+    return true;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+      ::close(fd);
+      return false;
+    }
+
+    void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (data == MAP_FAILED)
+      return false;
+
+    _data = static_cast<const u8*>(data);
+    _size = info.st_size;
+    return true;
+#endif
+  }
+
+  void close()
+  {
+#if _WIN32
+    _buffer.clear();
+#else
+    if (_data)
+      munmap(const_cast<u8*>(_data), _size);
+#endif
+    _data = nullptr;
+    _size = 0;
+  }
+
+  bool isOpen() const { return _data != nullptr; }
+
+  const u8* data() const { return _data; }
+  size_t size() const { return _size; }
+
+  template<typename T> const T* at(u64 offset) const { return reinterpret_cast<const T*>(_data + offset); }
+};
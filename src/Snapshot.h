@@ -0,0 +1,249 @@
+#pragma once
+
+#include "Common.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+#if !_WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/* the live state of the app, written when it's suspended or closed and read back
+   before the first frame; the payload is a flat sequence of tagged sections, each
+   owner writes its fields raw and checks sizes on the way back, so any change to
+   a layout has to bump VERSION */
+namespace snapshot
+{
+  constexpr u32 VERSION = 1;
+
+  /* enough for a long game of chess with its history */
+  constexpr size_t CAPACITY = 64 * 1024;
+
+  constexpr u32 tag(const char (&name)[5]) { return u32(name[0]) | (u32(name[1]) << 8) | (u32(name[2]) << 16) | (u32(name[3]) << 24); }
+
+  struct Header
+  {
+    char magic[4];
+    u32 version;
+    u32 size; // of the payload which follows
+    u32 checksum;
+  };
+
+  struct Section
+  {
+    u32 tag;
+    u32 size;
+  };
+
+  static_assert(sizeof(Header) == 16, "snapshot header layout");
+  static_assert(sizeof(Section) == 8, "snapshot section layout");
+
+  /* FNV-1a, just to tell a torn or foreign file apart */
+  inline u32 checksum(const u8* data, size_t size)
+  {
+    u32 hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i)
+      hash = (hash ^ data[i]) * 16777619u;
+    return hash;
+  }
+
+  /* into a buffer sized once, an overflow drops the whole snapshot instead of a part of it */
+  class Writer
+  {
+  private:
+    u8* _data;
+    size_t _capacity;
+    size_t _size;
+    bool _overflow;
+
+  public:
+    Writer(u8* data, size_t capacity) : _data(data), _capacity(capacity), _size(sizeof(Header)), _overflow(capacity < sizeof(Header)) { }
+
+    void raw(const void* data, size_t size)
+    {
+      if (_overflow || _capacity - _size < size)
+      {
+        _overflow = true;
+        return;
+      }
+
+      if (size)
+        memcpy(_data + _size, data, size);
+      _size += size;
+    }
+
+    template<typename T> void write(const T& value) { raw(&value, sizeof(T)); }
+
+    /* returns a mark for end() which patches the size in */
+    size_t begin(u32 tag)
+    {
+      const size_t mark = _size;
+      write(Section{ tag, 0 });
+      return mark;
+    }
+
+    void end(size_t mark)
+    {
+      if (!_overflow)
+      {
+        const u32 size = u32(_size - mark - sizeof(Section));
+        memcpy(_data + mark + offsetof(Section, size), &size, sizeof(size));
+      }
+    }
+
+    bool failed() const { return _overflow; }
+
+    /* fills the header in, the result is the whole file */
+    size_t finish()
+    {
+      if (_overflow)
+        return 0;
+
+      Header header = { { 'E', 'N', 'S', 'S' }, VERSION, u32(_size - sizeof(Header)), checksum(_data + sizeof(Header), _size - sizeof(Header)) };
+      memcpy(_data, &header, sizeof(Header));
+
+      return _size;
+    }
+  };
+
+  /* bounds checked, once it fails every read after fails too */
+  class Reader
+  {
+  private:
+    const u8* _it;
+    const u8* _end;
+    bool _failed;
+
+  public:
+    Reader() : _it(nullptr), _end(nullptr), _failed(true) { }
+    Reader(const u8* data, size_t size) : _it(data), _end(data + size), _failed(false) { }
+
+    bool raw(void* data, size_t size)
+    {
+      if (_failed || size_t(_end - _it) < size)
+        return !(_failed = true);
+
+      if (size)
+        memcpy(data, _it, size);
+      _it += size;
+      return true;
+    }
+
+    template<typename T> bool read(T& value) { return raw(&value, sizeof(T)); }
+
+    /* the content of the next section, skipped in this reader */
+    bool section(u32& tag, Reader& content)
+    {
+      Section section;
+
+      if (!read(section) || size_t(_end - _it) < section.size)
+        return !(_failed = true);
+
+      tag = section.tag;
+      content = Reader(_it, section.size);
+      _it += section.size;
+      return true;
+    }
+
+    bool eof() const { return _it == _end; }
+    bool failed() const { return _failed; }
+  };
+
+  /* fields read raw are checked before they are used: a bool is a single byte which
+     must be 0 or 1, an enum must be one of its values up to the last one */
+  inline bool isBool(const bool& value)
+  {
+    u8 byte;
+    memcpy(&byte, &value, sizeof(byte));
+    return byte <= 1;
+  }
+
+  template<typename E> bool inRange(E value, E last)
+  {
+    using U = typename std::underlying_type<E>::type;
+    return U(value) >= 0 && U(value) <= U(last);
+  }
+
+  /* the payload of a valid snapshot in file, a failed reader otherwise */
+  inline Reader open(const MappedFile& file)
+  {
+    Header header;
+
+    if (!file.isOpen() || file.size() < sizeof(Header))
+      return Reader();
+
+    memcpy(&header, file.data(), sizeof(Header));
+
+    const u8* payload = file.data() + sizeof(Header);
+
+    if (memcmp(header.magic, "ENSS", 4) != 0 || header.version != VERSION || header.size != file.size() - sizeof(Header) || header.checksum != checksum(payload, header.size))
+      return Reader();
+
+    return Reader(payload, header.size);
+  }
+
+  /* written aside and renamed over the previous one, so that power loss leaves either */
+  inline bool save(const path& file, const u8* data, size_t size)
+  {
+    const path temporary = file + ".tmp";
+
+#if _WIN32
+    FILE* out = fopen(temporary.c_str(), "wb");
+    if (!out)
+      return false;
+
+    const bool written = fwrite(data, 1, size, out) == size;
+
+    if (fclose(out) != 0 || !written)
+      return false;
+
+    remove(file.c_str());
+#else
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+      return false;
+
+    const bool written = ::write(fd, data, size) == ssize_t(size) && fsync(fd) == 0;
+
+    if (::close(fd) != 0 || !written)
+      return false;
+#endif
+
+    if (rename(temporary.c_str(), file.c_str()) != 0)
+      return false;
+
+#if !_WIN32
+    /* the rename is only durable once the directory which holds both names is synced too */
+    const size_t slash = file.rfind('/');
+    const path directory = slash == path::npos ? path(".") : file.substr(0, std::max<size_t>(slash, 1));
+
+    const int dir = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dir < 0)
+      return false;
+
+    const bool synced = fsync(dir) == 0;
+    ::close(dir);
+    return synced;
+#else
+    return true;
+#endif
+  }
+
+  /* next to the other dotfiles on the handheld, the installed data is read only */
+  inline path location()
+  {
+#if _WIN32
+    return "snapshot.bin";
+#else
+    const char* home = getenv("HOME");
+    return home ? path(home) + "/.enigmistica.snapshot" : path(".enigmistica.snapshot");
+#endif
+  }
+}
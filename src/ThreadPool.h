@@ -0,0 +1,174 @@
+#pragma once
+
+#include "Common.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* work-stealing pool: every worker owns a deque, pushes and pops at the back
+   and steals from the front of the others when its own deque runs dry */
+class ThreadPool
+{
+public:
+  using task_t = std::function<void()>;
+
+private:
+  struct Queue
+  {
+    std::mutex mutex;
+    std::deque<task_t> tasks;
+  };
+
+  std::vector<std::unique_ptr<Queue>> _queues;
+  std::vector<std::thread> _workers;
+
+  std::mutex _mutex;
+  std::condition_variable _wakeup;
+  std::condition_variable _idle;
+
+  std::atomic<size_t> _pending;
+  std::atomic<size_t> _queued;
+  std::atomic<size_t> _next;
+  bool _stopping;
+
+  struct Worker
+  {
+    const ThreadPool* pool;
+    size_t index;
+  };
+
+  static Worker& currentWorker()
+  {
+    static thread_local Worker worker = { nullptr, 0 };
+    return worker;
+  }
+
+  bool pop(size_t index, task_t& task)
+  {
+    Queue& own = *_queues[index];
+    {
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.tasks.empty())
+      {
+        task = std::move(own.tasks.back());
+        own.tasks.pop_back();
+        --_queued;
+        return true;
+      }
+    }
+
+    for (size_t i = 1; i < _queues.size(); ++i)
+    {
+      Queue& victim = *_queues[(index + i) % _queues.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.tasks.empty())
+      {
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        --_queued;
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  void work(size_t index)
+  {
+    currentWorker() = { this, index };
+
+    while (true)
+    {
+      task_t task;
+
+      if (pop(index, task))
+      {
+        task();
+
+        if (--_pending == 0)
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          _idle.notify_all();
+        }
+      }
+      else
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (_stopping)
+          return;
+        _wakeup.wait(lock, [this] { return _stopping || _queued > 0; });
+        if (_stopping && _queued == 0)
+          return;
+      }
+    }
+  }
+
+public:
+  ThreadPool(size_t threads = 0) : _pending(0), _queued(0), _next(0), _stopping(false)
+  {
+    if (threads == 0)
+      threads = hardwareThreads();
+
+    for (size_t i = 0; i < threads; ++i)
+      _queues.emplace_back(new Queue());
+
+    for (size_t i = 0; i < threads; ++i)
+      _workers.emplace_back(&ThreadPool::work, this, i);
+  }
+
+  ~ThreadPool()
+  {
+    wait();
+
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stopping = true;
+    }
+
+    _wakeup.notify_all();
+    for (auto& worker : _workers)
+      worker.join();
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  static size_t hardwareThreads()
+  {
+    size_t count = std::thread::hardware_concurrency();
+    return count ? count : 1;
+  }
+
+  size_t size() const { return _workers.size(); }
+
+  /* tasks submitted from a worker go to its own deque so that the subtree it
+     is splitting stays local until somebody idle steals it */
+  void submit(task_t task)
+  {
+    size_t index = currentWorker().pool == this ? currentWorker().index : _next++ % _queues.size();
+
+    ++_pending;
+    ++_queued;
+
+    {
+      std::lock_guard<std::mutex> lock(_queues[index]->mutex);
+      _queues[index]->tasks.push_back(std::move(task));
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _wakeup.notify_one();
+  }
+
+  /* must not be called from inside a task */
+  void wait()
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _idle.wait(lock, [this] { return _pending == 0; });
+  }
+};
@@ -0,0 +1,238 @@
+#pragma once
+
+#include "Common.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+/* scoped zones recorded into a ring per thread and written out as Chrome trace
+   JSON, which chrome://tracing and ui.perfetto.dev open; a zone costs two clock
+   reads and a store into memory only its own thread writes, no lock is taken
+   after the first zone of a thread. TRACE_ENABLED 0 compiles the zones out */
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+namespace trace
+{
+  using clock = std::chrono::steady_clock;
+
+  inline u64 now() { return u64(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now().time_since_epoch()).count()); }
+
+  struct Event
+  {
+    const char* name; // a literal, only the pointer is kept
+    u64 start; // ns
+    u32 duration; // ns, zones over 4 s are clamped
+  };
+
+  /* written by its thread only and read by whoever dumps the trace: each slot has
+     a sequence, odd while its thread writes the slot and then the index of the
+     event it holds; a reader keeps an event only if the sequence is the same before
+     and after copying it. Every field is a word sized atomic so that none of this
+     takes a lock on a 32 bit target, where 64 bit atomics would */
+  class Ring
+  {
+  public:
+    static constexpr u32 CAPACITY = 4096; // power of two, a few seconds of frames
+
+  private:
+    struct Slot
+    {
+      std::atomic<u32> sequence; // 2 * index + 1 while written, 2 * index + 2 once done
+      std::atomic<uintptr_t> name;
+      std::atomic<u32> startLow, startHigh;
+      std::atomic<u32> duration;
+    };
+
+    Slot _slots[CAPACITY];
+    std::atomic<u32> _written;
+    u32 _id;
+    char _name[16];
+
+  public:
+    Ring(u32 id) : _written(0), _id(id)
+    {
+      for (Slot& slot : _slots)
+        slot.sequence.store(0, std::memory_order_relaxed);
+      snprintf(_name, sizeof(_name), "thread %u", id);
+    }
+
+    void push(const char* name, u64 start, u64 end)
+    {
+      const u32 written = _written.load(std::memory_order_relaxed);
+      const u64 duration = end - start;
+      Slot& slot = _slots[written & (CAPACITY - 1)];
+
+      /* the slot is marked before any of it changes, a reader which sees a new field sees the mark too */
+      slot.sequence.store(2 * written + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+
+      slot.name.store(uintptr_t(name), std::memory_order_relaxed);
+      slot.startLow.store(u32(start), std::memory_order_relaxed);
+      slot.startHigh.store(u32(start >> 32), std::memory_order_relaxed);
+      slot.duration.store(duration < 0xFFFFFFFFu ? u32(duration) : 0xFFFFFFFFu, std::memory_order_relaxed);
+
+      slot.sequence.store(2 * written + 2, std::memory_order_release);
+      _written.store(written + 1, std::memory_order_release);
+    }
+
+    void setName(const char* name) { snprintf(_name, sizeof(_name), "%s", name); }
+
+    u32 id() const { return _id; }
+    const char* name() const { return _name; }
+
+    /* the events still in the ring, oldest first; those overwritten while copying are dropped */
+    void copy(std::vector<Event>& out) const
+    {
+      const u32 written = _written.load(std::memory_order_acquire);
+      const u32 count = std::min(written, u32(CAPACITY));
+
+      for (u32 i = written - count; i != written; ++i)
+      {
+        const Slot& slot = _slots[i & (CAPACITY - 1)];
+        const u32 sequence = slot.sequence.load(std::memory_order_acquire);
+
+        if (sequence != 2 * i + 2)
+          continue;
+
+        const Event event = {
+          reinterpret_cast<const char*>(slot.name.load(std::memory_order_relaxed)),
+          u64(slot.startLow.load(std::memory_order_relaxed)) | (u64(slot.startHigh.load(std::memory_order_relaxed)) << 32),
+          slot.duration.load(std::memory_order_relaxed)
+        };
+
+        /* the fields are read before the sequence is checked again */
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (slot.sequence.load(std::memory_order_relaxed) == sequence)
+          out.push_back(event);
+      }
+    }
+  };
+
+  /* rings are never freed so that threads which are gone still show up in the dump */
+  struct Registry
+  {
+    static constexpr u32 MAX_THREADS = 32;
+
+    std::atomic<Ring*> rings[MAX_THREADS];
+    std::atomic<u32> count;
+  };
+
+  inline Registry& registry()
+  {
+    static Registry registry;
+    return registry;
+  }
+
+  inline Ring* attach()
+  {
+    Registry& registry = trace::registry();
+    const u32 slot = registry.count.fetch_add(1);
+
+    /* past the limit a thread just isn't traced */
+    if (slot >= Registry::MAX_THREADS)
+      return nullptr;
+
+    Ring* ring = new Ring(slot);
+    registry.rings[slot].store(ring, std::memory_order_release);
+    return ring;
+  }
+
+  inline Ring* current()
+  {
+    static thread_local Ring* ring = attach();
+    return ring;
+  }
+
+  inline void setThreadName(const char* name)
+  {
+    if (Ring* ring = current())
+      ring->setName(name);
+  }
+
+  class Zone
+  {
+  private:
+    const char* _name;
+    u64 _start;
+
+  public:
+    Zone(const char* name) : _name(name), _start(now()) { }
+
+    ~Zone()
+    {
+      if (Ring* ring = current())
+        ring->push(_name, _start, now());
+    }
+
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+  };
+
+  /* safe while other threads keep tracing, their newest zones may just miss the dump */
+  inline bool write(const path& file)
+  {
+    FILE* out = fopen(file.c_str(), "wb");
+    if (!out)
+      return false;
+
+    Registry& registry = trace::registry();
+    const u32 threads = std::min(registry.count.load(), u32(Registry::MAX_THREADS));
+
+    std::vector<std::vector<Event>> events(threads);
+    u64 origin = ~u64(0);
+
+    for (u32 i = 0; i < threads; ++i)
+    {
+      if (const Ring* ring = registry.rings[i].load(std::memory_order_acquire))
+        ring->copy(events[i]);
+
+      for (const Event& event : events[i])
+        origin = std::min(origin, event.start);
+    }
+
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    bool first = true;
+    size_t total = 0;
+
+    for (u32 i = 0; i < threads; ++i)
+    {
+      const Ring* ring = registry.rings[i].load(std::memory_order_acquire);
+      if (!ring)
+        continue;
+
+      fprintf(out, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", ring->id(), ring->name());
+      first = false;
+
+      /* names are literals from the source, nothing in them needs escaping */
+      for (const Event& event : events[i])
+        fprintf(out, ",\n{\"ph\":\"X\",\"name\":\"%s\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", event.name, ring->id(), (event.start - origin) / 1000.0, event.duration / 1000.0);
+
+      total += events[i].size();
+    }
+
+    fprintf(out, "\n]}\n");
+
+    const bool written = !ferror(out);
+    if (fclose(out) != 0 || !written)
+      return false;
+
+    LOGD("trace: %u zones of %u threads written to %s", u32(total), threads, file.c_str());
+    return true;
+  }
+}
+
+#if TRACE_ENABLED
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_ZONE(name) trace::Zone TRACE_CONCAT(_traceZone, __LINE__)(name)
+#define TRACE_THREAD(name) trace::setThreadName(name)
+#else
+#define TRACE_ZONE(name) do { } while (0)
+#define TRACE_THREAD(name) do { } while (0)
+#endif
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Common.h"
+
+#include <vector>
+
+using unicode_t = u32;
+using unicode_string = std::vector<unicode_t>;
+
+namespace utf8
+{
+  constexpr unicode_t REPLACEMENT = 0xFFFD;
+
+  /* decodes the code point at it and moves past it, malformed input yields REPLACEMENT */
+  inline unicode_t next(const char*& it, const char* end)
+  {
+    const u8 lead = static_cast<u8>(*it++);
+
+    if (lead < 0x80)
+      return lead;
+
+    s32 extra;
+    unicode_t cp;
+
+    if ((lead & 0xE0) == 0xC0) { extra = 1; cp = lead & 0x1F; }
+    else if ((lead & 0xF0) == 0xE0) { extra = 2; cp = lead & 0x0F; }
+    else if ((lead & 0xF8) == 0xF0) { extra = 3; cp = lead & 0x07; }
+    else
+      return REPLACEMENT;
+
+    for (s32 i = 0; i < extra; ++i)
+    {
+      if (it == end || (static_cast<u8>(*it) & 0xC0) != 0x80)
+        return REPLACEMENT;
+      cp = (cp << 6) | (static_cast<u8>(*it++) & 0x3F);
+    }
+
+    return cp;
+  }
+
+  inline void decode(const utf8_string& text, unicode_string& out)
+  {
+    out.clear();
+
+    const char* it = text.data();
+    const char* end = it + text.size();
+
+    while (it != end)
+      out.push_back(next(it, end));
+  }
+
+  inline unicode_string decode(const utf8_string& text)
+  {
+    unicode_string out;
+    decode(text, out);
+    return out;
+  }
+
+  inline size_t length(const utf8_string& text)
+  {
+    size_t length = 0;
+    for (char c : text)
+      length += (static_cast<u8>(c) & 0xC0) != 0x80;
+    return length;
+  }
+
+  inline void append(utf8_string& out, unicode_t cp)
+  {
+    if (cp < 0x80)
+      out += char(cp);
+    else if (cp < 0x800)
+    {
+      out += char(0xC0 | (cp >> 6));
+      out += char(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000)
+    {
+      out += char(0xE0 | (cp >> 12));
+      out += char(0x80 | ((cp >> 6) & 0x3F));
+      out += char(0x80 | (cp & 0x3F));
+    }
+    else
+    {
+      out += char(0xF0 | (cp >> 18));
+      out += char(0x80 | ((cp >> 12) & 0x3F));
+      out += char(0x80 | ((cp >> 6) & 0x3F));
+      out += char(0x80 | (cp & 0x3F));
+    }
+  }
+}
+
+namespace unicode
+{
+  /* ASCII and Latin-1 only, which covers the letters used by the schemes */
+  inline unicode_t toLower(unicode_t cp)
+  {
+    if ((cp >= 'A' && cp <= 'Z') || (cp >= 0xC0 && cp <= 0xDE && cp != 0xD7))
+      return cp + 0x20;
+    return cp;
+  }
+
+  /* lowercase and strip the accent from Latin-1 letters, used to match text regardless of how it was typed */
+  inline unicode_t fold(unicode_t cp)
+  {
+    static const char latin1[] =
+      "aaaaaaaceeeeiiii" "dnooooo\0ouuuuyts"
+      "aaaaaaaceeeeiiii" "dnooooo\0ouuuuyty";
+
+    cp = toLower(cp);
+
+    if (cp >= 0xC0 && cp <= 0xFF && latin1[cp - 0xC0])
+      return static_cast<unicode_t>(latin1[cp - 0xC0]);
+
+    return cp;
+  }
+
+  inline bool isAlphanumeric(unicode_t cp)
+  {
+    return (cp >= 'a' && cp <= 'z') || (cp >= 'A' && cp <= 'Z') || (cp >= '0' && cp <= '9') || (cp >= 0xC0 && cp <= 0x24F && cp != 0xD7 && cp != 0xF7);
+  }
+}
@@ -0,0 +1,149 @@
+#include "CrosswordAssistant.h"
+
+#include <cmath>
+
+using namespace games;
+
+namespace
+{
+  /* the dictionary only has plain letters, anything else matches no word */
+  utf8_char dictionaryLetter(unicode_t letter)
+  {
+    if (letter == 0)
+      return Dictionary::EMPTY;
+    return letter < 0x80 ? utf8_char(letter) : '?';
+  }
+}
+
+void CrosswordAssistant::changed(Slot& slot, s32 length)
+{
+  slot.count = Dictionary::count(slot.candidates);
+  slot.support.resize(length * Dictionary::LETTERS);
+  slot.counted.assign(length, 0);
+}
+
+void CrosswordAssistant::match(const CrosswordGrid& grid, word_id id)
+{
+  const WordProgress& word = grid.word(id);
+
+  _pattern.resize(word.length);
+  for (s32 i = 0, index = word.first; i < word.length; ++i, index += word.step)
+    _pattern[i] = dictionaryLetter(grid.at(index).letter);
+
+  _dictionary.match(_pattern.data(), word.length, _slots[id].candidates);
+  changed(_slots[id], word.length);
+}
+
+void CrosswordAssistant::reset(const CrosswordGrid& grid)
+{
+  _slots.assign(grid.wordCount(), Slot());
+
+  for (word_id id = 0; id < _slots.size(); ++id)
+    match(grid, id);
+}
+
+void CrosswordAssistant::update(const CrosswordGrid& grid, s32 index, unicode_t previous)
+{
+  const CrosswordCell& cell = grid.at(index);
+
+  if (cell.letter == previous)
+    return;
+
+  for (word_id id : cell.words)
+  {
+    if (id == NO_WORD)
+      continue;
+
+    const WordProgress& word = grid.word(id);
+
+    if (previous == 0)
+    {
+      _dictionary.restrict(word.length, offset(word, index), dictionaryLetter(cell.letter), _slots[id].candidates);
+      changed(_slots[id], word.length);
+    }
+    else
+      match(grid, id);
+  }
+}
+
+const u32* CrosswordAssistant::support(word_id id, s32 length, s32 position)
+{
+  Slot& slot = _slots[id];
+  u32* support = slot.support.data() + position * Dictionary::LETTERS;
+
+  if (slot.counted[position])
+    return support;
+
+  /* a few candidates are quicker to read one by one than 26 masks are to AND */
+  if (slot.count < size_t(Dictionary::LETTERS) * slot.candidates.size())
+  {
+    std::fill(support, support + Dictionary::LETTERS, 0);
+    _dictionary.forEach(length, slot.candidates, [this, support, position](u32 word) {
+      ++support[Dictionary::letterIndex(_dictionary.word(word).text[position])];
+    });
+  }
+  else
+  {
+    for (s32 letter = 0; letter < Dictionary::LETTERS; ++letter)
+      support[letter] = u32(_dictionary.count(length, position, utf8_char('a' + letter), slot.candidates));
+  }
+
+  slot.counted[position] = 1;
+  return support;
+}
+
+size_t CrosswordAssistant::suggest(const CrosswordGrid& grid, word_id id, Suggestion* out, size_t max)
+{
+  if (id < 0 || id >= _slots.size() || max == 0)
+    return 0;
+
+  const WordProgress& word = grid.word(id);
+
+  /* for every empty cell crossed by a word which still has candidates the weight
+     of each letter there, the log of the candidates it leaves and -1 for none */
+  _weights.assign(word.length * Dictionary::LETTERS, 0.0f);
+
+  for (s32 i = 0, index = word.first; i < word.length; ++i, index += word.step)
+  {
+    const CrosswordCell& cell = grid.at(index);
+    const word_id other = cell.words[0] == id ? cell.words[1] : cell.words[0];
+
+    if (cell.isFilled() || other == NO_WORD || _slots[other].count == 0)
+      continue;
+
+    const WordProgress& crossing = grid.word(other);
+    const u32* support = this->support(other, crossing.length, offset(crossing, index));
+
+    for (s32 letter = 0; letter < Dictionary::LETTERS; ++letter)
+      _weights[i * Dictionary::LETTERS + letter] = support[letter] ? std::log(float(support[letter])) : -1.0f;
+  }
+
+  size_t count = 0;
+
+  _dictionary.forEach(word.length, _slots[id].candidates, [&](u32 candidate) {
+    const utf8_string& text = _dictionary.word(candidate).text;
+    float score = 0.0f;
+
+    for (s32 i = 0; i < word.length; ++i)
+    {
+      const float weight = _weights[i * Dictionary::LETTERS + (text[i] - 'a')];
+      if (weight < 0.0f)
+        return;
+      score += weight;
+    }
+
+    /* insertion into the few best, ties keep the earlier word of the dictionary */
+    size_t slot = count < max ? count++ : max;
+    while (slot > 0 && out[slot - 1].score < score)
+    {
+      if (slot < max)
+        out[slot] = out[slot - 1];
+      --slot;
+    }
+
+    if (slot < max)
+      out[slot] = { candidate, score };
+  });
+
+  return count;
+}
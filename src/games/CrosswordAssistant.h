@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Common.h"
+#include "games/CrosswordGrid.h"
+#include "games/Dictionary.h"
+
+#include <vector>
+
+namespace games
+{
+  struct Suggestion
+  {
+    u32 word; // index in the dictionary
+    float score;
+  };
+
+  /* answers which still fit the words of a grid being solved: every word keeps the
+     set of dictionary words matching the letters in its cells, and a letter typed
+     into an empty cell narrows the sets of the two words through it with a single
+     AND against the index. A letter changed or taken back can't be undone on a
+     bitset, those words are matched again from the letters left, which is a few
+     ANDs more and still never looks at the words themselves */
+  class CrosswordAssistant
+  {
+  private:
+    struct Slot
+    {
+      word_set candidates;
+      size_t count;
+
+      /* candidates with each letter at each position, counted when a word crossing
+         there is suggested for and dropped whenever the candidates change */
+      std::vector<u32> support;
+      std::vector<u8> counted;
+
+      Slot() : count(0) { }
+    };
+
+    const Dictionary& _dictionary;
+    std::vector<Slot> _slots;
+
+    std::vector<utf8_char> _pattern;
+    std::vector<float> _weights;
+
+    static s32 offset(const WordProgress& word, s32 index) { return (index - word.first) / word.step; }
+
+    void changed(Slot& slot, s32 length);
+    void match(const CrosswordGrid& grid, word_id id);
+    const u32* support(word_id id, s32 length, s32 position);
+
+  public:
+    CrosswordAssistant(const Dictionary& dictionary) : _dictionary(dictionary) { }
+
+    void reset(const CrosswordGrid& grid);
+
+    /* after the letter of the cell at index went from previous to what the grid holds now */
+    void update(const CrosswordGrid& grid, s32 index, unicode_t previous);
+
+    size_t count(word_id id) const { return id >= 0 && id < _slots.size() ? _slots[id].count : 0; }
+
+    /* up to max candidates of the word, best first: a candidate is left out if
+       one of its letters fits no candidate of the word crossing an empty cell,
+       the others are ranked by how many candidates their letters leave to those
+       words and then by dictionary order */
+    size_t suggest(const CrosswordGrid& grid, word_id id, Suggestion* out, size_t max);
+  };
+}
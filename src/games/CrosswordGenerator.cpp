@@ -0,0 +1,430 @@
+#include "CrosswordGenerator.h"
+
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <unordered_set>
+
+using namespace games;
+
+using clock_type = std::chrono::steady_clock;
+
+static float secondsSince(clock_type::time_point start)
+{
+  return std::chrono::duration<float>(clock_type::now() - start).count();
+}
+
+static std::mt19937 generatorFor(u64 seed)
+{
+  std::seed_seq sequence = { u32(seed), u32(seed >> 32) };
+  return std::mt19937(sequence);
+}
+
+std::vector<CrosswordGenerator::Slot> CrosswordGenerator::slots(const CrosswordPattern& pattern)
+{
+  std::vector<Slot> slots;
+
+  auto scan = [&](Dir dir, s32 lines, s32 length, std::function<Position(s32, s32)> at) {
+    for (s32 l = 0; l < lines; ++l)
+    {
+      s32 i = 0;
+      while (i < length)
+      {
+        Position p = at(l, i);
+        if (pattern.isBlocked(p.x, p.y))
+        {
+          ++i;
+          continue;
+        }
+
+        Slot slot = { p, dir, 0, { } };
+        while (i < length && !pattern.isBlocked(at(l, i).x, at(l, i).y))
+        {
+          slot.cells.push_back(at(l, i).y * pattern.w + at(l, i).x);
+          ++i;
+        }
+
+        slot.length = slot.cells.size();
+        if (slot.length >= 2)
+          slots.push_back(slot);
+      }
+    }
+  };
+
+  scan(Dir::Hor, pattern.h, pattern.w, [](s32 l, s32 i) { return Position(i, l); });
+  scan(Dir::Ver, pattern.w, pattern.h, [](s32 l, s32 i) { return Position(l, i); });
+
+  return slots;
+}
+
+class CrosswordGenerator::Search
+{
+public:
+  struct State
+  {
+    std::vector<utf8_char> grid;
+    std::vector<s32> words;
+  };
+
+  struct Attempt
+  {
+    u64 budget;
+    std::atomic<u64> nodes;
+    std::atomic<u32> tasks;
+    std::atomic<bool> aborted;
+
+    Attempt(u64 budget) : budget(budget), nodes(0), tasks(0), aborted(false) { }
+  };
+
+private:
+  const Dictionary& dictionary;
+  const std::vector<Slot>& slots;
+  const Options& options;
+  const s32 cells;
+  ThreadPool* pool;
+
+  std::mutex mutex;
+  State solution;
+
+  struct Scratch
+  {
+    word_set set, best;
+    std::vector<utf8_char> pattern;
+  };
+
+  bool explore(const std::shared_ptr<Attempt>& attempt, State& state, std::mt19937& rng, Scratch& scratch, bool split);
+  bool tryWords(const std::shared_ptr<Attempt>& attempt, State& state, s32 slot, const std::vector<u32>& words, std::mt19937& rng, Scratch& scratch);
+  void spawn(const std::shared_ptr<Attempt>& attempt, const State& state, s32 slot, std::vector<u32> words, u32 seed);
+  void finished(const std::shared_ptr<Attempt>& attempt);
+
+public:
+  std::atomic<bool> solved;
+  /* some attempt explored its whole tree without running out of budget, so no restart can find a fill */
+  std::atomic<bool> exhausted;
+  std::atomic<u64> nodes;
+  std::atomic<u32> attempts;
+  std::atomic<u64> seeds;
+
+  Search(const Dictionary& dictionary, const std::vector<Slot>& slots, const Options& options, s32 cells, ThreadPool* pool, u64 seed) :
+    dictionary(dictionary), slots(slots), options(options), cells(cells), pool(pool), solved(false), exhausted(false), nodes(0), attempts(0), seeds(seed) { }
+
+  State empty() const
+  {
+    State state;
+    state.grid.assign(cells, utf8_char(Dictionary::EMPTY));
+    state.words.assign(slots.size(), -1);
+    return state;
+  }
+
+  u64 budgetFor(u32 attempt) const
+  {
+    const u32 round = std::min<u32>(attempt / std::max<u32>(options.restarts, 1), 16);
+    return options.nodeBudget << round;
+  }
+
+  void startAttempt();
+  bool runSequential();
+
+  const State& result() const { return solution; }
+};
+
+bool CrosswordGenerator::Search::explore(const std::shared_ptr<Attempt>& attempt, State& state, std::mt19937& rng, Scratch& scratch, bool split)
+{
+  if (solved || exhausted || attempt->aborted)
+    return false;
+
+  ++nodes;
+  if (++attempt->nodes > attempt->budget)
+  {
+    attempt->aborted = true;
+    return false;
+  }
+
+  /* most constrained slot first, a slot with no candidates is a dead end */
+  s32 best = -1;
+  size_t bestCount = ~size_t(0);
+
+  for (s32 i = 0; i < slots.size(); ++i)
+  {
+    if (state.words[i] != -1)
+      continue;
+
+    const Slot& slot = slots[i];
+    scratch.pattern.resize(slot.length);
+    for (s32 p = 0; p < slot.length; ++p)
+      scratch.pattern[p] = state.grid[slot.cells[p]];
+
+    dictionary.match(scratch.pattern.data(), slot.length, scratch.set);
+    const size_t count = Dictionary::count(scratch.set);
+
+    if (count == 0)
+      return false;
+    else if (count < bestCount)
+    {
+      best = i;
+      bestCount = count;
+      scratch.best.swap(scratch.set);
+    }
+  }
+
+  if (best == -1)
+  {
+    bool expected = false;
+    if (solved.compare_exchange_strong(expected, true))
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      solution = state;
+    }
+    return true;
+  }
+
+  const Slot& slot = slots[best];
+
+  std::vector<u32> candidates;
+  candidates.reserve(bestCount);
+  dictionary.forEach(slot.length, scratch.best, [&](u32 word) {
+    if (std::find(state.words.begin(), state.words.end(), s32(word)) == state.words.end())
+      candidates.push_back(word);
+  });
+  std::shuffle(candidates.begin(), candidates.end(), rng);
+
+  /* at the root the candidates are dealt out in chunks to stealable tasks,
+     each chunk is then searched depth first by whoever picks it up */
+  if (split && pool)
+  {
+    const size_t chunks = std::min<size_t>(candidates.size(), pool->size() * options.chunksPerThread);
+
+    for (size_t c = 0; c < chunks; ++c)
+    {
+      std::vector<u32> chunk;
+      for (size_t i = c; i < candidates.size(); i += chunks)
+        chunk.push_back(candidates[i]);
+
+      spawn(attempt, state, best, std::move(chunk), rng());
+    }
+
+    return false;
+  }
+
+  return tryWords(attempt, state, best, candidates, rng, scratch);
+}
+
+bool CrosswordGenerator::Search::tryWords(const std::shared_ptr<Attempt>& attempt, State& state, s32 index, const std::vector<u32>& words, std::mt19937& rng, Scratch& scratch)
+{
+  const Slot& slot = slots[index];
+
+  std::vector<s32> placed;
+  placed.reserve(slot.length);
+
+  for (u32 word : words)
+  {
+    const utf8_string& text = dictionary.word(word).text;
+
+    placed.clear();
+    for (s32 p = 0; p < slot.length; ++p)
+      if (state.grid[slot.cells[p]] == Dictionary::EMPTY)
+      {
+        state.grid[slot.cells[p]] = text[p];
+        placed.push_back(slot.cells[p]);
+      }
+
+    state.words[index] = word;
+
+    if (explore(attempt, state, rng, scratch, false))
+      return true;
+
+    state.words[index] = -1;
+    for (s32 cell : placed)
+      state.grid[cell] = Dictionary::EMPTY;
+
+    if (solved || exhausted || attempt->aborted)
+      break;
+  }
+
+  return false;
+}
+
+void CrosswordGenerator::Search::spawn(const std::shared_ptr<Attempt>& attempt, const State& state, s32 slot, std::vector<u32> words, u32 seed)
+{
+  ++attempt->tasks;
+
+  /* std::function must be copyable so the task data travels through a shared_ptr */
+  struct Task
+  {
+    State state;
+    s32 slot;
+    std::vector<u32> words;
+  };
+
+  auto task = std::make_shared<Task>();
+  task->state = state;
+  task->slot = slot;
+  task->words = std::move(words);
+
+  pool->submit([this, attempt, task, seed]() {
+    std::mt19937 rng(seed);
+    Scratch scratch;
+
+    if (task->slot == -1)
+      explore(attempt, task->state, rng, scratch, true);
+    else
+      tryWords(attempt, task->state, task->slot, task->words, rng, scratch);
+
+    finished(attempt);
+  });
+}
+
+void CrosswordGenerator::Search::finished(const std::shared_ptr<Attempt>& attempt)
+{
+  /* last task of an attempt that ran out of budget replaces it with a fresh restart,
+     an attempt which wasn't aborted explored the whole tree so there is no fill at all
+     and the other lanes are stopped too */
+  if (--attempt->tasks == 0 && !solved)
+  {
+    if (attempt->aborted)
+      startAttempt();
+    else
+      exhausted = true;
+  }
+}
+
+void CrosswordGenerator::Search::startAttempt()
+{
+  if (solved || exhausted)
+    return;
+
+  const u32 index = attempts++;
+  if (index >= options.maxAttempts)
+    return;
+
+  std::shared_ptr<Attempt> attempt = std::make_shared<Attempt>(budgetFor(index));
+  spawn(attempt, empty(), -1, std::vector<u32>(), generatorFor(seeds++)());
+}
+
+bool CrosswordGenerator::Search::runSequential()
+{
+  while (attempts < options.maxAttempts)
+  {
+    const u32 index = attempts++;
+    std::shared_ptr<Attempt> attempt = std::make_shared<Attempt>(budgetFor(index));
+
+    State state = empty();
+    std::mt19937 rng = generatorFor(seeds++);
+    Scratch scratch;
+
+    if (explore(attempt, state, rng, scratch, false))
+      return true;
+    else if (!attempt->aborted)
+    {
+      exhausted = true;
+      break;
+    }
+  }
+
+  return false;
+}
+
+static u64 randomSeed(u64 seed)
+{
+  return seed ? seed : (u64(std::random_device()()) << 32) | std::random_device()();
+}
+
+static void fillScheme(const Dictionary& dictionary, const std::vector<CrosswordGenerator::Slot>& slots, const std::vector<s32>& words, CrosswordScheme& scheme)
+{
+  for (s32 i = 0; i < slots.size(); ++i)
+  {
+    const WordDefinition& word = dictionary.word(words[i]);
+    scheme.addDefinition(slots[i].position.x, slots[i].position.y, slots[i].orientation, word.text, word.hint);
+  }
+}
+
+bool CrosswordGenerator::generate(const CrosswordPattern& pattern, CrosswordScheme& scheme, const Options& options)
+{
+  const auto start = clock_type::now();
+  const auto slots = CrosswordGenerator::slots(pattern);
+
+  ThreadPool pool(options.threads);
+
+  Options effective = options;
+  if (!effective.restarts)
+    effective.restarts = pool.size();
+
+  Search search(_dictionary, slots, effective, pattern.w * pattern.h, &pool, randomSeed(options.seed));
+
+  for (u32 i = 0; i < effective.restarts; ++i)
+    search.startAttempt();
+
+  pool.wait();
+
+  _stats.nodes = search.nodes;
+  _stats.attempts = std::min(u32(search.attempts), effective.maxAttempts);
+  _stats.threads = pool.size();
+  _stats.seconds = secondsSince(start);
+
+  if (!search.solved)
+    return false;
+
+  scheme = CrosswordScheme(pattern.w, pattern.h);
+  fillScheme(_dictionary, slots, search.result().words, scheme);
+
+  return true;
+}
+
+std::vector<CrosswordScheme> CrosswordGenerator::generateBatch(const CrosswordPattern& pattern, u32 count, const Options& options)
+{
+  const auto start = clock_type::now();
+  const auto slots = CrosswordGenerator::slots(pattern);
+
+  std::vector<CrosswordScheme> schemes;
+  std::unordered_set<utf8_string> fills;
+  std::mutex mutex;
+
+  std::atomic<u64> nodes(0);
+  std::atomic<u32> attempts(0);
+  std::atomic<u64> seeds(randomSeed(options.seed));
+
+  ThreadPool pool(options.threads);
+
+  for (u32 i = 0; i < count; ++i)
+  {
+    pool.submit([&]() {
+      /* a duplicate of an already produced fill is thrown away and searched again */
+      for (u32 retry = 0; retry < options.maxAttempts; ++retry)
+      {
+        Search search(_dictionary, slots, options, pattern.w * pattern.h, nullptr, seeds.fetch_add(u64(1) << 32));
+        const bool found = search.runSequential();
+
+        nodes += search.nodes;
+        attempts += search.attempts;
+
+        if (!found)
+          return;
+
+        const auto& grid = search.result().grid;
+        const utf8_string fill(grid.begin(), grid.end());
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (fills.insert(fill).second)
+        {
+          schemes.push_back(CrosswordScheme(pattern.w, pattern.h));
+          fillScheme(_dictionary, slots, search.result().words, schemes.back());
+          return;
+        }
+      }
+    });
+  }
+
+  pool.wait();
+
+  _stats.nodes = nodes;
+  _stats.attempts = attempts;
+  _stats.threads = pool.size();
+  _stats.seconds = secondsSince(start);
+
+  return schemes;
+}
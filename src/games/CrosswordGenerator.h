@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Common.h"
+#include "games/Crossword.h"
+#include "games/Dictionary.h"
+
+#include <vector>
+
+namespace games
+{
+  struct CrosswordPattern
+  {
+    s32 w, h;
+    std::vector<u8> blocked;
+
+    CrosswordPattern(s32 w, s32 h) : w(w), h(h), blocked(w*h, 0) { }
+
+    /* one string for each row, '#' marks a blocked cell */
+    static CrosswordPattern fromRows(const std::vector<utf8_string>& rows)
+    {
+      CrosswordPattern pattern(rows.empty() ? 0 : rows[0].length(), rows.size());
+
+      for (s32 y = 0; y < pattern.h; ++y)
+        for (s32 x = 0; x < pattern.w && x < rows[y].length(); ++x)
+          pattern.blocked[y * pattern.w + x] = rows[y][x] == '#';
+
+      return pattern;
+    }
+
+    bool isBlocked(s32 x, s32 y) const { return blocked[y * w + x] != 0; }
+    void block(s32 x, s32 y) { blocked[y * w + x] = 1; }
+  };
+
+  class CrosswordGenerator
+  {
+  public:
+    struct Options
+    {
+      u32 threads; // 0 means one for each hardware thread
+      u32 restarts; // randomized attempts racing at the same time, 0 means one for each thread
+      u32 maxAttempts; // attempts before giving up
+      u32 chunksPerThread; // stealable tasks the root of each attempt is split into, for each thread
+      u64 nodeBudget; // nodes explored by an attempt before restarting, doubled at every round
+      u64 seed; // 0 picks a random one
+
+      Options() : threads(0), restarts(0), maxAttempts(256), chunksPerThread(2), nodeBudget(20000), seed(0) { }
+    };
+
+    struct Stats
+    {
+      u64 nodes;
+      u32 attempts;
+      u32 threads;
+      float seconds;
+
+      Stats() : nodes(0), attempts(0), threads(0), seconds(0.0f) { }
+    };
+
+    struct Slot
+    {
+      Position position;
+      Dir orientation;
+      s32 length;
+      std::vector<s32> cells;
+    };
+
+  private:
+    const Dictionary& _dictionary;
+    Stats _stats;
+
+    class Search;
+
+  public:
+    CrosswordGenerator(const Dictionary& dictionary) : _dictionary(dictionary) { }
+
+    static std::vector<Slot> slots(const CrosswordPattern& pattern);
+
+    /* races randomized restarts over a work-stealing pool, first complete fill wins */
+    bool generate(const CrosswordPattern& pattern, CrosswordScheme& scheme, const Options& options = Options());
+
+    /* fills count distinct schemes concurrently, one sequential search for each task */
+    std::vector<CrosswordScheme> generateBatch(const CrosswordPattern& pattern, u32 count, const Options& options = Options());
+
+    const Stats& stats() const { return _stats; }
+  };
+}
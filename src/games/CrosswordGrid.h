@@ -0,0 +1,211 @@
+#pragma once
+
+#include "Common.h"
+#include "Unicode.h"
+#include "games/Crossword.h"
+
+#include <vector>
+
+namespace games
+{
+  using word_id = s32;
+  constexpr word_id NO_WORD = -1;
+
+  struct CrosswordCell
+  {
+    unicode_t solution;
+    unicode_t letter;
+    word_id words[2]; // across and down definitions crossing the cell
+
+    CrosswordCell() : solution(0), letter(0), words{ NO_WORD, NO_WORD } { }
+
+    bool isBlocked() const { return solution == 0; }
+    bool isFilled() const { return letter != 0; }
+    bool isCorrect() const { return letter == solution; }
+  };
+
+  struct WordProgress
+  {
+    s32 first; // index of the first cell
+    s32 step; // index delta between consecutive cells
+    s32 length;
+    s32 filled;
+    s32 correct;
+
+    bool isComplete() const { return filled == length; }
+    bool isSolved() const { return correct == length; }
+  };
+
+  /* player progress over a scheme, every edit updates only the counters
+     of the cell and of the (at most two) words which cross it */
+  class CrosswordGrid
+  {
+  private:
+    s32 _w, _h;
+    std::vector<CrosswordCell> _cells;
+    std::vector<WordProgress> _words;
+
+    s32 _open;
+    s32 _filled;
+    s32 _correct;
+    s32 _conflicts;
+
+    std::vector<s32> _dirty;
+    std::vector<u8> _isDirty;
+
+    void markDirty(s32 index)
+    {
+      if (!_isDirty[index])
+      {
+        _isDirty[index] = 1;
+        _dirty.push_back(index);
+      }
+    }
+
+    void markWordDirty(word_id id)
+    {
+      const WordProgress& word = _words[id];
+      for (s32 i = 0, index = word.first; i < word.length; ++i, index += word.step)
+        markDirty(index);
+    }
+
+    void account(const CrosswordCell& cell, s32 sign)
+    {
+      const s32 filled = cell.isFilled() ? sign : 0;
+      const s32 correct = cell.isFilled() && cell.isCorrect() ? sign : 0;
+
+      _filled += filled;
+      _correct += correct;
+
+      for (word_id id : cell.words)
+        if (id != NO_WORD)
+        {
+          const bool wasSolved = _words[id].isSolved();
+
+          _words[id].filled += filled;
+          _words[id].correct += correct;
+
+          /* the whole word changes look when it becomes (un)solved */
+          if (wasSolved != _words[id].isSolved())
+            markWordDirty(id);
+        }
+    }
+
+  public:
+    CrosswordGrid(const CrosswordScheme& scheme) { reset(scheme); }
+
+    void reset(const CrosswordScheme& scheme)
+    {
+      _w = scheme.width();
+      _h = scheme.height();
+
+      _cells.assign(_w * _h, CrosswordCell());
+      _words.clear();
+      _open = _filled = _correct = _conflicts = 0;
+
+      /* answers are decoded once here, cells then only hold code points */
+      unicode_string text;
+
+      const auto& definitions = scheme.definitions();
+      for (word_id id = 0; id < definitions.size(); ++id)
+      {
+        const auto& def = definitions[id];
+        utf8::decode(def.definition.text, text);
+        const s32 slot = def.orientation == Dir::Hor ? 0 : 1;
+
+        _words.push_back({ def.position.y * _w + def.position.x, slot ? _w : 1, 0, 0, 0 });
+
+        auto p = def.position;
+        for (s32 i = 0; i < text.size(); ++i, p += def.orientation)
+        {
+          /* words are truncated where they leave the grid */
+          if (!isValid(p.x, p.y))
+          {
+            ++_conflicts;
+            break;
+          }
+
+          CrosswordCell& cell = _cells[p.y * _w + p.x];
+          const unicode_t letter = unicode::toLower(text[i]);
+
+          if (cell.isBlocked())
+          {
+            cell.solution = letter;
+            ++_open;
+          }
+          else if (cell.solution != letter)
+            ++_conflicts;
+
+          ++_words.back().length;
+
+          cell.words[slot] = id;
+        }
+      }
+
+      _isDirty.assign(_cells.size(), 0);
+      _dirty.clear();
+      markAllDirty();
+    }
+
+    coord_t width() const { return _w; }
+    coord_t height() const { return _h; }
+
+    bool isValid(s32 x, s32 y) const { return x >= 0 && x < _w && y >= 0 && y < _h; }
+
+    const CrosswordCell& at(s32 x, s32 y) const { return _cells[y * _w + x]; }
+    const CrosswordCell& at(s32 index) const { return _cells[index]; }
+
+    const WordProgress& word(word_id id) const { return _words[id]; }
+    size_t wordCount() const { return _words.size(); }
+
+    bool isInSolvedWord(const CrosswordCell& cell) const
+    {
+      return (cell.words[0] != NO_WORD && word(cell.words[0]).isSolved()) || (cell.words[1] != NO_WORD && word(cell.words[1]).isSolved());
+    }
+
+    /* returns false if the cell can't hold a letter */
+    bool set(s32 x, s32 y, unicode_t letter)
+    {
+      if (!isValid(x, y) || at(x, y).isBlocked())
+        return false;
+
+      letter = unicode::toLower(letter);
+
+      const s32 index = y * _w + x;
+      CrosswordCell& cell = _cells[index];
+
+      if (cell.letter != letter)
+      {
+        account(cell, -1);
+        cell.letter = letter;
+        account(cell, +1);
+        markDirty(index);
+      }
+
+      return true;
+    }
+
+    bool clear(s32 x, s32 y) { return set(x, y, 0); }
+
+    bool isFilled() const { return _filled == _open; }
+    bool isSolved() const { return _correct == _open; }
+
+    /* letters of overlapping definitions which disagree, or which run outside the grid */
+    s32 conflicts() const { return _conflicts; }
+
+    const std::vector<s32>& dirty() const { return _dirty; }
+
+    void clearDirty()
+    {
+      for (s32 index : _dirty)
+        _isDirty[index] = 0;
+      _dirty.clear();
+    }
+
+    void markAllDirty()
+    {
+      for (s32 i = 0; i < _cells.size(); ++i)
+        markDirty(i);
+    }
+  };
+}
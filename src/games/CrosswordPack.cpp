@@ -0,0 +1,434 @@
+#include "CrosswordPack.h"
+
+#include "Unicode.h"
+
+#include <cmath>
+#include <cstdio>
+
+using namespace games;
+
+static const char MAGIC[4] = { 'E', 'N', 'P', 'K' };
+
+void pack::tokenize(const utf8_string& text, std::vector<utf8_string>& tokens)
+{
+  tokens.clear();
+
+  const char* it = text.data();
+  const char* end = it + text.size();
+
+  utf8_string token;
+  size_t length = 0;
+
+  auto flush = [&]() {
+    if (length >= 2)
+      tokens.push_back(token);
+    token.clear();
+    length = 0;
+  };
+
+  while (it != end)
+  {
+    const unicode_t cp = utf8::next(it, end);
+
+    if (unicode::isAlphanumeric(cp))
+    {
+      utf8::append(token, unicode::fold(cp));
+      ++length;
+    }
+    else
+      flush();
+  }
+
+  flush();
+}
+
+void pack::grams(const utf8_string& token, std::vector<utf8_string>& grams)
+{
+  grams.clear();
+
+  const unicode_string cps = utf8::decode(token);
+
+  for (size_t i = 0; i + GRAM <= cps.size(); ++i)
+  {
+    utf8_string gram;
+    for (size_t j = 0; j < GRAM; ++j)
+      utf8::append(gram, cps[i + j]);
+    grams.push_back(gram);
+  }
+}
+
+CrosswordPackWriter::CrosswordPackWriter()
+{
+  _offsets.push_back(0);
+}
+
+void CrosswordPackWriter::index(pack::TermKind kind, const utf8_string& text, u32 scheme, u16 field)
+{
+  const utf8_string key = char(kind) + text;
+  auto it = _lookup.find(key);
+
+  if (it == _lookup.end())
+  {
+    it = _lookup.insert(std::make_pair(key, u32(_terms.size()))).first;
+    _terms.push_back({ kind, text, { } });
+  }
+
+  auto& postings = _terms[it->second].postings;
+
+  if (postings.empty() || postings.back().scheme != scheme)
+    postings.push_back({ scheme, 0, 0 });
+
+  if (postings.back().frequency < 0xFFFF)
+    ++postings.back().frequency;
+  postings.back().fields |= field;
+}
+
+void CrosswordPackWriter::add(const CrosswordScheme& scheme)
+{
+  const u32 id = size();
+  const auto& definitions = scheme.definitions();
+
+  pack::SchemeRecord record = { u16(scheme.width()), u16(scheme.height()), u16(definitions.size()), 0 };
+
+  auto append = [this](const void* data, size_t length) {
+    const u8* bytes = static_cast<const u8*>(data);
+    _schemes.insert(_schemes.end(), bytes, bytes + length);
+  };
+
+  append(&record, sizeof(record));
+
+  for (const auto& def : definitions)
+  {
+    pack::Definition entry = { u8(def.position.x), u8(def.position.y), u8(def.orientation == Dir::Hor ? 0 : 1), 0,
+      u16(def.definition.text.size()), u16(def.definition.hint.size()) };
+    append(&entry, sizeof(entry));
+  }
+
+  std::vector<utf8_string> tokens, grams;
+
+  for (const auto& def : definitions)
+  {
+    append(def.definition.text.data(), def.definition.text.size());
+    append(def.definition.hint.data(), def.definition.hint.size());
+
+    pack::tokenize(def.definition.hint, tokens);
+    for (const auto& token : tokens)
+      index(pack::TermKind::Word, token, id, pack::Field::Hint);
+
+    pack::tokenize(def.definition.text, tokens);
+    for (const auto& token : tokens)
+    {
+      index(pack::TermKind::Word, token, id, pack::Field::Answer);
+
+      pack::grams(token, grams);
+      for (const auto& gram : grams)
+        index(pack::TermKind::Gram, gram, id, pack::Field::Answer);
+    }
+  }
+
+  _schemes.resize((_schemes.size() + 7) & ~size_t(7), 0);
+  _offsets.push_back(_schemes.size());
+}
+
+bool CrosswordPackWriter::write(const path& path)
+{
+  std::vector<u32> order(_terms.size());
+  for (u32 i = 0; i < order.size(); ++i)
+    order[i] = i;
+
+  std::sort(order.begin(), order.end(), [this](u32 a, u32 b) {
+    return _terms[a].kind != _terms[b].kind ? _terms[a].kind < _terms[b].kind : _terms[a].text < _terms[b].text;
+  });
+
+  std::vector<pack::Term> table;
+  utf8_string text;
+  std::vector<pack::Posting> postings;
+
+  for (u32 i : order)
+  {
+    const Entry& entry = _terms[i];
+    table.push_back({ u32(text.size()), u16(entry.text.size()), entry.kind, 0, u32(postings.size()), u32(entry.postings.size()) });
+    text += entry.text;
+    postings.insert(postings.end(), entry.postings.begin(), entry.postings.end());
+  }
+
+  auto align = [](u64 offset) { return (offset + 7) & ~u64(7); };
+
+  pack::Header header;
+  std::copy(MAGIC, MAGIC + 4, header.magic);
+  header.version = pack::VERSION;
+  header.schemes = size();
+  header.terms = table.size();
+  header.schemeTable = sizeof(pack::Header);
+
+  const u64 schemeData = align(header.schemeTable + _offsets.size() * sizeof(u64));
+  header.termTable = align(schemeData + _schemes.size());
+  header.termText = align(header.termTable + table.size() * sizeof(pack::Term));
+  header.postings = align(header.termText + text.size());
+
+  std::vector<u64> offsets(_offsets);
+  for (auto& offset : offsets)
+    offset += schemeData;
+
+  /* written beside the destination and renamed over it so a reader never maps half a pack */
+  const ::path temporary = path + ".tmp";
+  FILE* out = fopen(temporary.c_str(), "wb");
+  if (!out)
+    return false;
+
+  u64 position = 0;
+  auto write = [&](u64 offset, const void* data, size_t length) {
+    static const u8 zeroes[8] = { 0 };
+    fwrite(zeroes, 1, offset - position, out);
+    fwrite(data, 1, length, out);
+    position = offset + length;
+  };
+
+  write(0, &header, sizeof(header));
+  write(header.schemeTable, offsets.data(), offsets.size() * sizeof(u64));
+  write(schemeData, _schemes.data(), _schemes.size());
+  write(header.termTable, table.data(), table.size() * sizeof(pack::Term));
+  write(header.termText, text.data(), text.size());
+  write(header.postings, postings.data(), postings.size() * sizeof(pack::Posting));
+
+  const bool success = !ferror(out);
+  fclose(out);
+
+  return success && std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+bool CrosswordPack::open(const path& path)
+{
+  close();
+
+  if (!_file.open(path) || _file.size() < sizeof(pack::Header))
+    return false;
+
+  const pack::Header* header = _file.at<pack::Header>(0);
+  const u64 size = _file.size();
+
+  /* count items of the given size starting at offset fit in the file, without overflowing */
+  auto fits = [size](u64 offset, u64 count, u64 bytes) { return offset <= size && count <= (size - offset) / bytes; };
+
+  bool valid = std::equal(MAGIC, MAGIC + 4, header->magic) && header->version == pack::VERSION &&
+    header->schemeTable % sizeof(u64) == 0 && fits(header->schemeTable, u64(header->schemes) + 1, sizeof(u64)) &&
+    header->termTable % alignof(pack::Term) == 0 && fits(header->termTable, header->terms, sizeof(pack::Term)) &&
+    header->postings % alignof(pack::Posting) == 0 && header->termText <= size && header->postings <= size;
+
+  /* search trusts the text and the posting run of every term, so they are checked once here;
+     scheme records are only checked when they are read */
+  if (valid)
+  {
+    const pack::Term* terms = _file.at<pack::Term>(header->termTable);
+
+    for (u32 i = 0; i < header->terms && valid; ++i)
+      valid = fits(header->termText + terms[i].text, terms[i].length, 1) &&
+        fits(header->postings + u64(terms[i].postings) * sizeof(pack::Posting), terms[i].count, sizeof(pack::Posting));
+  }
+
+  if (!valid)
+  {
+    _file.close();
+    return false;
+  }
+
+  _header = header;
+  _scores.assign(header->schemes, 0.0f);
+  return true;
+}
+
+bool CrosswordPack::scheme(u32 index, CrosswordScheme& scheme) const
+{
+  if (!_header || index >= _header->schemes)
+    return false;
+
+  /* the record lies between its own offset and the next one, a bad offset only loses its own scheme */
+  const u64* offsets = _file.at<u64>(_header->schemeTable);
+  const u64 offset = offsets[index], end = offsets[index + 1];
+
+  if (offset % sizeof(u64) != 0 || offset > end || end > _file.size() || end - offset < sizeof(pack::SchemeRecord))
+    return false;
+
+  const u64 available = end - offset;
+
+  const pack::SchemeRecord* record = _file.at<pack::SchemeRecord>(offset);
+  const pack::Definition* definitions = reinterpret_cast<const pack::Definition*>(record + 1);
+  u64 used = sizeof(pack::SchemeRecord) + u64(record->definitions) * sizeof(pack::Definition);
+
+  if (used > available)
+    return false;
+
+  for (u16 i = 0; i < record->definitions; ++i)
+    used += u64(definitions[i].textLength) + definitions[i].hintLength;
+
+  if (used > available)
+    return false;
+
+  const char* text = reinterpret_cast<const char*>(definitions + record->definitions);
+
+  scheme = CrosswordScheme(record->width, record->height);
+
+  for (u16 i = 0; i < record->definitions; ++i)
+  {
+    const pack::Definition& def = definitions[i];
+    utf8_string answer(text, def.textLength);
+    utf8_string hint(text + def.textLength, def.hintLength);
+    text += def.textLength + def.hintLength;
+
+    scheme.addDefinition(def.x, def.y, def.orientation ? Dir::Ver : Dir::Hor, answer, hint);
+  }
+
+  return true;
+}
+
+const pack::Term* CrosswordPack::find(pack::TermKind kind, const utf8_string& text) const
+{
+  const pack::Term* terms = _file.at<pack::Term>(_header->termTable);
+  const char* strings = _file.at<char>(_header->termText);
+
+  auto compare = [&](const pack::Term& term) {
+    if (term.kind != kind)
+      return term.kind < kind ? -1 : 1;
+
+    const int c = memcmp(strings + term.text, text.data(), std::min<size_t>(term.length, text.size()));
+    if (c)
+      return c;
+    return term.length < text.size() ? -1 : (term.length > text.size() ? 1 : 0);
+  };
+
+  size_t low = 0, high = _header->terms;
+  while (low < high)
+  {
+    const size_t middle = (low + high) / 2;
+    const int c = compare(terms[middle]);
+
+    if (c == 0)
+      return &terms[middle];
+    else if (c < 0)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  return nullptr;
+}
+
+std::vector<CrosswordPack::Hit> CrosswordPack::search(const utf8_string& query, size_t maxHits) const
+{
+  std::vector<Hit> hits;
+
+  if (!_header)
+    return hits;
+
+  const float schemes = float(_header->schemes);
+  auto idf = [schemes](u32 count) { return std::log(1.0f + schemes / count); };
+
+  /* dense accumulators, a hash map costs far more than touching a float per scheme;
+     postings are only checked to be in the pack when they are scored */
+  std::vector<float>& scores = _scores;
+  std::vector<u32> touched;
+  auto score = [&](u32 scheme, float value) {
+    if (scheme >= _header->schemes)
+      return;
+    if (scores[scheme] == 0.0f)
+      touched.push_back(scheme);
+    scores[scheme] += value;
+  };
+
+  std::vector<utf8_string> tokens, grams;
+  std::vector<u32> exact, partial, next;
+
+  pack::tokenize(query, tokens);
+
+  for (const auto& token : tokens)
+  {
+    exact.clear();
+
+    if (const pack::Term* term = find(pack::TermKind::Word, token))
+    {
+      const float weight = idf(term->count);
+      const pack::Posting* p = postings(term);
+
+      for (u32 i = 0; i < term->count; ++i)
+      {
+        const float field = (p[i].fields & pack::Field::Answer) ? 3.0f : 1.0f;
+        score(p[i].scheme, weight * field * (1.0f + std::log(float(p[i].frequency))));
+        exact.push_back(p[i].scheme);
+      }
+    }
+
+    /* answers containing the token are found intersecting the runs of its grams, rarest first */
+    pack::grams(token, grams);
+    if (grams.empty())
+      continue;
+
+    std::vector<const pack::Term*> runs;
+    for (const auto& gram : grams)
+    {
+      const pack::Term* term = find(pack::TermKind::Gram, gram);
+      if (!term)
+      {
+        runs.clear();
+        break;
+      }
+      runs.push_back(term);
+    }
+
+    if (runs.empty())
+      continue;
+
+    std::sort(runs.begin(), runs.end(), [](const pack::Term* a, const pack::Term* b) { return a->count < b->count; });
+
+    partial.clear();
+    const pack::Posting* first = postings(runs[0]);
+    for (u32 i = 0; i < runs[0]->count; ++i)
+      partial.push_back(first[i].scheme);
+
+    for (size_t r = 1; r < runs.size() && !partial.empty(); ++r)
+    {
+      const pack::Posting* p = postings(runs[r]);
+      next.clear();
+
+      size_t i = 0, j = 0;
+      while (i < partial.size() && j < runs[r]->count)
+      {
+        if (partial[i] < p[j].scheme)
+          ++i;
+        else if (p[j].scheme < partial[i])
+          ++j;
+        else
+        {
+          next.push_back(partial[i]);
+          ++i;
+          ++j;
+        }
+      }
+
+      partial.swap(next);
+    }
+
+    const float weight = 0.5f * idf(runs[0]->count);
+    for (u32 scheme : partial)
+      if (!std::binary_search(exact.begin(), exact.end(), scheme))
+        score(scheme, weight);
+  }
+
+  hits.reserve(touched.size());
+  for (u32 scheme : touched)
+  {
+    hits.push_back({ scheme, scores[scheme] });
+    scores[scheme] = 0.0f;
+  }
+
+  auto better = [](const Hit& a, const Hit& b) { return a.score != b.score ? a.score > b.score : a.scheme < b.scheme; };
+
+  if (hits.size() > maxHits)
+  {
+    std::partial_sort(hits.begin(), hits.begin() + maxHits, hits.end(), better);
+    hits.resize(maxHits);
+  }
+  else
+    std::sort(hits.begin(), hits.end(), better);
+
+  return hits;
+}
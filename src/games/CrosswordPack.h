@@ -0,0 +1,143 @@
+#pragma once
+
+#include "Common.h"
+#include "MappedFile.h"
+#include "games/Crossword.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace games
+{
+  /* on disk layout of a pack, every offset is from the start of the file and
+     every field is little endian, which is what both targets are */
+  namespace pack
+  {
+    constexpr u32 VERSION = 1;
+
+    struct Header
+    {
+      char magic[4];
+      u32 version;
+      u32 schemes;
+      u32 terms;
+      u64 schemeTable; // schemes + 1 offsets to the scheme records, the last one marks the end
+      u64 termTable; // Term[terms], sorted by kind and then bytewise by text
+      u64 termText;
+      u64 postings; // Posting[], one run for each term sorted by scheme
+    };
+
+    enum class TermKind : u8 { Word, Gram };
+
+    enum Field : u16 { Hint = 0x01, Answer = 0x02 };
+
+    struct Term
+    {
+      u32 text;
+      u16 length;
+      TermKind kind;
+      u8 padding;
+      u32 postings;
+      u32 count;
+    };
+
+    struct Posting
+    {
+      u32 scheme;
+      u16 frequency;
+      u16 fields;
+    };
+
+    /* a scheme record is the header, then Definition[definitions], then the text of all of them */
+    struct SchemeRecord
+    {
+      u16 width;
+      u16 height;
+      u16 definitions;
+      u16 padding;
+    };
+
+    struct Definition
+    {
+      u8 x;
+      u8 y;
+      u8 orientation;
+      u8 padding;
+      u16 textLength;
+      u16 hintLength;
+    };
+
+    static_assert(sizeof(Header) == 48, "pack header layout");
+    static_assert(sizeof(Term) == 16, "pack term layout");
+    static_assert(sizeof(Posting) == 8, "pack posting layout");
+    static_assert(sizeof(Definition) == 8, "pack definition layout");
+
+    constexpr size_t GRAM = 3;
+
+    /* accent folded lowercase words of at least two letters */
+    void tokenize(const utf8_string& text, std::vector<utf8_string>& tokens);
+    void grams(const utf8_string& token, std::vector<utf8_string>& grams);
+  }
+
+  class CrosswordPackWriter
+  {
+  private:
+    struct Entry
+    {
+      pack::TermKind kind;
+      utf8_string text;
+      std::vector<pack::Posting> postings;
+    };
+
+    std::vector<u8> _schemes;
+    std::vector<u64> _offsets;
+    std::vector<Entry> _terms;
+    std::unordered_map<utf8_string, u32> _lookup;
+
+    void index(pack::TermKind kind, const utf8_string& text, u32 scheme, u16 field);
+
+  public:
+    CrosswordPackWriter();
+
+    void add(const CrosswordScheme& scheme);
+    u32 size() const { return _offsets.size() - 1; }
+
+    bool write(const path& path);
+  };
+
+  class CrosswordPack
+  {
+  public:
+    struct Hit
+    {
+      u32 scheme;
+      float score;
+    };
+
+  private:
+    MappedFile _file;
+    const pack::Header* _header;
+
+    /* a score for each scheme, kept between queries and zeroed again on the schemes a query touched */
+    mutable std::vector<float> _scores;
+
+    const pack::Term* find(pack::TermKind kind, const utf8_string& text) const;
+    const pack::Posting* postings(const pack::Term* term) const { return _file.at<pack::Posting>(_header->postings) + term->postings; }
+
+  public:
+    CrosswordPack() : _header(nullptr) { }
+
+    bool open(const path& path);
+    void close() { _file.close(); _header = nullptr; _scores.clear(); }
+
+    u32 size() const { return _header ? _header->schemes : 0; }
+
+    /* false if the record doesn't fit where the scheme table says it is, open only checks the table itself */
+    bool scheme(u32 index, CrosswordScheme& scheme) const;
+
+    /* ranked hits for the words of the query, answers are also matched by
+       their letter grams so that partial words are found, schemes are not read;
+       queries share the accumulators so only one can run at a time */
+    std::vector<Hit> search(const utf8_string& query, size_t maxHits = 20) const;
+  };
+}
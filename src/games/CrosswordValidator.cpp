@@ -0,0 +1,297 @@
+#include "CrosswordValidator.h"
+#include "CrosswordPack.h"
+
+#include "ThreadPool.h"
+#include "Unicode.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <unordered_map>
+
+using namespace games;
+
+namespace
+{
+  /* schemes validated by a task, a single one is too little work to hand to the pool */
+  constexpr u32 CHUNK = 32;
+
+  utf8_string format(const char* format, ...)
+  {
+    char buffer[160];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    return buffer;
+  }
+
+  utf8_string letter(unicode_t cp)
+  {
+    utf8_string text;
+    utf8::append(text, cp);
+    return text;
+  }
+
+  class Checker
+  {
+  private:
+    const CrosswordScheme& _scheme;
+    CrosswordReport& _report;
+
+    void add(CrosswordIssue::Kind kind, bool error, word_id word, Position cell, utf8_string detail)
+    {
+      _report.issues.push_back({ kind, error, word, cell, std::move(detail) });
+    }
+
+  public:
+    Checker(const CrosswordScheme& scheme, CrosswordReport& report) : _scheme(scheme), _report(report) { }
+
+    void size()
+    {
+      if (_scheme.width() <= 0 || _scheme.height() <= 0)
+        add(CrosswordIssue::Kind::Size, true, NO_WORD, { -1, -1 }, format("grid is %dx%d", _scheme.width(), _scheme.height()));
+      else if (_scheme.definitions().empty())
+        add(CrosswordIssue::Kind::Size, true, NO_WORD, { -1, -1 }, "no definitions");
+    }
+
+    /* the answer decoded and folded as it's compared against other answers and
+       the dictionary, empty if it has anything but letters */
+    utf8_string answer(word_id id, const unicode_string& text)
+    {
+      utf8_string folded;
+
+      if (text.size() < 2)
+      {
+        add(CrosswordIssue::Kind::Answer, true, id, { -1, -1 }, format("answer has %u letters", u32(text.size())));
+        return utf8_string();
+      }
+
+      for (unicode_t cp : text)
+      {
+        if (cp == utf8::REPLACEMENT)
+        {
+          add(CrosswordIssue::Kind::Answer, true, id, { -1, -1 }, "answer is not valid UTF-8");
+          return utf8_string();
+        }
+        else if (!unicode::isAlphanumeric(cp) || (cp >= '0' && cp <= '9'))
+        {
+          add(CrosswordIssue::Kind::Answer, true, id, { -1, -1 }, format("answer has U+%04X, which is not a letter", cp));
+          return utf8_string();
+        }
+
+        utf8::append(folded, unicode::fold(cp));
+      }
+
+      return folded;
+    }
+
+    void hint(word_id id, const utf8_string& hint, const std::vector<utf8_string>& answerTokens)
+    {
+      const unicode_string text = utf8::decode(hint);
+
+      if (text.empty())
+      {
+        add(CrosswordIssue::Kind::Hint, true, id, { -1, -1 }, "hint is empty");
+        return;
+      }
+
+      for (size_t i = 0; i < text.size(); ++i)
+      {
+        if (text[i] == utf8::REPLACEMENT)
+          add(CrosswordIssue::Kind::Hint, true, id, { -1, -1 }, format("hint is not valid UTF-8 at character %u", u32(i)));
+        else if (text[i] < 0x20 || text[i] == 0x7F)
+          add(CrosswordIssue::Kind::Hint, true, id, { -1, -1 }, format("hint has control character U+%04X at %u", text[i], u32(i)));
+        else
+          continue;
+        return;
+      }
+
+      if (text.front() == ' ' || text.back() == ' ')
+        add(CrosswordIssue::Kind::Hint, false, id, { -1, -1 }, "hint starts or ends with a space");
+      else if (hint.find("  ") != utf8_string::npos)
+        add(CrosswordIssue::Kind::Hint, false, id, { -1, -1 }, "hint has a double space");
+
+      /* a hint which spells out its own answer, tokens are folded on both sides */
+      std::vector<utf8_string> tokens;
+      pack::tokenize(hint, tokens);
+
+      for (const utf8_string& token : answerTokens)
+        if (std::find(tokens.begin(), tokens.end(), token) != tokens.end())
+        {
+          add(CrosswordIssue::Kind::Hint, false, id, { -1, -1 }, "hint contains the answer");
+          break;
+        }
+    }
+
+    void dictionary(word_id id, const utf8_string& folded, const Dictionary& dictionary, word_set& set)
+    {
+      /* folded answers are plain a-z unless they had letters outside Latin-1 */
+      for (utf8_char c : folded)
+        if (Dictionary::letterIndex(c) == -1)
+        {
+          add(CrosswordIssue::Kind::Unknown, false, id, { -1, -1 }, "answer can't be in the dictionary");
+          return;
+        }
+
+      dictionary.match(folded.data(), s32(folded.size()), set);
+      if (Dictionary::count(set) == 0)
+        add(CrosswordIssue::Kind::Unknown, false, id, { -1, -1 }, format("'%s' is not in the dictionary", folded.c_str()));
+    }
+
+    void run(const Dictionary* dictionary)
+    {
+      size();
+
+      const s32 w = std::max(_scheme.width(), 0), h = std::max(_scheme.height(), 0);
+      const auto& definitions = _scheme.definitions();
+
+      /* letters and words of each cell, as CrosswordGrid::reset lays them out */
+      std::vector<unicode_t> letters(w * h, 0);
+      std::vector<word_id> words[2] = { std::vector<word_id>(w * h, NO_WORD), std::vector<word_id>(w * h, NO_WORD) };
+
+      std::unordered_map<utf8_string, word_id> answers;
+      std::vector<utf8_string> tokens;
+      unicode_string text;
+      word_set set;
+
+      for (word_id id = 0; id < definitions.size(); ++id)
+      {
+        const CrosswordDefinition& def = definitions[id];
+        const s32 slot = def.orientation == Dir::Hor ? 0 : 1;
+
+        utf8::decode(def.definition.text, text);
+        const utf8_string folded = answer(id, text);
+
+        Position p = def.position;
+        for (s32 i = 0; i < text.size(); ++i, p += def.orientation)
+        {
+          if (p.x < 0 || p.x >= w || p.y < 0 || p.y >= h)
+          {
+            add(CrosswordIssue::Kind::OffGrid, true, id, p, format("%u of %u letters outside the %dx%d grid", u32(text.size() - i), u32(text.size()), w, h));
+            break;
+          }
+
+          const s32 index = p.y * w + p.x;
+          const unicode_t cp = unicode::toLower(text[i]);
+
+          if (letters[index] == 0)
+            letters[index] = cp;
+          else if (letters[index] != cp)
+            add(CrosswordIssue::Kind::Conflict, true, id, p, format("'%s' against '%s' of word %d", letter(cp).c_str(), letter(letters[index]).c_str(),
+              words[0][index] != NO_WORD ? words[0][index] : words[1][index]));
+
+          /* the grid would keep only the last of two words running the same way through a cell */
+          if (words[slot][index] != NO_WORD)
+            add(CrosswordIssue::Kind::Conflict, true, id, p, format("overlaps word %d running the same way", words[slot][index]));
+
+          words[slot][index] = id;
+        }
+
+        if (!folded.empty())
+        {
+          const auto inserted = answers.emplace(folded, id);
+          if (!inserted.second)
+            add(CrosswordIssue::Kind::Duplicate, false, id, { -1, -1 }, format("same answer as word %d", inserted.first->second));
+
+          if (dictionary)
+            this->dictionary(id, folded, *dictionary, set);
+        }
+
+        pack::tokenize(def.definition.text, tokens);
+        hint(id, def.definition.hint, tokens);
+      }
+
+      /* an open cell crossed by one word only can't be told from its other direction */
+      for (s32 index = 0; index < w * h; ++index)
+        if (letters[index] && (words[0][index] == NO_WORD || words[1][index] == NO_WORD))
+        {
+          const word_id id = words[0][index] != NO_WORD ? words[0][index] : words[1][index];
+          add(CrosswordIssue::Kind::Unchecked, false, id, { index % w, index / w }, "cell is crossed by one word only");
+        }
+    }
+  };
+
+  /* what makes two schemes the same puzzle, hints may well be reworded */
+  utf8_string fingerprint(const CrosswordScheme& scheme)
+  {
+    utf8_string key = format("%dx%d", scheme.width(), scheme.height());
+
+    for (const CrosswordDefinition& def : scheme.definitions())
+      key += format(";%d,%d,%c:", def.position.x, def.position.y, def.orientation == Dir::Hor ? 'h' : 'v') + def.definition.text;
+
+    return key;
+  }
+}
+
+size_t CrosswordReport::errors() const
+{
+  return std::count_if(issues.begin(), issues.end(), [](const CrosswordIssue& issue) { return issue.error; });
+}
+
+const char* CrosswordValidator::name(CrosswordIssue::Kind kind)
+{
+  switch (kind)
+  {
+    case CrosswordIssue::Kind::Size: return "size";
+    case CrosswordIssue::Kind::Conflict: return "conflict";
+    case CrosswordIssue::Kind::OffGrid: return "off-grid";
+    case CrosswordIssue::Kind::Unchecked: return "unchecked";
+    case CrosswordIssue::Kind::Duplicate: return "duplicate";
+    case CrosswordIssue::Kind::Answer: return "answer";
+    case CrosswordIssue::Kind::Hint: return "hint";
+    case CrosswordIssue::Kind::Unknown: return "unknown";
+    case CrosswordIssue::Kind::Damaged: return "damaged";
+  }
+
+  return "";
+}
+
+CrosswordReport CrosswordValidator::validate(const CrosswordScheme& scheme) const
+{
+  CrosswordReport report;
+  Checker(scheme, report).run(_dictionary);
+  return report;
+}
+
+std::vector<CrosswordReport> CrosswordValidator::validate(const CrosswordPack& pack, ThreadPool& pool) const
+{
+  const u32 count = pack.size();
+  std::vector<CrosswordReport> reports(count);
+  std::vector<utf8_string> fingerprints(count);
+
+  for (u32 first = 0; first < count; first += CHUNK)
+  {
+    pool.submit([this, &pack, &reports, &fingerprints, first, count]() {
+      for (u32 i = first; i < std::min(first + CHUNK, count); ++i)
+      {
+        CrosswordScheme scheme(0, 0);
+
+        if (pack.scheme(i, scheme))
+        {
+          reports[i] = validate(scheme);
+          fingerprints[i] = fingerprint(scheme);
+        }
+        else
+          reports[i].issues.push_back({ CrosswordIssue::Kind::Damaged, true, NO_WORD, { -1, -1 }, "record doesn't fit where the scheme table puts it" });
+
+        reports[i].scheme = i;
+      }
+    });
+  }
+
+  pool.wait();
+
+  std::unordered_map<utf8_string, u32> seen;
+  for (u32 i = 0; i < count; ++i)
+  {
+    if (fingerprints[i].empty())
+      continue;
+
+    const auto inserted = seen.emplace(std::move(fingerprints[i]), i);
+    if (!inserted.second)
+      reports[i].issues.push_back({ CrosswordIssue::Kind::Duplicate, true, NO_WORD, { -1, -1 }, format("same scheme as %u", inserted.first->second) });
+  }
+
+  return reports;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Common.h"
+#include "games/Crossword.h"
+#include "games/CrosswordGrid.h"
+#include "games/Dictionary.h"
+
+#include <vector>
+
+class ThreadPool;
+
+namespace games
+{
+  class CrosswordPack;
+
+  struct CrosswordIssue
+  {
+    enum class Kind { Size, Conflict, OffGrid, Unchecked, Duplicate, Answer, Hint, Unknown, Damaged };
+
+    Kind kind;
+    bool error; // the scheme can't be played as meant, warnings are for whoever edits it
+    word_id word; // NO_WORD when it's about a cell or the whole scheme
+    Position cell; // -1, -1 when it's about a whole word
+    utf8_string detail;
+  };
+
+  struct CrosswordReport
+  {
+    u32 scheme;
+    std::vector<CrosswordIssue> issues;
+
+    CrosswordReport() : scheme(0) { }
+
+    size_t errors() const;
+    size_t warnings() const { return issues.size() - errors(); }
+  };
+
+  /* lints schemes before they are published, the grid itself places the answers
+     the same way but only counts the letters which disagree and keeps the first */
+  class CrosswordValidator
+  {
+  private:
+    const Dictionary* _dictionary;
+
+  public:
+    /* without a dictionary answers aren't looked up */
+    CrosswordValidator(const Dictionary* dictionary = nullptr) : _dictionary(dictionary) { }
+
+    CrosswordReport validate(const CrosswordScheme& scheme) const;
+
+    /* every scheme of the pack, in chunks over the pool, then schemes which repeat
+       an earlier one are reported; the reports are in the order of the pack */
+    std::vector<CrosswordReport> validate(const CrosswordPack& pack, ThreadPool& pool) const;
+
+    static const char* name(CrosswordIssue::Kind kind);
+  };
+}
@@ -0,0 +1,249 @@
+#pragma once
+
+#include "Common.h"
+#include "games/Crossword.h"
+
+#include <fstream>
+#include <vector>
+
+namespace games
+{
+  /* one bit for each word of a given length, set operations on these
+     are how crossword slots are matched against the dictionary */
+  using word_set = std::vector<u64>;
+
+  class Dictionary
+  {
+  public:
+    static constexpr s32 LETTERS = 26;
+    static constexpr utf8_char EMPTY = '\0';
+
+  private:
+    struct Bucket
+    {
+      size_t stride;
+      std::vector<u32> words;
+      std::vector<u64> masks;
+
+      Bucket() : stride(0) { }
+
+      const u64* mask(s32 position, s32 letter) const { return masks.data() + (position * LETTERS + letter) * stride; }
+      u64* mask(s32 position, s32 letter) { return masks.data() + (position * LETTERS + letter) * stride; }
+    };
+
+    std::vector<WordDefinition> _words;
+    std::vector<Bucket> _buckets;
+
+    const Bucket* bucket(s32 length) const { return length >= 0 && length < _buckets.size() ? &_buckets[length] : nullptr; }
+
+  public:
+    static s32 letterIndex(utf8_char c)
+    {
+      if (c >= 'A' && c <= 'Z')
+        c = c - 'A' + 'a';
+      return c >= 'a' && c <= 'z' ? c - 'a' : -1;
+    }
+
+    /* words must be made of plain letters only, they are stored lowercase */
+    bool add(const utf8_string& text, const utf8_string& hint)
+    {
+      if (text.length() < 2)
+        return false;
+
+      utf8_string word = text;
+      for (auto& c : word)
+      {
+        s32 letter = letterIndex(c);
+        if (letter == -1)
+          return false;
+        c = 'a' + letter;
+      }
+
+      _words.push_back({ word, hint });
+      return true;
+    }
+
+    /* one word per line, optionally followed by a tab and its hint */
+    bool load(const path& path)
+    {
+      std::ifstream in(path);
+
+      if (!in)
+        return false;
+
+      utf8_string line;
+      while (std::getline(in, line))
+      {
+        if (!line.empty() && line.back() == '\r')
+          line.pop_back();
+
+        auto tab = line.find('\t');
+        if (tab != utf8_string::npos)
+          add(line.substr(0, tab), line.substr(tab + 1));
+        else
+          add(line, "");
+      }
+
+      return true;
+    }
+
+    /* what a word keeps resident once built: its strings, its index in the bucket
+       and a bit in the mask of every letter at every position */
+    static size_t cost(const WordDefinition& word)
+    {
+      return sizeof(WordDefinition) + word.text.capacity() + word.hint.capacity() + sizeof(u32) + (word.text.length() * LETTERS + 7) / 8;
+    }
+
+    /* keeps only the words which fit in budget bytes, in the order they were added,
+       word lists usually come with the most common words first */
+    void build(size_t budget)
+    {
+      /* the costs miss the padding of the masks, what's over is trimmed again */
+      for (size_t target = budget; ; )
+      {
+        size_t used = 0, kept = 0;
+
+        while (kept < _words.size() && used + cost(_words[kept]) <= target)
+          used += cost(_words[kept++]);
+
+        _words.resize(kept);
+        _words.shrink_to_fit();
+        build();
+
+        const size_t bytes = memory();
+        if (bytes <= budget || _words.empty())
+          return;
+
+        target -= std::min(target, bytes - budget);
+      }
+    }
+
+    void build()
+    {
+      _buckets.clear();
+
+      for (u32 i = 0; i < _words.size(); ++i)
+      {
+        const auto length = _words[i].text.length();
+        if (length >= _buckets.size())
+          _buckets.resize(length + 1);
+        _buckets[length].words.push_back(i);
+      }
+
+      for (s32 length = 0; length < _buckets.size(); ++length)
+      {
+        Bucket& bucket = _buckets[length];
+        bucket.stride = (bucket.words.size() + 63) / 64;
+        bucket.masks.assign(bucket.stride * length * LETTERS, 0);
+
+        for (size_t bit = 0; bit < bucket.words.size(); ++bit)
+        {
+          const utf8_string& text = _words[bucket.words[bit]].text;
+          for (s32 p = 0; p < length; ++p)
+            bucket.mask(p, letterIndex(text[p]))[bit / 64] |= u64(1) << (bit % 64);
+        }
+      }
+    }
+
+    size_t size() const { return _words.size(); }
+
+    /* bytes held by the words and the index */
+    size_t memory() const
+    {
+      size_t bytes = _words.capacity() * sizeof(WordDefinition);
+
+      for (const WordDefinition& word : _words)
+        bytes += word.text.capacity() + word.hint.capacity();
+      for (const Bucket& bucket : _buckets)
+        bytes += sizeof(Bucket) + bucket.words.capacity() * sizeof(u32) + bucket.masks.capacity() * sizeof(u64);
+
+      return bytes;
+    }
+    const WordDefinition& word(u32 index) const { return _words[index]; }
+
+    s32 maxLength() const { return _buckets.empty() ? 0 : s32(_buckets.size()) - 1; }
+    size_t countForLength(s32 length) const { auto* b = bucket(length); return b ? b->words.size() : 0; }
+
+    /* translates a bit of a word_set of the given length back to the word index */
+    u32 wordAt(s32 length, size_t bit) const { return _buckets[length].words[bit]; }
+
+    void all(s32 length, word_set& set) const
+    {
+      const Bucket* b = bucket(length);
+
+      if (!b)
+      {
+        set.clear();
+        return;
+      }
+
+      set.assign(b->stride, ~u64(0));
+      if (b->words.size() % 64)
+        set.back() = (u64(1) << (b->words.size() % 64)) - 1;
+    }
+
+    /* removes from the set every word which doesn't have letter at position */
+    void restrict(s32 length, s32 position, utf8_char letter, word_set& set) const
+    {
+      const Bucket* b = bucket(length);
+      const s32 index = letterIndex(letter);
+
+      if (!b || index == -1)
+      {
+        std::fill(set.begin(), set.end(), 0);
+        return;
+      }
+
+      const u64* mask = b->mask(position, index);
+      for (size_t i = 0; i < set.size(); ++i)
+        set[i] &= mask[i];
+    }
+
+    /* pattern is length characters long, EMPTY for unconstrained positions */
+    void match(const utf8_char* pattern, s32 length, word_set& set) const
+    {
+      all(length, set);
+
+      for (s32 p = 0; p < length && !set.empty(); ++p)
+        if (pattern[p] != EMPTY)
+          restrict(length, p, pattern[p], set);
+    }
+
+    /* words of the set with letter at position, the set is left as it is */
+    size_t count(s32 length, s32 position, utf8_char letter, const word_set& set) const
+    {
+      const Bucket* b = bucket(length);
+      const s32 index = letterIndex(letter);
+
+      if (!b || index == -1)
+        return 0;
+
+      const u64* mask = b->mask(position, index);
+      size_t count = 0;
+      for (size_t i = 0; i < set.size(); ++i)
+        count += popcount(set[i] & mask[i]);
+      return count;
+    }
+
+    static size_t count(const word_set& set)
+    {
+      size_t count = 0;
+      for (u64 v : set)
+        count += popcount(v);
+      return count;
+    }
+
+    template<typename F> void forEach(s32 length, const word_set& set, F f) const
+    {
+      for (size_t i = 0; i < set.size(); ++i)
+      {
+        u64 v = set[i];
+        while (v)
+        {
+          f(wordAt(length, i * 64 + countTrailingZeros(v)));
+          v &= v - 1;
+        }
+      }
+    }
+  };
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Common.h"
+
+#include <functional>
+#include <vector>
+
+namespace games
+{
+  /* a candidate line of play, scores are from the side to move in centipawns */
+  template<typename M>
+  struct Line
+  {
+    std::vector<M> pv;
+    s32 score;
+    s32 mate; // moves to mate, negative when mated, 0 if none was found
+  };
+
+  /* searches a copy of the position on a background thread and reports the best
+     lines after every completed depth; what the search learns is kept across
+     positions, so analysis resumes quickly after each move of the user */
+  template<typename G>
+  class Analyzer
+  {
+  public:
+    using Move = typename G::Move;
+
+    struct Report
+    {
+      u32 depth;
+      u64 nodes;
+      std::vector<Line<Move>> lines; // best first
+    };
+
+    virtual ~Analyzer() { }
+
+    /* restarts on game, the previous report is dropped */
+    virtual void analyze(const G& game) = 0;
+    virtual void stop() = 0;
+
+    /* copies the latest report if it's newer than generation, which is updated */
+    virtual bool poll(u32& generation, Report& report) = 0;
+
+    virtual void setLines(u32 lines) = 0;
+
+    /* fraction of a core the search may use, it sleeps for the rest */
+    virtual void setBudget(float budget) = 0;
+  };
+
+  /* nullptr for games without an engine, notify is called from the search thread
+     whenever a report is ready */
+  template<typename G> Analyzer<G>* createAnalyzer(std::function<void()> notify) { return nullptr; }
+}
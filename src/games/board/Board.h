@@ -1,10 +1,13 @@
 #pragma once
 
 #include "Common.h"
+#include "Snapshot.h"
+#include "Trace.h"
 
 #include <array>
 #include <unordered_set>
 #include <unordered_map>
+#include <vector>
 
 namespace games
 {
@@ -69,17 +72,18 @@ namespace games
 
   protected:
     std::vector<Player> _players;
-    typename decltype(_players)::iterator _player;
+    size_t _player; // an index so that games can be copied
     B _board;
 
   public:
-    BoardGame()
+    BoardGame() : _player(0)
     {
       _players.push_back({ Color::White });
       _players.push_back({ Color::Black });
-      _player = _players.begin();
     }
 
+    virtual ~BoardGame() { }
+
     const Board& board() const { return _board; }
 
     typename B::Piece& get(point_t p) { return _board.get(p.x, p.y); }
@@ -88,8 +92,9 @@ namespace games
     size2d_t boardSize() const { return size2d_t(_board.width(), _board.height()); }
     bool isValid(point_t p) const { return p.x >= 0 && p.x < _board.width() && p.y >= 0 && p.y < _board.height(); }
 
-    void nextTurn() { ++_player; if (_player == _players.end()) _player = _players.begin(); }
-    const Player& currentPlayer() { return *_player; }
+    void nextTurn() { ++_player; if (_player == _players.size()) _player = 0; }
+    const Player& currentPlayer() const { return _players[_player]; }
+    void setCurrentPlayer(Color color) { _player = color == Color::White ? 0 : 1; }
     coord_t playerCount() const { return 2; }
 
     virtual void resetBoard() = 0;
@@ -97,8 +102,42 @@ namespace games
     virtual MoveResult pieceMoved(const Piece& piece, const Move& move) = 0;
     virtual MoveSet<Move> allowedMoves(const Piece& piece, point_t from) = 0;
 
+    /* the board is written as raw cells, games with more state append it */
+    virtual u32 snapshotTag() const = 0;
+
+    virtual void save(snapshot::Writer& out) const
+    {
+      const u32 cells = _board.width() * _board.height();
+
+      out.write(u32(sizeof(Piece)));
+      out.write(cells);
+      out.raw(&*_board.begin(), sizeof(Piece) * cells);
+      out.write(u32(_player));
+    }
+
+    /* on failure the game is left halfway and has to be reset */
+    virtual bool restore(snapshot::Reader& in)
+    {
+      u32 pieceSize, cells, player;
+
+      if (!in.read(pieceSize) || !in.read(cells) || pieceSize != sizeof(Piece) || cells != u32(_board.width() * _board.height()))
+        return false;
+
+      if (!in.raw(&*_board.begin(), sizeof(Piece) * cells) || !in.read(player) || player >= _players.size())
+        return false;
+
+      for (const Piece& piece : _board)
+        if (!piece.valid())
+          return false;
+
+      _player = player;
+      return true;
+    }
+
     virtual PlayerMoveSet<Move> allowedMoveSetForPlayer(const Player& player)
     {
+      TRACE_ZONE("move generation");
+
       PlayerMoveSet<Move> set;
 
       for (int y = 0; y < _board.height(); ++y)
@@ -16,12 +16,29 @@ namespace games
       Color color;
 
       Piece() : present(false) { }
-      Piece(Type type, Color color) : type(type), color(color) { }
+      Piece(Type type, Color color) : present(true), type(type), color(color) { }
 
       bool operator==(Color color) const { return present && this->color == color; }
+
+      /* for cells read back raw, nothing but present is set on an empty one */
+      bool valid() const { return snapshot::isBool(present) && (!present || (snapshot::inRange(type, Type::King) && snapshot::inRange(color, Color::Black))); }
     };
 
-    using Move = point_t;
+    struct Move
+    {
+      point_t from;
+      point_t to;
+
+      Move(const point_t& from, const point_t& to) : from(from), to(to) { }
+      bool operator==(const Move& o) const { return from == o.from && to == o.to; }
+
+      bool endsOn(const point_t& to) const { return this->to == to; }
+
+      struct hash
+      {
+        size_t operator()(const Move& m) const { return point_t::hash()(m.to); }
+      };
+    };
     
     class Game : public BoardGame<Board<8, 8, Piece, Move>>
     {
@@ -59,6 +76,8 @@ namespace games
       {
         return isValid(from) && get(from).present;
       }
+
+      u32 snapshotTag() const override { return snapshot::tag("CHKR"); }
     };
   }
 }
@@ -0,0 +1,825 @@
+#include "Chess.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+using namespace games;
+using namespace games::chess;
+
+namespace
+{
+  const std::array<point_t, 8> knightDeltas = { {
+    point_t(-2, -1), point_t(-2, +1), point_t(+2, -1), point_t(+2, +1),
+    point_t(-1, -2), point_t(+1, -2), point_t(-1, +2), point_t(+1, +2)
+  } };
+
+  const std::array<point_t, 8> kingDeltas = { {
+    point_t(-1, -1), point_t(0, -1), point_t(+1, -1), point_t(-1, 0),
+    point_t(+1, 0), point_t(-1, +1), point_t(0, +1), point_t(+1, +1)
+  } };
+
+  const std::array<point_t, 4> straightDeltas = { { point_t(-1, 0), point_t(1, 0), point_t(0, -1), point_t(0, 1) } };
+  const std::array<point_t, 4> diagonalDeltas = { { point_t(-1, -1), point_t(+1, -1), point_t(-1, +1), point_t(+1, +1) } };
+
+  const point_t none = point_t(-1, -1);
+
+  coord_t sign(coord_t v) { return (v > 0) - (v < 0); }
+
+  char letter(Piece::Type type)
+  {
+    switch (type)
+    {
+      case Piece::Type::Rook: return 'N';
+      case Piece::Type::Bishop: return 'B';
+      case Piece::Type::Castle: return 'R';
+      case Piece::Type::Queen: return 'Q';
+      case Piece::Type::King: return 'K';
+      default: return 'P';
+    }
+  }
+
+  /* uppercase SAN letters, FEN letters are lowered before */
+  bool pieceType(char c, Piece::Type& type)
+  {
+    switch (c)
+    {
+      case 'P': type = Piece::Type::Pawn; return true;
+      case 'N': type = Piece::Type::Rook; return true;
+      case 'B': type = Piece::Type::Bishop; return true;
+      case 'R': type = Piece::Type::Castle; return true;
+      case 'Q': type = Piece::Type::Queen; return true;
+      case 'K': type = Piece::Type::King; return true;
+      default: return false;
+    }
+  }
+
+  /* a pawn reaching the last rank can become any of these, the queen first */
+  const std::array<Piece::Type, 4> promotions = { { Piece::Type::Queen, Piece::Type::Castle, Piece::Type::Bishop, Piece::Type::Rook } };
+
+  void appendSquare(std::string& out, point_t square)
+  {
+    out += char('a' + square.x);
+    out += char('1' + square.y);
+  }
+}
+
+void Chess::pseudoMoves(const Piece& piece, point_t from, MoveSet<Move>& moves)
+{
+  if (piece.type == Piece::Type::Pawn)
+  {
+    const coord_t dy = piece.isWhite() ? +1 : -1;
+
+    /* by rank rather than hasMoved, so that it holds for positions loaded from FEN */
+    const coord_t start = piece.isWhite() ? 1 : 6;
+    const coord_t last = piece.isWhite() ? 7 : 0;
+
+    auto insert = [&moves, &from, last](point_t to) {
+      if (to.y == last)
+      {
+        for (Piece::Type type : promotions)
+          moves.insert(Move(from, to, Move::Type::Promotion, type));
+      }
+      else
+        moves.insert(Move(from, to));
+    };
+
+    point_t next = from + point_t(0, dy);
+
+    if (isValid(next) && get(next).isEmpty())
+    {
+      insert(next);
+
+      point_t next2 = from + point_t(0, 2*dy);
+
+      if (from.y == start && get(next2).isEmpty())
+        moves.insert(Move(from, next2));
+    }
+
+    for (coord_t dx : { -1, +1 })
+    {
+      point_t to = from + point_t(dx, dy);
+
+      if (!isValid(to))
+        continue;
+      else if (get(to).present && get(to).color != piece.color)
+        insert(to);
+      else if (to == _enPassant)
+        moves.insert(Move(from, to, Move::Type::EnPassant));
+    }
+  }
+
+  if (piece.type == Piece::Type::Castle || piece.type == Piece::Type::Queen || piece.type == Piece::Type::Bishop)
+  {
+    const bool straight = piece.type != Piece::Type::Bishop, diagonal = piece.type != Piece::Type::Castle;
+
+    for (const auto& d : straightDeltas)
+      for (point_t next = from + d; straight && isValid(next); next += d)
+      {
+        if (get(next).isEmpty() || get(next).color != piece.color)
+          moves.insert(Move(from, next));
+        if (get(next).present)
+          break;
+      }
+
+    for (const auto& d : diagonalDeltas)
+      for (point_t next = from + d; diagonal && isValid(next); next += d)
+      {
+        if (get(next).isEmpty() || get(next).color != piece.color)
+          moves.insert(Move(from, next));
+        if (get(next).present)
+          break;
+      }
+  }
+
+  if (piece.type == Piece::Type::King)
+  {
+    for (const auto& d : kingDeltas)
+    {
+      point_t next = from + d;
+      if (isValid(next) && (get(next).isEmpty() || get(next).color != piece.color))
+        moves.insert(Move(from, next));
+    }
+
+    /* castling, the king can't leave, cross or land on an attacked square */
+    if (!piece.hasMoved && !isAttacked(from, opponent(piece.color)))
+    {
+      std::array<coord_t, 2> sides = { _board.firstColumn(), _board.lastColumn() };
+      for (coord_t x : sides)
+      {
+        Piece& castle = get({ x, from.y });
+
+        if (!castle.isEmpty() && castle == piece.color && castle.type == Piece::Type::Castle && !castle.hasMoved)
+        {
+          bool allEmpty = true;
+          for (coord_t xx = std::min(x, from.x) + 1; xx < std::max(x, from.x); ++xx)
+            allEmpty &= get({ xx, from.y }).isEmpty();
+
+          const point_t crossed = { x == 0 ? from.x - 1 : from.x + 1, from.y };
+
+          if (allEmpty && !isAttacked(crossed, opponent(piece.color)))
+            moves.insert(Move(from, { x == 0 ? from.x - 2 : from.x + 2, from.y }, Move::Type::Castling));
+        }
+      }
+    }
+  }
+
+  if (piece.type == Piece::Type::Rook)
+  {
+    for (const auto& delta : knightDeltas)
+    {
+      point_t next = from + delta;
+
+      if (isValid(next) && (get(next).isEmpty() || get(next).color != piece.color))
+        moves.insert(Move(from, next));
+    }
+  }
+}
+
+bool Chess::reaches(const Piece& piece, point_t from, point_t to) const
+{
+  const coord_t dx = to.x - from.x, dy = to.y - from.y;
+  const coord_t adx = std::abs(dx), ady = std::abs(dy);
+
+  switch (piece.type)
+  {
+    case Piece::Type::Rook: return (adx == 1 && ady == 2) || (adx == 2 && ady == 1);
+    case Piece::Type::King: return std::max(adx, ady) == 1;
+    case Piece::Type::Castle: if ((dx == 0) == (dy == 0)) return false; break;
+    case Piece::Type::Bishop: if (adx != ady || adx == 0) return false; break;
+    case Piece::Type::Queen: if (((dx == 0) == (dy == 0)) && (adx != ady || adx == 0)) return false; break;
+    case Piece::Type::Pawn: return false;
+  }
+
+  const point_t step = point_t(sign(dx), sign(dy));
+
+  for (point_t p = from + step; p != to; p += step)
+    if (get(p).present)
+      return false;
+
+  return true;
+}
+
+bool Chess::isAttacked(point_t square, Color by) const
+{
+  if (!isValid(square))
+    return false;
+
+  /* pawns of by capture towards the opponent, so they sit one row behind the square */
+  const coord_t pdy = by == Color::White ? -1 : +1;
+
+  for (coord_t dx : { -1, +1 })
+  {
+    const point_t p = square + point_t(dx, pdy);
+    if (isValid(p) && get(p).is(Piece::Type::Pawn, by))
+      return true;
+  }
+
+  for (const auto& d : knightDeltas)
+  {
+    const point_t p = square + d;
+    if (isValid(p) && get(p).is(Piece::Type::Rook, by))
+      return true;
+  }
+
+  for (const auto& d : kingDeltas)
+  {
+    const point_t p = square + d;
+    if (isValid(p) && get(p).is(Piece::Type::King, by))
+      return true;
+  }
+
+  for (const auto& d : straightDeltas)
+    for (point_t p = square + d; isValid(p); p += d)
+      if (get(p).present)
+      {
+        if (get(p).is(Piece::Type::Castle, by) || get(p).is(Piece::Type::Queen, by))
+          return true;
+        break;
+      }
+
+  for (const auto& d : diagonalDeltas)
+    for (point_t p = square + d; isValid(p); p += d)
+      if (get(p).present)
+      {
+        if (get(p).is(Piece::Type::Bishop, by) || get(p).is(Piece::Type::Queen, by))
+          return true;
+        break;
+      }
+
+  return false;
+}
+
+point_t Chess::findKing(Color color) const
+{
+  for (coord_t y = 0; y < _board.height(); ++y)
+    for (coord_t x = 0; x < _board.width(); ++x)
+      if (get({ x, y }).is(Piece::Type::King, color))
+        return { x, y };
+
+  return none;
+}
+
+Chess::Undo Chess::apply(const Piece& held, const Move& move)
+{
+  /* held may be a reference into the board itself */
+  const Piece piece = held;
+  Undo undo = { move.from, move.to, none, get(move.from), get(move.to), Piece() };
+
+  if (move.type == Move::Type::EnPassant)
+  {
+    undo.captured = point_t(move.to.x, move.from.y);
+    undo.capturedPiece = get(undo.captured);
+    get(undo.captured) = Piece();
+  }
+
+  get(move.from) = Piece();
+  get(move.to) = piece;
+
+  return undo;
+}
+
+void Chess::restore(const Undo& undo)
+{
+  get(undo.to) = undo.toPiece;
+  get(undo.from) = undo.fromPiece;
+
+  if (undo.captured != none)
+    get(undo.captured) = undo.capturedPiece;
+}
+
+bool Chess::isLegal(const Piece& held, const Move& move)
+{
+  const Piece piece = held;
+  const Undo undo = apply(piece, move);
+  const point_t king = piece.type == Piece::Type::King ? move.to : findKing(piece.color);
+  const bool legal = !isAttacked(king, opponent(piece.color));
+  restore(undo);
+
+  return legal;
+}
+
+MoveSet<Move> Chess::allowedMoves(const Piece& piece, point_t from)
+{
+  MoveSet<Move> moves;
+  pseudoMoves(piece, from, moves);
+
+  for (auto it = moves.begin(); it != moves.end(); )
+  {
+    if (isLegal(piece, *it))
+      ++it;
+    else
+      it = moves.erase(it);
+  }
+
+  return moves;
+}
+
+bool Chess::hasLegalMoves()
+{
+  const Color color = currentPlayer().color;
+  MoveSet<Move> moves;
+
+  for (coord_t y = 0; y < _board.height(); ++y)
+    for (coord_t x = 0; x < _board.width(); ++x)
+    {
+      const Piece piece = get({ x, y });
+
+      if (piece == color)
+      {
+        moves.clear();
+        pseudoMoves(piece, { x, y }, moves);
+
+        for (const Move& move : moves)
+          if (isLegal(piece, move))
+            return true;
+      }
+    }
+
+  return false;
+}
+
+void Chess::makeMove(const Move& move)
+{
+  Piece piece = get(move.from);
+  const bool capture = get(move.to).present || move.type == Move::Type::EnPassant;
+
+  _history.push_back(move);
+
+  if (piece.type == Piece::Type::Pawn || capture)
+    _halfmoveClock = 0;
+  else
+    ++_halfmoveClock;
+
+  if (move.type == Move::Type::EnPassant)
+    get({ move.to.x, move.from.y }) = Piece();
+  else if (move.type == Move::Type::Castling)
+  {
+    if (move.to.x == 2)
+    {
+      get({ 3, move.to.y }) = get({ _board.firstColumn(), move.to.y });
+      get({ _board.firstColumn(), move.to.y }) = Piece();
+      get({ 3, move.to.y }).hasMoved = true;
+    }
+    else if (move.to.x == 6)
+    {
+      get({ 5, move.to.y }) = get({ _board.lastColumn(), move.to.y });
+      get({ _board.lastColumn(), move.to.y }) = Piece();
+      get({ 5, move.to.y }).hasMoved = true;
+    }
+  }
+  else if (move.type == Move::Type::Promotion)
+    piece.type = move.promotion;
+
+  piece.hasMoved = true;
+  get(move.from) = Piece();
+  get(move.to) = piece;
+
+  if (piece.type == Piece::Type::Pawn && std::abs(move.to.y - move.from.y) == 2)
+    _enPassant = point_t(move.from.x, (move.from.y + move.to.y) / 2);
+  else
+    _enPassant = none;
+
+  if (piece.color == Color::Black)
+    ++_fullmove;
+}
+
+bool Chess::loadFen(const char* fen, size_t length)
+{
+  const char* it = fen;
+  const char* end = fen + length;
+
+  auto field = [&it, end]() {
+    while (it != end && *it == ' ')
+      ++it;
+    const char* start = it;
+    while (it != end && *it != ' ')
+      ++it;
+    return std::make_pair(start, it);
+  };
+
+  Board board;
+  std::fill(board.begin(), board.end(), Piece());
+
+  /* placement, from the 8th rank down */
+  const auto placement = field();
+  coord_t x = 0, y = _board.lastRow();
+
+  for (const char* c = placement.first; c != placement.second; ++c)
+  {
+    Piece::Type type;
+
+    if (*c == '/')
+    {
+      if (x != _board.width() || y == 0)
+        return false;
+      x = 0;
+      --y;
+    }
+    else if (*c >= '1' && *c <= '8')
+      x += *c - '0';
+    else if (x < _board.width() && pieceType(char(toupper(*c)), type))
+    {
+      /* a pawn on the first or last rank can't have got there, move generation assumes it */
+      if (type == Piece::Type::Pawn && (y == _board.firstRow() || y == _board.lastRow()))
+        return false;
+
+      board.get(x, y) = Piece(type, isupper(*c) ? Color::White : Color::Black);
+      board.get(x, y).hasMoved = !(type == Piece::Type::Pawn && y == (isupper(*c) ? 1 : 6));
+      ++x;
+    }
+    else
+      return false;
+
+    if (x > _board.width())
+      return false;
+  }
+
+  if (x != _board.width() || y != 0)
+    return false;
+
+  u32 kings[2] = { 0, 0 };
+  for (const Piece& piece : board)
+    if (piece.present && piece.type == Piece::Type::King)
+      ++kings[piece.isWhite() ? 0 : 1];
+
+  if (kings[0] != 1 || kings[1] != 1)
+    return false;
+
+  const auto side = field();
+  if (side.second - side.first != 1 || (*side.first != 'w' && *side.first != 'b'))
+    return false;
+
+  /* the side which just moved can't have left its king in check */
+  const Color player = *side.first == 'w' ? Color::White : Color::Black;
+  Chess probe;
+  probe._board = board;
+
+  if (probe.inCheck(opponent(player)))
+    return false;
+
+  /* the rights become the hasMoved flags of kings and rooks which are still home */
+  const auto castling = field();
+  for (const char* c = castling.first; c != castling.second; ++c)
+  {
+    if (*c == '-')
+      continue;
+
+    const Color color = isupper(*c) ? Color::White : Color::Black;
+    const coord_t home = color == Color::White ? 0 : 7;
+    const char right = char(toupper(*c));
+
+    if (right != 'K' && right != 'Q')
+      return false;
+
+    Piece& king = board.get(4, home);
+    Piece& castle = board.get(right == 'K' ? 7 : 0, home);
+
+    if (king.is(Piece::Type::King, color) && castle.is(Piece::Type::Castle, color))
+    {
+      king.hasMoved = false;
+      castle.hasMoved = false;
+    }
+  }
+
+  point_t enPassant = none;
+  const auto square = field();
+  if (square.second - square.first == 2 && square.first[0] >= 'a' && square.first[0] <= 'h' && square.first[1] >= '1' && square.first[1] <= '8')
+  {
+    enPassant = point_t(square.first[0] - 'a', square.first[1] - '1');
+
+    /* behind a pawn of the side which just moved */
+    if (enPassant.y != (player == Color::White ? 5 : 2))
+      return false;
+  }
+  else if (square.second - square.first != 1 || *square.first != '-')
+    return false;
+
+  /* the counters are often left out, EPD for instance */
+  const auto halfmove = field();
+  const auto fullmove = field();
+
+  _board = board;
+  setCurrentPlayer(player);
+  _enPassant = enPassant;
+  _halfmoveClock = halfmove.first != halfmove.second ? u32(atoi(std::string(halfmove.first, halfmove.second).c_str())) : 0;
+  _fullmove = fullmove.first != fullmove.second ? std::max(1, atoi(std::string(fullmove.first, fullmove.second).c_str())) : 1;
+  _startFen.assign(fen, length);
+  _history.clear();
+
+  return true;
+}
+
+std::string Chess::fen() const
+{
+  std::string out;
+
+  for (coord_t y = _board.lastRow(); y >= 0; --y)
+  {
+    int empty = 0;
+
+    for (coord_t x = 0; x < _board.width(); ++x)
+    {
+      const Piece& piece = get({ x, y });
+
+      if (piece.isEmpty())
+        ++empty;
+      else
+      {
+        if (empty)
+          out += char('0' + empty);
+        empty = 0;
+
+        out += piece.isWhite() ? letter(piece.type) : char(tolower(letter(piece.type)));
+      }
+    }
+
+    if (empty)
+      out += char('0' + empty);
+    if (y > 0)
+      out += '/';
+  }
+
+  out += currentPlayer().color == Color::White ? " w " : " b ";
+
+  const size_t rights = out.size();
+  for (Color color : { Color::White, Color::Black })
+  {
+    const coord_t home = color == Color::White ? 0 : 7;
+    const Piece& king = get({ 4, home });
+
+    if (!king.is(Piece::Type::King, color) || king.hasMoved)
+      continue;
+
+    for (coord_t x : { 7, 0 })
+    {
+      const Piece& castle = get({ x, home });
+      if (castle.is(Piece::Type::Castle, color) && !castle.hasMoved)
+        out += color == Color::White ? (x ? 'K' : 'Q') : (x ? 'k' : 'q');
+    }
+  }
+
+  if (out.size() == rights)
+    out += '-';
+
+  out += ' ';
+  if (_enPassant != none)
+    appendSquare(out, _enPassant);
+  else
+    out += '-';
+
+  out += ' ' + std::to_string(_halfmoveClock) + ' ' + std::to_string(_fullmove);
+
+  return out;
+}
+
+std::string Chess::san(const Move& move)
+{
+  const Piece piece = get(move.from);
+  std::string out;
+
+  if (move.type == Move::Type::Castling)
+    out = move.to.x > move.from.x ? "O-O" : "O-O-O";
+  else
+  {
+    const bool capture = get(move.to).present || move.type == Move::Type::EnPassant;
+
+    if (piece.type == Piece::Type::Pawn)
+    {
+      if (capture)
+        out += char('a' + move.from.x);
+    }
+    else
+    {
+      out += letter(piece.type);
+
+      /* other pieces of the same kind which could legally go to the same square */
+      bool ambiguous = false, sameFile = false, sameRank = false;
+
+      for (coord_t y = 0; y < _board.height(); ++y)
+        for (coord_t x = 0; x < _board.width(); ++x)
+        {
+          const point_t other = { x, y };
+
+          if (other != move.from && get(other).is(piece.type, piece.color) && reaches(piece, other, move.to) && isLegal(piece, Move(other, move.to)))
+          {
+            ambiguous = true;
+            sameFile |= other.x == move.from.x;
+            sameRank |= other.y == move.from.y;
+          }
+        }
+
+      if (ambiguous && (!sameFile || sameRank))
+        out += char('a' + move.from.x);
+      if (ambiguous && sameFile)
+        out += char('1' + move.from.y);
+    }
+
+    if (capture)
+      out += 'x';
+
+    appendSquare(out, move.to);
+
+    if (move.type == Move::Type::Promotion)
+    {
+      out += '=';
+      out += letter(move.promotion);
+    }
+  }
+
+  Chess after = *this;
+  after.play(move);
+
+  if (after.inCheck(after.currentPlayer().color))
+    out += after.hasLegalMoves() ? '+' : '#';
+
+  return out;
+}
+
+bool Chess::parseSan(const char* san, size_t length, Move& move)
+{
+  while (length && strchr("+#!?", san[length - 1]))
+    --length;
+
+  const Color color = currentPlayer().color;
+  const coord_t home = color == Color::White ? 0 : 7;
+
+  if ((length == 3 || length == 5) && (san[0] == 'O' || san[0] == '0'))
+  {
+    const bool queenside = length == 5;
+    const point_t from = { 4, home }, to = { queenside ? 2 : 6, home };
+
+    if (!get(from).is(Piece::Type::King, color))
+      return false;
+
+    const Piece king = get(from);
+    MoveSet<Move> moves;
+    pseudoMoves(king, from, moves);
+
+    move = Move(from, to, Move::Type::Castling);
+    return moves.find(move) != moves.end() && isLegal(king, move);
+  }
+
+  Piece::Type promotion = Piece::Type::Queen;
+  bool promotes = false;
+
+  /* e8=Q, also e8Q which some exporters write */
+  if (length >= 3 && pieceType(san[length - 1], promotion) && promotion != Piece::Type::Pawn && promotion != Piece::Type::King)
+  {
+    promotes = true;
+    length -= san[length - 2] == '=' ? 2 : 1;
+  }
+
+  if (length < 2 || san[length - 2] < 'a' || san[length - 2] > 'h' || san[length - 1] < '1' || san[length - 1] > '8')
+    return false;
+
+  const point_t to = { san[length - 2] - 'a', san[length - 1] - '1' };
+  length -= 2;
+
+  Piece::Type type = Piece::Type::Pawn;
+  size_t i = 0;
+
+  if (length && isupper(san[0]))
+  {
+    if (!pieceType(san[0], type))
+      return false;
+    i = 1;
+  }
+
+  coord_t fromFile = -1, fromRank = -1;
+
+  for (; i < length; ++i)
+  {
+    if (san[i] >= 'a' && san[i] <= 'h')
+      fromFile = san[i] - 'a';
+    else if (san[i] >= '1' && san[i] <= '8')
+      fromRank = san[i] - '1';
+    else if (san[i] != 'x' && san[i] != ':' && san[i] != '-')
+      return false;
+  }
+
+  if (get(to) == color)
+    return false;
+
+  if (type == Piece::Type::Pawn)
+  {
+    const coord_t dy = color == Color::White ? +1 : -1;
+    const coord_t last = color == Color::White ? 7 : 0;
+    point_t from = none;
+    Move::Type kind = Move::Type::Movement;
+
+    if (fromFile != -1 && fromFile != to.x)
+    {
+      from = point_t(fromFile, to.y - dy);
+
+      if (std::abs(fromFile - to.x) != 1)
+        return false;
+      else if (to == _enPassant && get(to).isEmpty())
+        kind = Move::Type::EnPassant;
+      else if (get(to).isEmpty())
+        return false;
+    }
+    else if (get(to).isEmpty())
+    {
+      from = point_t(to.x, to.y - dy);
+
+      if (isValid(from) && get(from).isEmpty() && to.y == home + 3 * dy)
+        from = point_t(to.x, to.y - 2 * dy);
+    }
+
+    if (!isValid(from) || !get(from).is(Piece::Type::Pawn, color) || promotes != (to.y == last))
+      return false;
+
+    move = Move(from, to, promotes ? Move::Type::Promotion : kind, promotion);
+
+    /* pawn moves are never ambiguous, but a pinned pawn still can't move */
+    return isLegal(get(from), move);
+  }
+
+  /* candidates are found walking back from the destination, by geometry only,
+     then legality drops the pinned ones and the king moving into check */
+  point_t candidates[10];
+  size_t count = 0;
+
+  auto consider = [&](point_t p) {
+    if ((fromFile == -1 || p.x == fromFile) && (fromRank == -1 || p.y == fromRank) && get(p).is(type, color) && count < 10)
+      candidates[count++] = p;
+  };
+
+  if (type == Piece::Type::Rook || type == Piece::Type::King)
+  {
+    for (const auto& d : type == Piece::Type::Rook ? knightDeltas : kingDeltas)
+      if (isValid(to + d))
+        consider(to + d);
+  }
+  else
+  {
+    auto ray = [&](point_t d) {
+      point_t p = to + d;
+      while (isValid(p) && get(p).isEmpty())
+        p += d;
+      if (isValid(p))
+        consider(p);
+    };
+
+    if (type != Piece::Type::Bishop)
+      for (const auto& d : straightDeltas)
+        ray(d);
+    if (type != Piece::Type::Castle)
+      for (const auto& d : diagonalDeltas)
+        ray(d);
+  }
+
+  size_t legal = 0;
+  for (size_t c = 0; c < count; ++c)
+    if (isLegal(get(candidates[c]), Move(candidates[c], to)))
+      candidates[legal++] = candidates[c];
+
+  if (legal != 1)
+    return false;
+
+  move = Move(candidates[0], to);
+  return true;
+}
+
+void Chess::save(snapshot::Writer& out) const
+{
+  BoardGame::save(out);
+
+  out.write(_enPassant);
+  out.write(_halfmoveClock);
+  out.write(_fullmove);
+
+  out.write(u32(_startFen.size()));
+  out.raw(_startFen.data(), _startFen.size());
+
+  out.write(u32(sizeof(Move)));
+  out.write(u32(_history.size()));
+  out.raw(_history.data(), sizeof(Move) * _history.size());
+}
+
+bool Chess::restore(snapshot::Reader& in)
+{
+  u32 fenLength, moveSize, moves;
+
+  if (!BoardGame::restore(in) || !in.read(_enPassant) || !in.read(_halfmoveClock) || !in.read(_fullmove) || !in.read(fenLength) || fenLength > snapshot::CAPACITY)
+    return false;
+
+  /* only ever behind a pawn which just advanced by two */
+  if (_enPassant != none && (!isValid(_enPassant) || (_enPassant.y != 2 && _enPassant.y != 5)))
+    return false;
+
+  _startFen.resize(fenLength);
+  if (!in.raw(&_startFen[0], fenLength) || !in.read(moveSize) || !in.read(moves) || moveSize != sizeof(Move) || moves > snapshot::CAPACITY / sizeof(Move))
+    return false;
+
+  _history.assign(moves, Move(none, none));
+  if (!in.raw(_history.data(), sizeof(Move) * moves))
+    return false;
+
+  /* the history is replayed to write notation, so its moves have to be ones the game could have made */
+  return std::all_of(_history.begin(), _history.end(), [this](const Move& move) {
+    return snapshot::inRange(move.type, Move::Type::EnPassant) && isValid(move.from) && isValid(move.to) &&
+      (move.type != Move::Type::Promotion || (snapshot::inRange(move.promotion, Piece::Type::King) && move.promotion != Piece::Type::Pawn && move.promotion != Piece::Type::King));
+  });
+}
@@ -3,10 +3,15 @@
 #include "Common.h"
 #include "games/board/Board.h"
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 namespace games
 {
   namespace chess
   {
+    /* Rook is the knight and Castle is the rook, notation code maps them to N and R */
     struct Piece
     {
       enum class Type
@@ -26,20 +31,30 @@ namespace games
       bool isWhite() const { return color == Color::White; }
       bool isEmpty() const { return !present; }
 
+      bool is(Type type, Color color) const { return present && this->type == type && this->color == color; }
+
       bool operator==(Color color) const { return present && this->color == color; }
 
+      /* for cells read back raw, nothing but present is set on an empty one */
+      bool valid() const
+      {
+        return snapshot::isBool(present) && (!present || (snapshot::isBool(hasMoved) && snapshot::inRange(type, Type::King) && snapshot::inRange(color, Color::Black)));
+      }
     };
 
+    inline Color opponent(Color color) { return color == Color::White ? Color::Black : Color::White; }
+
     struct Move
     {
-      enum class Type { Movement, Castling, Promotion };
-      
+      enum class Type { Movement, Castling, Promotion, EnPassant };
+
       Type type;
       point_t from;
       point_t to;
+      Piece::Type promotion; // only for Type::Promotion
 
-      Move(const point_t& from, const point_t& to, Type type = Type::Castling) : from(from), to(to), type(type) { }
-      bool operator==(const Move& o) const { return type == o.type && from == o.from && to == o.to; }
+      Move(const point_t& from, const point_t& to, Type type = Type::Movement, Piece::Type promotion = Piece::Type::Queen) : from(from), to(to), type(type), promotion(promotion) { }
+      bool operator==(const Move& o) const { return type == o.type && from == o.from && to == o.to && (type != Type::Promotion || promotion == o.promotion); }
 
       bool endsOn(const point_t& to) const { return this->to == to; }
 
@@ -52,9 +67,35 @@ namespace games
     class Chess : public BoardGame<games::Board<8, 8, Piece, Move>>
     {
     protected:
+      /* square a pawn which just advanced by two can be captured on, (-1, -1) if none */
+      point_t _enPassant;
+      u32 _halfmoveClock;
+      u32 _fullmove;
+
+      /* what the game started from, empty for the initial position, and what was played since */
+      std::string _startFen;
+      std::vector<Move> _history;
+
+      void pseudoMoves(const Piece& piece, point_t from, MoveSet<Move>& moves);
+
+      /* whether a piece of the given type and color on from attacks to, ignoring pins */
+      bool reaches(const Piece& piece, point_t from, point_t to) const;
+
+      point_t findKing(Color color) const;
 
+      /* the board as it is after the move, undone by restore */
+      struct Undo
+      {
+        point_t from, to, captured;
+        Piece fromPiece, toPiece, capturedPiece;
+      };
+
+      Undo apply(const Piece& piece, const Move& move);
+      void restore(const Undo& undo);
 
     public:
+      Chess() : _enPassant(-1, -1), _halfmoveClock(0), _fullmove(1) { }
+
       void resetBoard() override
       {
         std::array<Piece::Type, 8> row = {
@@ -72,179 +113,73 @@ namespace games
           _board.get(i, _board.lastRow()) = { row[i], Color::Black };
           _board.get(i, _board.lastRow() - 1) = { Piece::Type::Pawn, Color::Black };
         }
+
+        setCurrentPlayer(Color::White);
+        _enPassant = point_t(-1, -1);
+        _halfmoveClock = 0;
+        _fullmove = 1;
+        _startFen.clear();
+        _history.clear();
       }
 
+      /* the piece may be held by the UI, so it's passed instead of being read from move.from */
       MoveResult pieceMoved(const Piece& piece, const Move& move) override
       {
         auto moves = allowedMoves(piece, move.from);
 
-        //TODO: inefficient, allowedMoves called also from UI
-        if (moves.find(move) != moves.end())
-        {
-          get(move.to) = piece;
-          get(move.to).hasMoved = true;
-
-          if (move.type == Move::Type::Castling)
-          {
-            if (move.to.x == 2)
-            {
-              get({ 3, move.to.y }) = get({ _board.firstColumn(), move.to.y });
-              get({ _board.firstColumn(), move.to.y }) = Piece();
-              get({ 3, move.to.y }).hasMoved = true;
-            }
-            else if (move.to.x == 6)
-            {
-              get({ 5, move.to.y }) = get({ _board.lastColumn(), move.to.y });
-              get({ _board.lastColumn(), move.to.y }) = Piece();
-              get({ 5, move.to.y }).hasMoved = true;
-            }
-          }
-
+        /* the UI doesn't know the kind of move, the generated one is played; it can't pick a piece either, so pawns become queens */
+        auto it = std::find_if(moves.begin(), moves.end(), [&move](const Move& m) {
+          return m.from == move.from && m.to == move.to && (m.type != Move::Type::Promotion || m.promotion == Piece::Type::Queen);
+        });
 
+        if (it != moves.end())
+        {
+          get(move.from) = piece;
+          makeMove(*it);
           return MoveResult();
         }
         else
           return MoveResult(false);
       }
 
-      MoveSet<Move> allowedMoves(const Piece& piece, point_t from) override
-      {
-        MoveSet<Move> moves;
-
-        if (piece.type == Piece::Type::Pawn)
-        {
-          coord_t dy = piece.isWhite() ? +1 : -1;
-
-          point_t next = from + point_t(0, dy);
-
-          if (isValid(next) && get(next).isEmpty())
-            moves.insert(Move(from, next));
+      /* legal moves only, the king is never left in check */
+      MoveSet<Move> allowedMoves(const Piece& piece, point_t from) override;
 
-          if (!piece.hasMoved)
-          {
-            point_t next2 = from + point_t(0, 2*dy);
-
-            if (isValid(next2)  && get(next).isEmpty() && get(next2).isEmpty())
-              moves.insert(Move(from, next2));
-          }
+      bool canPickupPiece(point_t from) override
+      {
+        return isValid(from) && get(from).present && get(from).color == currentPlayer().color;
+      }
 
-          auto& c1 = get(from + point_t(-1, dy));
-          auto& c2 = get(from + point_t(+1, dy));
+      bool isAttacked(point_t square, Color by) const;
+      bool inCheck(Color color) const { return isAttacked(findKing(color), opponent(color)); }
+      bool isLegal(const Piece& piece, const Move& move);
+      bool hasLegalMoves();
 
-          if (c1.present && c1.color != piece.color)
-            moves.insert(Move(from, from + point_t(-1, dy)));
+      /* updates the board and the counters but doesn't change turn, the move must be legal */
+      void makeMove(const Move& move);
+      void play(const Move& move) { makeMove(move); nextTurn(); }
 
-          if (c2.present && c2.color != piece.color)
-            moves.insert(Move(from, from + point_t(+1, dy)));
-        }
-        
-        if (piece.type == Piece::Type::Castle || piece.type == Piece::Type::Queen)
-        {
-          const std::array<point_t, 4> delta =
-          {
-            point_t(-1, 0), point_t(1, 0),
-            point_t(0, -1), point_t(0, 1)
-          };
-
-          for (const auto& d : delta)
-          {
-            point_t next = from + d;
-
-            bool wasEmpty = true;
-            while (isValid(next) && (get(next).isEmpty() || (wasEmpty && get(next).color != piece.color)))
-            {
-              wasEmpty = get(next).isEmpty();
-              moves.insert(Move(from, next));
-              next += d;
-
-              if (!wasEmpty)
-                break;
-            }
-          }
-        }
+      point_t enPassant() const { return _enPassant; }
+      u32 halfmoveClock() const { return _halfmoveClock; }
+      u32 fullmove() const { return _fullmove; }
 
-        if (piece.type == Piece::Type::Bishop || piece.type == Piece::Type::Queen)
-        {
-          const std::array<point_t, 4> delta =
-          {
-            point_t(-1, -1), point_t(+1, -1),
-            point_t(-1, +1), point_t(+1, +1)
-          };
-
-          for (const auto& d : delta)
-          {
-            point_t next = from + d;
-
-            bool wasEmpty = true;
-            while (isValid(next) && (get(next).isEmpty() || (wasEmpty && get(next).color != piece.color)))
-            {
-              wasEmpty = get(next).isEmpty();
-              moves.insert(Move(from, next));
-              next += d;
-
-              if (!wasEmpty)
-                break;
-            }
-          }
-        }
+      u32 snapshotTag() const override { return snapshot::tag("CHES"); }
+      void save(snapshot::Writer& out) const override;
+      bool restore(snapshot::Reader& in) override;
 
-        if (piece.type == Piece::Type::King)
-        {
-          for (coord_t dx = -1; dx <= 1; ++dx)
-            for (coord_t dy = -1; dy <= 1; ++dy)
-            {
-              if (dx != 0 || dy != 0)
-              {
-                point_t next = from + point_t(dx, dy);
-                if (isValid(next) && (get(next).isEmpty() || get(next).color != piece.color))
-                  moves.insert(Move(from, next));
-              }
-            }
-
-          /* castling */
-          if (!piece.hasMoved)
-          {
-            std::array<coord_t, 2> sides = { _board.firstColumn(), _board.lastColumn() };
-            for (coord_t x : sides)
-            {
-              Piece& castle = get({ x, from.y });
-
-              if (!castle.isEmpty() && castle == piece.color && castle.type == Piece::Type::Castle && !castle.hasMoved)
-              {
-                bool allEmpty = true;
-                for (coord_t xx = std::min(x, from.x) + 1; xx < std::max(x, from.x); ++xx)
-                  allEmpty &= get({ xx, from.y }).isEmpty();
-                //TODO: check king won't get mated
-                if (allEmpty)
-                  moves.insert(Move(from, { x == 0 ? from.x - 2 : from.x + 2, from.y }, Move::Type::Castling));
-              }
-            }
-          }
-        }
+      const std::string& startFen() const { return _startFen; }
+      const std::vector<Move>& history() const { return _history; }
 
-        if (piece.type == Piece::Type::Rook)
-        {
-          std::array<point_t, 8> deltas = {
-            point_t(-2, -1), point_t(-2, +1), point_t(+2, -1), point_t(+2, +1),
-            point_t(-1, -2), point_t(+1, -2), point_t(-1, +2), point_t(+1, +2)
-          };
-
-          for (const auto& delta : deltas)
-          {
-            point_t next = from + delta;
-
-            if (isValid(next) && (get(next).isEmpty() || get(next).color != piece.color))
-              moves.insert(Move(from, next));
-          }
-        }
+      /* Forsyth-Edwards notation, on failure the game is left as it was */
+      bool loadFen(const char* fen, size_t length);
+      bool loadFen(const std::string& fen) { return loadFen(fen.data(), fen.size()); }
+      std::string fen() const;
 
-        return moves;
-      }
+      /* standard algebraic notation of a legal move in the current position, check marks included */
+      std::string san(const Move& move);
 
-      bool canPickupPiece(point_t from) override
-      {
-        return isValid(from) && get(from).present && get(from).color == _player->color;
-      }
+      /* decodes a SAN token against the current position, annotations like ! and ? are ignored */
+      bool parseSan(const char* san, size_t length, Move& move);
     };
   }
 }
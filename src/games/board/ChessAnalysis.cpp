@@ -0,0 +1,524 @@
+#include "ChessAnalysis.h"
+#include "ChessPosition.h"
+
+#include "Trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace games;
+using namespace games::chess;
+using namespace games::chess::engine;
+
+namespace
+{
+  constexpr s32 INFINITE = 32000;
+  constexpr s32 MATE = 30000;
+  constexpr s32 MAX_PLY = 96;
+  constexpr s32 MAX_DEPTH = 64;
+
+  /* negamax alpha-beta with a transposition table and a capture quiescence */
+  class Search
+  {
+  public:
+    enum Bound : u8 { None, Upper, Lower, Exact };
+
+    struct Entry
+    {
+      u64 key;
+      move_t move;
+      short score;
+      u8 depth;
+      u8 bound;
+      u8 age;
+    };
+
+  private:
+    std::vector<Entry> _table;
+    u8 _age;
+
+    u64 _path[MAX_PLY + 1];
+
+    std::function<bool()> _interrupted;
+    bool _aborted;
+    u64 _nodes;
+
+    Entry& slot(u64 key) { return _table[key & (_table.size() - 1)]; }
+
+    /* mates are stored relative to the node so that they stay valid elsewhere in the tree */
+    static s32 toTable(s32 score, s32 ply) { return score > MATE - MAX_PLY ? score + ply : (score < -MATE + MAX_PLY ? score - ply : score); }
+    static s32 fromTable(s32 score, s32 ply) { return score > MATE - MAX_PLY ? score - ply : (score < -MATE + MAX_PLY ? score + ply : score); }
+
+    void store(u64 key, move_t move, s32 score, s32 depth, Bound bound, s32 ply)
+    {
+      Entry& entry = slot(key);
+
+      if (entry.key == key || entry.age != _age || depth >= entry.depth)
+      {
+        /* a shallower result without a move shouldn't lose the one already known */
+        if (!move && entry.key == key)
+          move = entry.move;
+
+        entry = { key, move, short(toTable(score, ply)), u8(std::max(depth, 0)), u8(bound), _age };
+      }
+    }
+
+    bool abort()
+    {
+      if ((++_nodes & 255) == 0 && !_aborted)
+        _aborted = _interrupted();
+      return _aborted;
+    }
+
+    bool repeated(u64 key, s32 ply) const
+    {
+      for (s32 i = ply - 2; i >= 0; i -= 2)
+        if (_path[i] == key)
+          return true;
+      return false;
+    }
+
+    /* best first: the hash move, then captures of the most valuable victims by the least valuable attackers */
+    void order(const Position& position, move_t* moves, s32* scores, size_t count, move_t best) const
+    {
+      for (size_t i = 0; i < count; ++i)
+      {
+        const int8_t victim = position.board[toOf(moves[i])], attacker = position.board[fromOf(moves[i])];
+
+        if (moves[i] == best)
+          scores[i] = 1 << 20;
+        else
+          scores[i] = (victim ? 16 * values[victim > 0 ? victim : -victim] - values[attacker > 0 ? attacker : -attacker] : 0) + (promotionOf(moves[i]) ? values[promotionOf(moves[i])] : 0);
+      }
+    }
+
+    static move_t pick(move_t* moves, s32* scores, size_t count, size_t i)
+    {
+      size_t best = i;
+      for (size_t j = i + 1; j < count; ++j)
+        if (scores[j] > scores[best])
+          best = j;
+
+      std::swap(moves[i], moves[best]);
+      std::swap(scores[i], scores[best]);
+      return moves[i];
+    }
+
+    s32 quiesce(const Position& position, s32 alpha, s32 beta, s32 ply)
+    {
+      if (abort())
+        return 0;
+
+      const s32 stand = position.evaluate();
+
+      if (stand >= beta || ply >= MAX_PLY)
+        return stand;
+      alpha = std::max(alpha, stand);
+
+      move_t moves[MAX_MOVES];
+      s32 scores[MAX_MOVES];
+      const size_t count = position.generate(moves, true);
+      order(position, moves, scores, count, 0);
+
+      for (size_t i = 0; i < count; ++i)
+      {
+        Position next;
+        if (!position.play(pick(moves, scores, count, i), next))
+          continue;
+
+        const s32 score = -quiesce(next, -beta, -alpha, ply + 1);
+
+        if (_aborted)
+          return 0;
+
+        if (score >= beta)
+          return score;
+        alpha = std::max(alpha, score);
+      }
+
+      return alpha;
+    }
+
+  public:
+    Search() : _table(size_t(1) << 17), _age(0), _aborted(false), _nodes(0)
+    {
+      memset(_table.data(), 0, _table.size() * sizeof(Entry));
+      memset(_path, 0, sizeof(_path));
+    }
+
+    /* the table stays, older entries just lose priority; the root is searched
+       one move at a time from ply 1, so its key is put on the path here */
+    void prepare(u64 root, std::function<bool()> interrupted)
+    {
+      _path[0] = root;
+      _interrupted = std::move(interrupted);
+      _aborted = false;
+      _nodes = 0;
+      ++_age;
+    }
+
+    bool aborted() const { return _aborted; }
+    u64 nodes() const { return _nodes; }
+
+    s32 negamax(const Position& position, s32 depth, s32 alpha, s32 beta, s32 ply)
+    {
+      if (abort())
+        return 0;
+
+      _path[ply] = position.key;
+
+      if (ply && repeated(position.key, ply))
+        return 0;
+
+      const bool check = position.inCheck();
+
+      if (check && ply < MAX_PLY)
+        ++depth;
+
+      if (depth <= 0 || ply >= MAX_PLY)
+        return quiesce(position, alpha, beta, ply);
+
+      move_t best = 0;
+      const Entry& entry = slot(position.key);
+
+      if (entry.key == position.key)
+      {
+        best = entry.move;
+
+        if (ply && entry.depth >= depth)
+        {
+          const s32 score = fromTable(entry.score, ply);
+
+          if (entry.bound == Exact || (entry.bound == Lower && score >= beta) || (entry.bound == Upper && score <= alpha))
+            return score;
+        }
+      }
+
+      move_t moves[MAX_MOVES];
+      s32 scores[MAX_MOVES];
+      const size_t count = position.generate(moves, false);
+      order(position, moves, scores, count, best);
+
+      const s32 original = alpha;
+      s32 bestScore = -INFINITE;
+      size_t legal = 0;
+
+      for (size_t i = 0; i < count; ++i)
+      {
+        const move_t move = pick(moves, scores, count, i);
+
+        Position next;
+        if (!position.play(move, next))
+          continue;
+
+        ++legal;
+
+        const s32 score = -negamax(next, depth - 1, -beta, -alpha, ply + 1);
+
+        if (_aborted)
+          return 0;
+
+        if (score > bestScore)
+        {
+          bestScore = score;
+          best = move;
+        }
+
+        if (score > alpha)
+          alpha = score;
+        if (alpha >= beta)
+          break;
+      }
+
+      if (!legal)
+        return check ? -MATE + ply : 0;
+
+      store(position.key, best, bestScore, depth, bestScore <= original ? Upper : (bestScore >= beta ? Lower : Exact), ply);
+      return bestScore;
+    }
+
+    /* the first move and then whatever the table remembers, as long as it's legal */
+    void principalVariation(const Position& root, move_t first, s32 length, std::vector<move_t>& pv)
+    {
+      pv.assign(1, first);
+
+      Position position;
+      if (!root.play(first, position))
+        return;
+
+      u64 seen[MAX_PLY];
+      s32 ply = 0;
+      seen[ply++] = root.key;
+
+      while (s32(pv.size()) < length && ply < MAX_PLY)
+      {
+        const Entry& entry = slot(position.key);
+
+        if (entry.key != position.key || !entry.move || std::find(seen, seen + ply, position.key) != seen + ply)
+          break;
+
+        move_t moves[MAX_MOVES];
+        const size_t count = position.generate(moves, false);
+
+        Position next;
+        if (std::find(moves, moves + count, entry.move) == moves + count || !position.play(entry.move, next))
+          break;
+
+        seen[ply++] = position.key;
+        pv.push_back(entry.move);
+        position = next;
+      }
+    }
+  };
+
+  class ChessAnalyzer : public Analyzer<Chess>
+  {
+  private:
+    using clock = std::chrono::steady_clock;
+
+    /* how long the search runs before it pays back its budget by sleeping */
+    static constexpr u32 SLICE_MS = 4;
+
+    std::function<void()> _notify;
+
+    std::thread _thread;
+    std::mutex _mutex;
+    std::condition_variable _wakeup;
+
+    /* bumped by every analyze() and stop(), a search for an older one gives up */
+    std::atomic<u32> _request;
+    std::atomic<bool> _quit;
+    std::atomic<u32> _lines;
+    std::atomic<float> _budget;
+
+    bool _pending;
+    Position _position;
+
+    Report _report;
+    u32 _generation;
+
+    Search _search;
+    clock::time_point _slice;
+
+    bool interrupted(u32 request)
+    {
+      const float budget = _budget;
+
+      if (budget < 1.0f && !_quit && _request == request)
+      {
+        const clock::time_point now = clock::now();
+        const auto worked = now - _slice;
+
+        if (worked >= std::chrono::milliseconds(SLICE_MS))
+        {
+          std::this_thread::sleep_for(std::chrono::duration_cast<clock::duration>(worked * ((1.0f - budget) / budget)));
+          _slice = clock::now();
+        }
+      }
+
+      return _quit || _request != request;
+    }
+
+    void publish(u32 request, Report& report)
+    {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        if (_request != request)
+          return;
+
+        std::swap(_report, report);
+        ++_generation;
+      }
+
+      if (_notify)
+        _notify();
+    }
+
+    void search(const Position& root, u32 request)
+    {
+      _search.prepare(root.key, [this, request]() { return interrupted(request); });
+      _slice = clock::now();
+
+      move_t moves[MAX_MOVES];
+      std::vector<move_t> rootMoves;
+
+      for (size_t i = 0, count = root.generate(moves, false); i < count; ++i)
+      {
+        Position next;
+        if (root.play(moves[i], next))
+          rootMoves.push_back(moves[i]);
+      }
+
+      Report report;
+      std::vector<move_t> pv;
+
+      for (s32 depth = 1; depth <= MAX_DEPTH && !rootMoves.empty(); ++depth)
+      {
+        TRACE_ZONE("search depth");
+
+        const size_t wanted = std::min<size_t>(_lines, rootMoves.size());
+
+        /* multi PV: each line is the best of the root moves not already reported at this depth */
+        std::vector<std::pair<move_t, s32>> best;
+
+        for (size_t k = 0; k < wanted; ++k)
+        {
+          s32 bestScore = -INFINITE;
+          move_t bestMove = 0;
+
+          for (move_t move : rootMoves)
+          {
+            if (std::find_if(best.begin(), best.end(), [move](const std::pair<move_t, s32>& line) { return line.first == move; }) != best.end())
+              continue;
+
+            Position next;
+            root.play(move, next);
+
+            const s32 score = -_search.negamax(next, depth - 1, -INFINITE, -bestScore, 1);
+
+            if (_search.aborted())
+              return;
+
+            if (score > bestScore)
+            {
+              bestScore = score;
+              bestMove = move;
+            }
+          }
+
+          best.push_back(std::make_pair(bestMove, bestScore));
+        }
+
+        report.depth = u32(depth);
+        report.nodes = _search.nodes();
+        report.lines.clear();
+
+        for (const auto& line : best)
+        {
+          _search.principalVariation(root, line.first, depth, pv);
+
+          Line<Move> out = { std::vector<Move>(), line.second, 0 };
+
+          Position position = root;
+          for (move_t move : pv)
+          {
+            out.pv.push_back(toMove(position, move));
+
+            Position next;
+            position.play(move, next);
+            position = next;
+          }
+
+          if (line.second > MATE - MAX_PLY)
+            out.mate = (MATE - line.second + 1) / 2;
+          else if (line.second < -MATE + MAX_PLY)
+            out.mate = -(MATE + line.second) / 2;
+
+          report.lines.push_back(out);
+        }
+
+        /* the next depth starts from the lines just found */
+        for (size_t k = 0; k < best.size(); ++k)
+          std::swap(*std::find(rootMoves.begin(), rootMoves.end(), best[k].first), rootMoves[k]);
+
+        publish(request, report);
+
+        /* nothing left to learn once the best line is a forced mate well inside the horizon */
+        if (std::abs(best.front().second) > MATE - MAX_PLY && MATE - std::abs(best.front().second) < depth)
+          break;
+      }
+    }
+
+    void run()
+    {
+      TRACE_THREAD("analysis");
+
+      std::unique_lock<std::mutex> lock(_mutex);
+
+      while (!_quit)
+      {
+        _wakeup.wait(lock, [this]() { return _quit || _pending; });
+
+        if (_quit)
+          break;
+
+        const Position root = _position;
+        const u32 request = _request;
+        _pending = false;
+
+        lock.unlock();
+        search(root, request);
+        lock.lock();
+      }
+    }
+
+  public:
+    ChessAnalyzer(std::function<void()> notify) : _notify(std::move(notify)), _request(0), _quit(false), _lines(3), _budget(0.5f), _pending(false), _generation(0)
+    {
+      _report = { 0, 0, std::vector<Line<Move>>() };
+      _thread = std::thread(&ChessAnalyzer::run, this);
+    }
+
+    ~ChessAnalyzer()
+    {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _quit = true;
+      }
+
+      _wakeup.notify_all();
+      _thread.join();
+    }
+
+    void analyze(const Chess& game) override
+    {
+      const Position position = fromGame(game);
+
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _position = position;
+        _pending = true;
+        ++_request;
+
+        _report = { 0, 0, std::vector<Line<Move>>() };
+        ++_generation;
+      }
+
+      _wakeup.notify_all();
+    }
+
+    void stop() override
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _pending = false;
+      ++_request;
+    }
+
+    bool poll(u32& generation, Report& report) override
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+
+      if (generation == _generation)
+        return false;
+
+      report = _report;
+      generation = _generation;
+      return true;
+    }
+
+    void setLines(u32 lines) override { _lines = std::max(lines, 1u); }
+    void setBudget(float budget) override { _budget = std::min(std::max(budget, 0.05f), 1.0f); }
+  };
+
+  /* odr-used by the milliseconds it is turned into */
+  constexpr u32 ChessAnalyzer::SLICE_MS;
+}
+
+template<> Analyzer<Chess>* games::createAnalyzer<Chess>(std::function<void()> notify)
+{
+  return new ChessAnalyzer(std::move(notify));
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "games/board/Analysis.h"
+#include "games/board/Chess.h"
+
+namespace games
+{
+  /* alpha-beta over the engine board of ChessPosition.h, see ChessAnalysis.cpp */
+  template<> Analyzer<chess::Chess>* createAnalyzer<chess::Chess>(std::function<void()> notify);
+}
@@ -0,0 +1,505 @@
+#pragma once
+
+#include "Common.h"
+#include "games/board/Chess.h"
+
+#include <algorithm>
+
+namespace games
+{
+  namespace chess
+  {
+    /* a compact copy of a Chess position for the searches, which play millions of
+       moves: a signed mailbox, zobrist keys updated by play() and moves packed into
+       16 bits; a Chess is converted once with fromGame() and moves are turned back
+       into Chess moves with toMove() */
+    namespace engine
+    {
+      /* pieces are signed, positive for white; squares go a1 = 0 to h8 = 63 */
+      enum : int8_t { EMPTY = 0, PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING };
+      enum : u8 { WHITE_KING_SIDE = 1, WHITE_QUEEN_SIDE = 2, BLACK_KING_SIDE = 4, BLACK_QUEEN_SIDE = 8 };
+
+      /* from, to and the promotion piece in 6 + 6 + 3 bits, 0 is no move */
+      using move_t = u16;
+
+      inline move_t pack(int from, int to, int promotion = EMPTY) { return move_t(from | (to << 6) | (promotion << 12)); }
+      inline int fromOf(move_t move) { return move & 63; }
+      inline int toOf(move_t move) { return (move >> 6) & 63; }
+      inline int promotionOf(move_t move) { return move >> 12; }
+
+      constexpr size_t MAX_MOVES = 256;
+
+      const s32 values[] = { 0, 100, 320, 330, 500, 900, 0 };
+
+      const int knightDeltas[8][2] = { { -2, -1 }, { -2, 1 }, { 2, -1 }, { 2, 1 }, { -1, -2 }, { 1, -2 }, { -1, 2 }, { 1, 2 } };
+      const int kingDeltas[8][2] = { { -1, -1 }, { 0, -1 }, { 1, -1 }, { -1, 0 }, { 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 } };
+      const int straightDeltas[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+      const int diagonalDeltas[4][2] = { { -1, -1 }, { 1, -1 }, { -1, 1 }, { 1, 1 } };
+
+      inline bool inside(int x, int y) { return x >= 0 && x < 8 && y >= 0 && y < 8; }
+
+      struct Keys
+      {
+        u64 pieces[13][64];
+        u64 side;
+        u64 castling[16];
+        u64 enPassant[8];
+
+        Keys()
+        {
+          /* splitmix64, fixed so that hashes are the same on every run */
+          u64 state = 0x9E3779B97F4A7C15ull;
+          auto next = [&state]() {
+            u64 z = (state += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+          };
+
+          for (auto& piece : pieces)
+            for (u64& key : piece)
+              key = next();
+
+          side = next();
+          for (u64& key : castling)
+            key = next();
+          for (u64& key : enPassant)
+            key = next();
+        }
+      };
+
+      inline const Keys& keys()
+      {
+        static const Keys keys;
+        return keys;
+      }
+
+      /* castling rights which survive a move from or to each square */
+      inline u8 rightsKept(int square)
+      {
+        switch (square)
+        {
+          case 0: return u8(~WHITE_QUEEN_SIDE);
+          case 4: return u8(~(WHITE_KING_SIDE | WHITE_QUEEN_SIDE));
+          case 7: return u8(~WHITE_KING_SIDE);
+          case 56: return u8(~BLACK_QUEEN_SIDE);
+          case 60: return u8(~(BLACK_KING_SIDE | BLACK_QUEEN_SIDE));
+          case 63: return u8(~BLACK_KING_SIDE);
+          default: return 0xFF;
+        }
+      }
+
+      struct Position
+      {
+        int8_t board[64];
+        int8_t kings[2]; // white, black
+        int8_t enPassant; // -1 if none
+        u8 castling;
+        bool white;
+        u64 key;
+
+        u64 pieceKey(int square) const { return keys().pieces[board[square] + 6][square]; }
+
+        void rehash()
+        {
+          key = 0;
+          for (int square = 0; square < 64; ++square)
+            if (board[square])
+              key ^= pieceKey(square);
+
+          key ^= keys().castling[castling];
+          if (!white)
+            key ^= keys().side;
+          if (enPassant >= 0)
+            key ^= keys().enPassant[enPassant & 7];
+        }
+
+        bool attacked(int square, bool byWhite) const
+        {
+          const int x = square & 7, y = square >> 3;
+          const int8_t s = byWhite ? 1 : -1;
+
+          /* a pawn attacks forward, so the attacker is a row behind from its side */
+          for (int dx : { -1, 1 })
+            if (inside(x + dx, y - s) && board[(y - s) * 8 + x + dx] == PAWN * s)
+              return true;
+
+          for (const auto& d : knightDeltas)
+            if (inside(x + d[0], y + d[1]) && board[(y + d[1]) * 8 + x + d[0]] == KNIGHT * s)
+              return true;
+
+          for (const auto& d : kingDeltas)
+            if (inside(x + d[0], y + d[1]) && board[(y + d[1]) * 8 + x + d[0]] == KING * s)
+              return true;
+
+          for (const auto& d : straightDeltas)
+            for (int xx = x + d[0], yy = y + d[1]; inside(xx, yy); xx += d[0], yy += d[1])
+              if (const int8_t piece = board[yy * 8 + xx])
+              {
+                if (piece == ROOK * s || piece == QUEEN * s)
+                  return true;
+                break;
+              }
+
+          for (const auto& d : diagonalDeltas)
+            for (int xx = x + d[0], yy = y + d[1]; inside(xx, yy); xx += d[0], yy += d[1])
+              if (const int8_t piece = board[yy * 8 + xx])
+              {
+                if (piece == BISHOP * s || piece == QUEEN * s)
+                  return true;
+                break;
+              }
+
+          return false;
+        }
+
+        bool inCheck() const { return attacked(kings[white ? 0 : 1], !white); }
+
+        /* pseudo legal, castling is only generated when the king doesn't pass through check */
+        size_t generate(move_t* moves, bool capturesOnly) const
+        {
+          const int8_t s = white ? 1 : -1;
+          size_t count = 0;
+
+          auto promotions = [&moves, &count](int from, int to) {
+            for (int piece : { QUEEN, KNIGHT, ROOK, BISHOP })
+              moves[count++] = pack(from, to, piece);
+          };
+
+          for (int from = 0; from < 64; ++from)
+          {
+            const int8_t piece = int8_t(board[from] * s);
+
+            if (piece <= 0)
+              continue;
+
+            const int x = from & 7, y = from >> 3;
+
+            if (piece == PAWN)
+            {
+              const int y2 = y + s, last = white ? 7 : 0, start = white ? 1 : 6;
+              const int to = y2 * 8 + x;
+
+              if (board[to] == EMPTY)
+              {
+                if (y2 == last)
+                  promotions(from, to);
+                else if (!capturesOnly)
+                {
+                  moves[count++] = pack(from, to);
+                  if (y == start && board[to + 8 * s] == EMPTY)
+                    moves[count++] = pack(from, to + 8 * s);
+                }
+              }
+
+              for (int dx : { -1, 1 })
+              {
+                if (!inside(x + dx, y2))
+                  continue;
+
+                const int target = y2 * 8 + x + dx;
+
+                if (board[target] * s < 0 || target == enPassant)
+                {
+                  if (y2 == last)
+                    promotions(from, target);
+                  else
+                    moves[count++] = pack(from, target);
+                }
+              }
+            }
+            else if (piece == KNIGHT || piece == KING)
+            {
+              for (const auto& d : (piece == KNIGHT ? knightDeltas : kingDeltas))
+              {
+                if (!inside(x + d[0], y + d[1]))
+                  continue;
+
+                const int to = (y + d[1]) * 8 + x + d[0];
+
+                if (board[to] * s < 0 || (board[to] == EMPTY && !capturesOnly))
+                  moves[count++] = pack(from, to);
+              }
+
+              if (piece == KING && !capturesOnly)
+              {
+                const int home = white ? 0 : 56;
+                const u8 kingSide = white ? WHITE_KING_SIDE : BLACK_KING_SIDE, queenSide = white ? WHITE_QUEEN_SIDE : BLACK_QUEEN_SIDE;
+
+                if ((castling & kingSide) && !board[home + 5] && !board[home + 6] && !attacked(home + 4, !white) && !attacked(home + 5, !white))
+                  moves[count++] = pack(home + 4, home + 6);
+                if ((castling & queenSide) && !board[home + 1] && !board[home + 2] && !board[home + 3] && !attacked(home + 4, !white) && !attacked(home + 3, !white))
+                  moves[count++] = pack(home + 4, home + 2);
+              }
+            }
+            else
+            {
+              auto slide = [&](const int (&d)[2]) {
+                for (int xx = x + d[0], yy = y + d[1]; inside(xx, yy); xx += d[0], yy += d[1])
+                {
+                  const int to = yy * 8 + xx;
+
+                  if (board[to] == EMPTY)
+                  {
+                    if (!capturesOnly)
+                      moves[count++] = pack(from, to);
+                  }
+                  else
+                  {
+                    if (board[to] * s < 0)
+                      moves[count++] = pack(from, to);
+                    break;
+                  }
+                }
+              };
+
+              if (piece != BISHOP)
+                for (const auto& d : straightDeltas)
+                  slide(d);
+              if (piece != ROOK)
+                for (const auto& d : diagonalDeltas)
+                  slide(d);
+            }
+          }
+
+          return count;
+        }
+
+        /* into next, false if it leaves the own king in check */
+        bool play(move_t move, Position& next) const
+        {
+          const Keys& k = keys();
+          const int from = fromOf(move), to = toOf(move), promotion = promotionOf(move);
+          const int8_t s = white ? 1 : -1;
+          const int8_t piece = board[from];
+
+          next = *this;
+
+          next.key ^= next.pieceKey(from);
+          if (next.board[to])
+            next.key ^= next.pieceKey(to);
+
+          if (piece == PAWN * s && to == enPassant && board[to] == EMPTY)
+          {
+            const int captured = to - 8 * s;
+            next.key ^= next.pieceKey(captured);
+            next.board[captured] = EMPTY;
+          }
+
+          next.board[from] = EMPTY;
+          next.board[to] = promotion ? int8_t(promotion * s) : piece;
+          next.key ^= next.pieceKey(to);
+
+          if (piece == KING * s)
+          {
+            next.kings[white ? 0 : 1] = int8_t(to);
+
+            if (to - from == 2 || from - to == 2)
+            {
+              const int rookFrom = to > from ? from + 3 : from - 4, rookTo = to > from ? from + 1 : from - 1;
+
+              next.key ^= next.pieceKey(rookFrom);
+              next.board[rookTo] = next.board[rookFrom];
+              next.board[rookFrom] = EMPTY;
+              next.key ^= next.pieceKey(rookTo);
+            }
+          }
+
+          next.key ^= k.castling[castling];
+          next.castling &= rightsKept(from) & rightsKept(to);
+          next.key ^= k.castling[next.castling];
+
+          if (enPassant >= 0)
+            next.key ^= k.enPassant[enPassant & 7];
+          next.enPassant = piece == PAWN * s && (to - from == 16 || from - to == 16) ? int8_t((from + to) / 2) : int8_t(-1);
+          if (next.enPassant >= 0)
+            next.key ^= k.enPassant[next.enPassant & 7];
+
+          next.white = !white;
+          next.key ^= k.side;
+
+          return !next.attacked(next.kings[white ? 0 : 1], !white);
+        }
+
+        /* whether the move checks the other king, without playing it: the moved piece
+           attacks the king or it uncovers a slider behind; castling and en passant
+           move a second piece and are played out instead */
+        bool givesCheck(move_t move) const
+        {
+          const int from = fromOf(move), to = toOf(move);
+          const int8_t s = white ? 1 : -1;
+          const int moved = board[from] * s;
+          const int piece = promotionOf(move) ? promotionOf(move) : moved;
+          const int king = kings[white ? 1 : 0];
+
+          if ((moved == KING && (to - from == 2 || from - to == 2)) || (moved == PAWN && to == enPassant))
+          {
+            Position next;
+            play(move, next);
+            return next.inCheck();
+          }
+
+          const int kx = king & 7, ky = king >> 3;
+
+          /* the squares from a to the king, false at the first piece but the one which moved away */
+          auto clear = [this, king, from](int a) {
+            const int dx = (king & 7) - (a & 7), dy = (king >> 3) - (a >> 3);
+            const int step = (dy > 0 ? 8 : dy < 0 ? -8 : 0) + (dx > 0 ? 1 : dx < 0 ? -1 : 0);
+
+            for (int square = a + step; square != king; square += step)
+              if (board[square] && square != from)
+                return false;
+            return true;
+          };
+
+          const int dx = kx - (to & 7), dy = ky - (to >> 3);
+          const bool straight = dx == 0 || dy == 0, diagonal = dx == dy || dx == -dy;
+
+          switch (piece)
+          {
+            case PAWN: if (dy == s && (dx == 1 || dx == -1)) return true; break;
+            case KNIGHT: if (dx * dx + dy * dy == 5) return true; break;
+            case KING: break;
+            default:
+              if (((straight && piece != BISHOP) || (diagonal && piece != ROOK)) && clear(to))
+                return true;
+          }
+
+          /* discovered, the first piece past the square left behind on the line from the king */
+          const int fx = (from & 7) - kx, fy = (from >> 3) - ky;
+
+          if (fx != 0 && fy != 0 && fx != fy && fx != -fy)
+            return false;
+
+          const int sx = fx > 0 ? 1 : fx < 0 ? -1 : 0, sy = fy > 0 ? 1 : fy < 0 ? -1 : 0;
+          const bool line = sx == 0 || sy == 0;
+          bool passed = false;
+
+          for (int x = kx + sx, y = ky + sy; inside(x, y); x += sx, y += sy)
+          {
+            const int square = y * 8 + x;
+
+            if (square == to)
+              return false;
+            else if (square == from)
+              passed = true;
+            else if (const int8_t other = board[square])
+              return passed && (other == QUEEN * s || other == (line ? ROOK : BISHOP) * s);
+          }
+
+          return false;
+        }
+
+        /* material and a rough idea of where pieces belong, from the side to move */
+        s32 evaluate() const
+        {
+          s32 score = 0, material = 0;
+
+          for (int square = 0; square < 64; ++square)
+            if (board[square] && board[square] != PAWN && board[square] != -PAWN)
+              material += values[board[square] > 0 ? board[square] : -board[square]];
+
+          const bool endgame = material <= 2 * (values[ROOK] + values[BISHOP]);
+
+          for (int square = 0; square < 64; ++square)
+          {
+            const int8_t piece = board[square];
+
+            if (!piece)
+              continue;
+
+            const s32 s = piece > 0 ? 1 : -1;
+            const int type = piece * s;
+            const int x = square & 7, rank = piece > 0 ? square >> 3 : 7 - (square >> 3);
+
+            /* 0 on the rim up to 3 in the middle */
+            const int center = std::min(std::min(x, 7 - x), std::min(rank, 7 - rank));
+
+            s32 bonus = values[type];
+
+            switch (type)
+            {
+              case PAWN: bonus += (rank - 1) * (endgame ? 12 : 5) + ((x == 3 || x == 4) && (rank == 3 || rank == 4) ? 15 : 0); break;
+              case KNIGHT: bonus += center * 10 - 15; break;
+              case BISHOP: bonus += center * 5; break;
+              case ROOK: bonus += rank == 6 ? 20 : 0; break;
+              case QUEEN: bonus += center * 2; break;
+              case KING: bonus += endgame ? center * 10 : (rank == 0 ? 15 : -10 * rank) - (x == 3 || x == 4 ? 10 : 0); break;
+            }
+
+            score += s * bonus;
+          }
+
+          return white ? score : -score;
+        }
+      };
+
+      inline Position fromGame(const Chess& game)
+      {
+        Position position;
+
+        for (int square = 0; square < 64; ++square)
+        {
+          const Piece& piece = game.get(point_t(square & 7, square >> 3));
+          int8_t type = EMPTY;
+
+          if (piece.present)
+            switch (piece.type)
+            {
+              case Piece::Type::Pawn: type = PAWN; break;
+              case Piece::Type::Rook: type = KNIGHT; break;
+              case Piece::Type::Bishop: type = BISHOP; break;
+              case Piece::Type::Castle: type = ROOK; break;
+              case Piece::Type::Queen: type = QUEEN; break;
+              case Piece::Type::King: type = KING; break;
+            }
+
+          position.board[square] = piece.present && !piece.isWhite() ? int8_t(-type) : type;
+
+          if (type == KING)
+            position.kings[piece.isWhite() ? 0 : 1] = int8_t(square);
+        }
+
+        auto unmoved = [&game](int square, Piece::Type type, Color color) {
+          const Piece& piece = game.get(point_t(square & 7, square >> 3));
+          return piece.is(type, color) && !piece.hasMoved;
+        };
+
+        position.castling = 0;
+        if (unmoved(4, Piece::Type::King, Color::White))
+          position.castling |= (unmoved(7, Piece::Type::Castle, Color::White) ? WHITE_KING_SIDE : 0) | (unmoved(0, Piece::Type::Castle, Color::White) ? WHITE_QUEEN_SIDE : 0);
+        if (unmoved(60, Piece::Type::King, Color::Black))
+          position.castling |= (unmoved(63, Piece::Type::Castle, Color::Black) ? BLACK_KING_SIDE : 0) | (unmoved(56, Piece::Type::Castle, Color::Black) ? BLACK_QUEEN_SIDE : 0);
+
+        const point_t ep = game.enPassant();
+        position.enPassant = ep.x >= 0 ? int8_t(ep.y * 8 + ep.x) : int8_t(-1);
+        position.white = game.currentPlayer().color == Color::White;
+        position.rehash();
+
+        return position;
+      }
+
+      inline Move toMove(const Position& position, move_t move)
+      {
+        const int from = fromOf(move), to = toOf(move);
+        const point_t a = point_t(from & 7, from >> 3), b = point_t(to & 7, to >> 3);
+        const int piece = position.board[from] > 0 ? position.board[from] : -position.board[from];
+
+        switch (promotionOf(move))
+        {
+          case KNIGHT: return Move(a, b, Move::Type::Promotion, Piece::Type::Rook);
+          case BISHOP: return Move(a, b, Move::Type::Promotion, Piece::Type::Bishop);
+          case ROOK: return Move(a, b, Move::Type::Promotion, Piece::Type::Castle);
+          case QUEEN: return Move(a, b, Move::Type::Promotion, Piece::Type::Queen);
+        }
+
+        if (piece == KING && (to - from == 2 || from - to == 2))
+          return Move(a, b, Move::Type::Castling);
+        else if (piece == PAWN && to == position.enPassant && position.board[to] == EMPTY)
+          return Move(a, b, Move::Type::EnPassant);
+        else
+          return Move(a, b);
+      }
+    }
+  }
+}
@@ -0,0 +1,346 @@
+#include "ChessProblems.h"
+#include "Pgn.h"
+
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+using namespace games::chess;
+using namespace games::chess::engine;
+using namespace games::chess::problems;
+
+namespace
+{
+  /* proof and disproof numbers saturate here, sums of two still fit in a u32 */
+  constexpr u32 INFINITE = 0x3FFFFFFF;
+
+  u32 add(u32 a, u32 b) { return std::min(a + b, INFINITE); }
+
+  bool hasLegalMove(const Position& position)
+  {
+    move_t moves[MAX_MOVES];
+    const size_t count = position.generate(moves, false);
+    Position next;
+
+    for (size_t i = 0; i < count; ++i)
+      if (position.play(moves[i], next))
+        return true;
+
+    return false;
+  }
+
+  bool matesInOne(const Position& position)
+  {
+    move_t moves[MAX_MOVES];
+    const size_t count = position.generate(moves, false);
+    Position next;
+
+    for (size_t i = 0; i < count; ++i)
+      if (position.givesCheck(moves[i]) && position.play(moves[i], next) && !hasLegalMove(next))
+        return true;
+
+    return false;
+  }
+
+  /* the defender to move is mated, now or by a mate in one after any reply; a
+     plain search stops at the first reply which escapes and is cheaper this
+     close to the end than keeping numbers for every reply */
+  bool lost(const Position& position)
+  {
+    move_t moves[MAX_MOVES];
+    const size_t count = position.generate(moves, false);
+    Position next;
+    bool moved = false;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      if (!position.play(moves[i], next))
+        continue;
+
+      moved = true;
+      if (!matesInOne(next))
+        return false;
+    }
+
+    return moved || position.inCheck();
+  }
+}
+
+const char* problems::name(Solution::Verdict verdict)
+{
+  switch (verdict)
+  {
+    case Solution::Verdict::Sound: return "sound";
+    case Solution::Verdict::Cooked: return "cooked";
+    case Solution::Verdict::NoMate: return "no mate";
+    case Solution::Verdict::Unsolved: return "unsolved";
+    case Solution::Verdict::Invalid: return "invalid";
+  }
+
+  return "";
+}
+
+Solver::Solver(size_t entries) : _table(entries), _nodes(0), _budget(0) { }
+
+bool Solver::lookup(u64 key, u32& pn, u32& dn) const
+{
+  const Entry& entry = _table[key & (_table.size() - 1)];
+
+  if (entry.key != key)
+    return false;
+
+  pn = entry.pn;
+  dn = entry.dn;
+  return true;
+}
+
+/* always replaces: without cycles a lost entry only costs searching it again */
+void Solver::store(u64 key, u32 pn, u32 dn)
+{
+  _table[key & (_table.size() - 1)] = { key, pn, dn };
+}
+
+/* the legal children with the numbers known so far; a defender is settled on
+   the spot once it has two plies or less left, so the numbers only steer the
+   search down to the third move from the end. Unless all are wanted it stops
+   at the first child which settles the node */
+size_t Solver::expand(const Position& position, u32 plies, bool all, Child* children) const
+{
+  move_t moves[MAX_MOVES];
+  const size_t pseudo = position.generate(moves, false);
+  const bool attacker = plies & 1;
+  size_t count = 0;
+  Position next;
+
+  for (size_t i = 0; i < pseudo; ++i)
+  {
+    const bool check = position.givesCheck(moves[i]);
+
+    /* only a check mates, the other last moves are left out rather than played and refuted */
+    if (plies == 1 && !check)
+      continue;
+
+    if (!position.play(moves[i], next))
+      continue;
+
+    Child& child = children[count++];
+
+    child.move = moves[i];
+    child.rank = check ? 0 : (position.board[toOf(moves[i])] ? 1 : 2);
+    child.key = keyOf(next, plies - 1);
+
+    if (attacker && plies <= 3)
+    {
+      const bool won = plies == 1 ? !hasLegalMove(next) : lost(next);
+      child.pn = won ? 0 : INFINITE;
+      child.dn = won ? INFINITE : 0;
+    }
+    else if (!lookup(child.key, child.pn, child.dn))
+    {
+      const bool mated = attacker && check && !hasLegalMove(next);
+      child.pn = mated ? 0 : 1;
+      child.dn = mated ? INFINITE : 1;
+    }
+
+    /* one child settles the node, the rest would only be generated to be thrown away */
+    if (!all && (attacker ? child.pn : child.dn) == 0)
+      return count;
+  }
+
+  /* ties go to the first child, checks are what usually solves a problem */
+  std::stable_sort(children, children + count, [](const Child& a, const Child& b) { return a.rank < b.rank; });
+
+  return count;
+}
+
+/* the multiple iterative deepening of df-pn: the node is expanded until its
+   numbers reach the thresholds, which the parent sets so that it comes back
+   as soon as a sibling becomes the more promising child */
+void Solver::mid(const Position& position, u32 plies, u32 thpn, u32 thdn, u32& pn, u32& dn)
+{
+  const u64 key = keyOf(position, plies);
+
+  if (lookup(key, pn, dn) && (pn == 0 || dn == 0))
+    return;
+
+  ++_nodes;
+
+  const bool attacker = plies & 1;
+  Child children[MAX_MOVES];
+  const size_t count = expand(position, plies, false, children);
+
+  if (count == 0)
+  {
+    /* a defender without moves is mated or stalemated, an attacker can't mate either way */
+    const bool mated = !attacker && position.inCheck();
+    pn = mated ? 0 : INFINITE;
+    dn = mated ? INFINITE : 0;
+    store(key, pn, dn);
+    return;
+  }
+
+  while (true)
+  {
+    size_t best = 0;
+    u32 second = INFINITE;
+
+    /* or at the attacker, and at the defender */
+    if (attacker)
+    {
+      pn = INFINITE;
+      dn = 0;
+
+      for (size_t i = 0; i < count; ++i)
+      {
+        dn = add(dn, children[i].dn);
+
+        if (children[i].pn < pn)
+        {
+          second = pn;
+          pn = children[i].pn;
+          best = i;
+        }
+        else if (children[i].pn < second)
+          second = children[i].pn;
+      }
+    }
+    else
+    {
+      pn = 0;
+      dn = INFINITE;
+
+      for (size_t i = 0; i < count; ++i)
+      {
+        pn = add(pn, children[i].pn);
+
+        if (children[i].dn < dn)
+        {
+          second = dn;
+          dn = children[i].dn;
+          best = i;
+        }
+        else if (children[i].dn < second)
+          second = children[i].dn;
+      }
+    }
+
+    if (pn >= thpn || dn >= thdn || _nodes >= _budget)
+      break;
+
+    Child& child = children[best];
+    Position next;
+    position.play(child.move, next);
+
+    if (attacker)
+      mid(next, plies - 1, std::min(thpn, add(second, 1)), thdn - dn + child.dn, child.pn, child.dn);
+    else
+      mid(next, plies - 1, thpn - pn + child.pn, std::min(thdn, add(second, 1)), child.pn, child.dn);
+  }
+
+  store(key, pn, dn);
+}
+
+Solution Solver::solve(const Chess& game, u32 moves, u64 budget)
+{
+  TRACE_ZONE("mate search");
+
+  const auto start = std::chrono::steady_clock::now();
+  Solution solution;
+
+  const Position position = fromGame(game);
+  const bool kings = std::count(position.board, position.board + 64, KING) == 1 && std::count(position.board, position.board + 64, -KING) == 1;
+
+  if (moves == 0 || !kings)
+    return solution;
+
+  const u32 plies = 2 * moves - 1;
+  u32 pn, dn;
+
+  _nodes = 0;
+  _budget = budget;
+
+  mid(position, plies, INFINITE, INFINITE, pn, dn);
+
+  if (pn == 0)
+  {
+    /* one key proves the problem, soundness needs every other first move refuted */
+    Child children[MAX_MOVES];
+    const size_t count = expand(position, plies, true, children);
+
+    for (size_t i = 0; i < count && _nodes < _budget; ++i)
+    {
+      Child& child = children[i];
+
+      if (child.pn != 0 && child.dn != 0)
+      {
+        Position next;
+        position.play(child.move, next);
+        mid(next, plies - 1, INFINITE, INFINITE, child.pn, child.dn);
+      }
+
+      if (child.pn == 0)
+        solution.keys.push_back(toMove(position, child.move));
+    }
+
+    solution.verdict = _nodes >= _budget ? Solution::Verdict::Unsolved : (solution.keys.size() == 1 ? Solution::Verdict::Sound : Solution::Verdict::Cooked);
+  }
+  else
+    solution.verdict = dn == 0 ? Solution::Verdict::NoMate : Solution::Verdict::Unsolved;
+
+  solution.nodes = _nodes;
+  solution.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  return solution;
+}
+
+/* a solver per thread, keeping its table between problems: whatever is settled
+   in it stays true for any problem and the rest is only a guess */
+Solution problems::solve(const Problem& problem, u64 budget)
+{
+  static thread_local Solver solver;
+
+  Chess game;
+  if (!game.loadFen(problem.fen))
+    return Solution();
+
+  return solver.solve(game, problem.moves, budget);
+}
+
+std::vector<Solution> problems::solve(const std::vector<Problem>& pack, ThreadPool& pool, u64 budget)
+{
+  std::vector<Solution> solutions(pack.size());
+
+  for (size_t i = 0; i < pack.size(); ++i)
+    pool.submit([&pack, &solutions, i, budget]() { solutions[i] = solve(pack[i], budget); });
+
+  pool.wait();
+
+  return solutions;
+}
+
+std::vector<Problem> problems::read(const void* data, size_t size)
+{
+  std::vector<Problem> problems;
+  pgn::Reader reader(data, size);
+  pgn::Game game;
+
+  while (reader.next(game))
+  {
+    const pgn::Tag* fen = game.tag("FEN");
+    const pgn::Tag* stipulation = game.tag("Stipulation");
+
+    if (!fen || !stipulation || stipulation->value.length < 2 || stipulation->value.data[0] != '#')
+      continue;
+
+    const u32 moves = u32(strtoul(stipulation->value.str().c_str() + 1, nullptr, 10));
+    const pgn::Tag* event = game.tag("Event");
+    const std::string name = event && !(event->value == "?") ? event->value.str() : "problem " + std::to_string(problems.size() + 1);
+
+    problems.emplace_back(name, fen->value.str(), moves);
+  }
+
+  return problems;
+}
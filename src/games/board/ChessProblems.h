@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Common.h"
+#include "games/board/Chess.h"
+#include "games/board/ChessPosition.h"
+
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+namespace games
+{
+  namespace chess
+  {
+    namespace problems
+    {
+      /* the side to move in fen mates in moves against any defence */
+      struct Problem
+      {
+        std::string name;
+        std::string fen;
+        u32 moves;
+
+        Problem() : moves(0) { }
+        Problem(const std::string& name, const std::string& fen, u32 moves) : name(name), fen(fen), moves(moves) { }
+      };
+
+      struct Solution
+      {
+        /* a sound problem has exactly one key, a cooked one has more */
+        enum class Verdict { Sound, Cooked, NoMate, Unsolved, Invalid };
+
+        Verdict verdict;
+        std::vector<Move> keys; // every first move which mates in time, in the order they were proven
+        u64 nodes; // expansions, the last three plies are searched inside them
+        double seconds;
+
+        Solution() : verdict(Verdict::Invalid), nodes(0), seconds(0.0) { }
+      };
+
+      const char* name(Solution::Verdict verdict);
+
+      /* depth-first proof-number search: a node is proven once the attacker mates
+         within the plies left and disproven once the defender escapes, the search
+         always expands the child which is cheapest to settle and so mostly follows
+         checks and forced replies instead of every line alpha-beta has to look at.
+         The plies left are hashed into the key, which rules out cycles, and the
+         transposition table keeps the proof and disproof numbers between expansions.
+         A solver isn't thread safe, a batch gives every problem its own */
+      class Solver
+      {
+      private:
+        struct Entry
+        {
+          u64 key;
+          u32 pn, dn;
+        };
+
+        struct Child
+        {
+          engine::move_t move;
+          u8 rank; // 0 check, 1 capture, 2 anything else
+          u64 key;
+          u32 pn, dn;
+        };
+
+        std::vector<Entry> _table;
+        u64 _nodes;
+        u64 _budget;
+
+        u64 keyOf(const engine::Position& position, u32 plies) const { return position.key ^ (u64(plies) * 0x9E3779B97F4A7C15ull); }
+
+        bool lookup(u64 key, u32& pn, u32& dn) const;
+        void store(u64 key, u32 pn, u32 dn);
+
+        size_t expand(const engine::Position& position, u32 plies, bool all, Child* children) const;
+        void mid(const engine::Position& position, u32 plies, u32 thpn, u32 thdn, u32& pn, u32& dn);
+
+      public:
+        /* entries of 16 bytes, a power of two */
+        Solver(size_t entries = 1 << 18);
+
+        /* budget is the number of expansions allowed before giving up with Unsolved */
+        Solution solve(const Chess& game, u32 moves, u64 budget);
+
+        /* forgets every position, the next solve starts cold */
+        void clear() { _table.assign(_table.size(), Entry()); }
+      };
+
+      Solution solve(const Problem& problem, u64 budget);
+
+      /* one task per problem on the pool, solutions in the order of the pack */
+      std::vector<Solution> solve(const std::vector<Problem>& pack, ThreadPool& pool, u64 budget);
+
+      /* problems out of PGN, each with a FEN tag and a Stipulation tag like "#3",
+         named after their Event tag; games without both are skipped */
+      std::vector<Problem> read(const void* data, size_t size);
+    }
+  }
+}
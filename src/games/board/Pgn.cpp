@@ -0,0 +1,298 @@
+#include "Pgn.h"
+
+#include <cstring>
+
+using namespace games::chess;
+using namespace games::chess::pgn;
+
+namespace
+{
+  bool isSpace(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+  /* characters which end a SAN token or a move number */
+  bool isDelimiter(char c) { return isSpace(c) || c == '{' || c == '}' || c == '(' || c == ')' || c == ';' || c == '$' || c == '[' || c == ']'; }
+
+  void appendEscaped(std::string& out, const std::string& value)
+  {
+    for (char c : value)
+    {
+      if (c == '"' || c == '\\')
+        out += '\\';
+      out += c;
+    }
+  }
+}
+
+bool Span::operator==(const char* string) const
+{
+  return strlen(string) == length && memcmp(data, string, length) == 0;
+}
+
+const Tag* Game::tag(const char* name) const
+{
+  for (const Tag& tag : tags)
+    if (tag.name == name)
+      return &tag;
+
+  return nullptr;
+}
+
+void Reader::skipSpaces()
+{
+  while (_it != _end && isSpace(*_it))
+    ++_it;
+}
+
+void Reader::skipLine()
+{
+  const char* eol = static_cast<const char*>(memchr(_it, '\n', _end - _it));
+  _it = eol ? eol + 1 : _end;
+}
+
+void Reader::skipComment()
+{
+  const char* close = static_cast<const char*>(memchr(_it, '}', _end - _it));
+  _it = close ? close + 1 : _end;
+}
+
+void Reader::skipVariation()
+{
+  u32 depth = 0;
+
+  while (_it != _end)
+  {
+    const char c = *_it++;
+
+    if (c == '(')
+      ++depth;
+    else if (c == ')' && --depth == 0)
+      return;
+    else if (c == '{')
+      skipComment();
+    else if (c == ';')
+      skipLine();
+  }
+}
+
+bool Reader::readTag(Tag& tag)
+{
+  /* [Name "value"] */
+  ++_it;
+  skipSpaces();
+
+  const char* name = _it;
+  while (_it != _end && !isSpace(*_it) && *_it != '"' && *_it != ']')
+    ++_it;
+  tag.name = Span(name, _it - name);
+
+  skipSpaces();
+  if (_it == _end || *_it != '"')
+  {
+    skipLine();
+    return false;
+  }
+
+  const char* value = ++_it;
+  while (_it != _end && *_it != '"')
+    _it += *_it == '\\' && _it + 1 != _end ? 2 : 1;
+  tag.value = Span(value, _it - value);
+
+  skipLine();
+  return !tag.name.empty();
+}
+
+Span Reader::token()
+{
+  const char* start = _it;
+  while (_it != _end && !isDelimiter(*_it))
+    ++_it;
+
+  return Span(start, _it - start);
+}
+
+bool Reader::next(Game& game)
+{
+  game.tags.clear();
+  game.moves.clear();
+  game.result = Span();
+  game.valid = true;
+
+  /* whatever is between games, stray comments and escaped lines included */
+  for (;;)
+  {
+    skipSpaces();
+
+    if (_it == _end)
+      return false;
+    else if (*_it == '{')
+      skipComment();
+    else if (*_it == ';' || *_it == '%')
+      skipLine();
+    else
+      break;
+  }
+
+  while (_it != _end && *_it == '[')
+  {
+    Tag tag;
+    if (readTag(tag))
+      game.tags.push_back(tag);
+    skipSpaces();
+  }
+
+  const Tag* fen = game.tag("FEN");
+  if (fen)
+    game.valid = game.position.loadFen(fen->value.data, fen->value.length);
+  else
+    game.position.resetBoard();
+
+  while (_it != _end)
+  {
+    const char c = *_it;
+
+    if (isSpace(c))
+      ++_it;
+    else if (c == '{')
+      skipComment();
+    else if (c == ';' || c == '%')
+      skipLine();
+    else if (c == '(')
+      skipVariation();
+    else if (c == ')' || c == '}' || c == ']')
+      ++_it;
+    else if (c == '[')
+    {
+      /* a new game without the result of the previous one */
+      break;
+    }
+    else if (c == '$')
+    {
+      ++_it;
+      token();
+    }
+    else if (c == '*')
+    {
+      game.result = Span(_it++, 1);
+      break;
+    }
+    else
+    {
+      Span san = token();
+
+      if (san == "1-0" || san == "0-1" || san == "1/2-1/2")
+      {
+        game.result = san;
+        break;
+      }
+
+      /* move numbers, also glued to the move as in 12.e4 or 12...Nf6 */
+      if (san.data[0] >= '0' && san.data[0] <= '9' && !(san.length >= 3 && san.data[1] == '-'))
+      {
+        size_t skip = 0;
+        while (skip < san.length && san.data[skip] >= '0' && san.data[skip] <= '9')
+          ++skip;
+        while (skip < san.length && san.data[skip] == '.')
+          ++skip;
+
+        san = Span(san.data + skip, san.length - skip);
+      }
+
+      if (san.empty() || !game.valid)
+        continue;
+
+      Move move(point_t(-1, -1), point_t(-1, -1));
+
+      if (game.position.parseSan(san.data, san.length, move))
+      {
+        game.position.play(move);
+        game.moves.push_back(move);
+      }
+      else
+        game.valid = false;
+    }
+  }
+
+  return true;
+}
+
+std::string games::chess::pgn::write(const Chess& game, const std::vector<std::pair<std::string, std::string>>& tags, const std::string& result)
+{
+  static const char* roster[] = { "Event", "Site", "Date", "Round", "White", "Black", "Result" };
+
+  std::string out;
+
+  auto tag = [&out](const std::string& name, const std::string& value) {
+    out += '[' + name + " \"";
+    appendEscaped(out, value);
+    out += "\"]\n";
+  };
+
+  for (const char* name : roster)
+  {
+    auto it = std::find_if(tags.begin(), tags.end(), [name](const std::pair<std::string, std::string>& t) { return t.first == name; });
+
+    if (!strcmp(name, "Result"))
+      tag(name, result);
+    else if (it != tags.end())
+      tag(name, it->second);
+    else
+      tag(name, !strcmp(name, "Date") ? "????.??.??" : "?");
+  }
+
+  if (!game.startFen().empty())
+  {
+    tag("SetUp", "1");
+    tag("FEN", game.startFen());
+  }
+
+  for (const auto& t : tags)
+    if (std::find(std::begin(roster), std::end(roster), t.first) == std::end(roster) && t.first != "SetUp" && t.first != "FEN")
+      tag(t.first, t.second);
+
+  out += '\n';
+
+  /* replayed from the start, SAN depends on the position */
+  Chess replay;
+  if (game.startFen().empty())
+    replay.resetBoard();
+  else
+    replay.loadFen(game.startFen());
+
+  size_t column = 0;
+  bool first = true;
+
+  auto word = [&out, &column](const std::string& text) {
+    if (column && column + 1 + text.size() > 79)
+    {
+      out += '\n';
+      column = 0;
+    }
+    else if (column)
+    {
+      out += ' ';
+      ++column;
+    }
+
+    out += text;
+    column += text.size();
+  };
+
+  for (const Move& move : game.history())
+  {
+    const bool white = replay.currentPlayer().color == Color::White;
+
+    if (white)
+      word(std::to_string(replay.fullmove()) + '.');
+    else if (first)
+      word(std::to_string(replay.fullmove()) + "...");
+
+    word(replay.san(move));
+    replay.play(move);
+    first = false;
+  }
+
+  word(result);
+  out += "\n\n";
+
+  return out;
+}
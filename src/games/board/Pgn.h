@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Common.h"
+#include "games/board/Chess.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace games
+{
+  namespace chess
+  {
+    namespace pgn
+    {
+      /* a piece of the input, nothing is copied so it's valid as long as the buffer is */
+      struct Span
+      {
+        const char* data;
+        size_t length;
+
+        Span() : data(nullptr), length(0) { }
+        Span(const char* data, size_t length) : data(data), length(length) { }
+
+        bool empty() const { return length == 0; }
+        bool operator==(const char* string) const;
+
+        std::string str() const { return std::string(data, length); }
+      };
+
+      /* values keep their \" and \\ escapes, they're rare enough to be undone by the caller */
+      struct Tag
+      {
+        Span name;
+        Span value;
+      };
+
+      struct Game
+      {
+        std::vector<Tag> tags;
+        std::vector<Move> moves;
+        Span result;
+
+        /* the position after the last decoded move */
+        Chess position;
+
+        /* false if the setup or a move couldn't be decoded, moves stops before it */
+        bool valid;
+
+        Game() : valid(true) { }
+
+        const Tag* tag(const char* name) const;
+      };
+
+      /* streams games out of a buffer, usually a MappedFile; a Game can be reused
+         between calls so that its vectors don't allocate once they've grown */
+      class Reader
+      {
+      private:
+        const char* _it;
+        const char* _end;
+
+        void skipSpaces();
+        void skipLine();
+        void skipComment();
+        void skipVariation();
+
+        bool readTag(Tag& tag);
+        Span token();
+
+      public:
+        Reader(const void* data, size_t size) : _it(static_cast<const char*>(data)), _end(_it + size) { }
+
+        /* false once the input is over */
+        bool next(Game& game);
+
+        bool eof() const { return _it == _end; }
+      };
+
+      /* the history of the game with the seven tag roster first, missing values become "?" */
+      std::string write(const Chess& game, const std::vector<std::pair<std::string, std::string>>& tags, const std::string& result);
+    }
+  }
+}
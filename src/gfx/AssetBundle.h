@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Common.h"
+
+#include <vector>
+
+/* assets.bin, an atlas already decoded in the pixel format the renderer wants,
+   written by tools/assetpack.cpp at build time and mmapped at startup; it doesn't
+   depend on SDL so that the host tool can share it */
+namespace bundle
+{
+  constexpr u32 VERSION = 1;
+
+  enum class PixelFormat : u32 { ARGB8888 = 1, ABGR8888 = 2 };
+
+  struct Header
+  {
+    char magic[4];
+    u32 version;
+    PixelFormat format;
+    u16 width;
+    u16 height;
+    u32 pitch;
+    u32 images;
+    u64 pixels; // offset of height rows of pitch bytes
+  };
+
+  struct Entry
+  {
+    char name[24]; // nul terminated
+    u16 x, y, w, h;
+  };
+
+  static_assert(sizeof(Header) == 32, "bundle header layout");
+  static_assert(sizeof(Entry) == 32, "bundle entry layout");
+
+  constexpr s32 PADDING = 1;
+
+  struct Placement
+  {
+    s32 x, y;
+  };
+
+  /* shelf packing, tallest first, on a power of two sheet at least 256 wide which
+     fits the widest image; returns the position of each size in input order */
+  inline std::vector<Placement> pack(const std::vector<size2d_t>& sizes, size2d_t& sheet)
+  {
+    auto nextPowerOfTwo = [](s32 value) {
+      s32 result = 1;
+      while (result < value)
+        result <<= 1;
+      return result;
+    };
+
+    std::vector<size_t> order(sizes.size());
+    for (size_t i = 0; i < order.size(); ++i)
+      order[i] = i;
+
+    std::stable_sort(order.begin(), order.end(), [&sizes](size_t a, size_t b) { return sizes[a].h > sizes[b].h; });
+
+    s32 width = 256;
+    for (const size2d_t& size : sizes)
+      width = std::max(width, nextPowerOfTwo(size.w + PADDING));
+
+    std::vector<Placement> placements(sizes.size());
+
+    s32 x = 0, y = 0, shelf = 0;
+    for (size_t i : order)
+    {
+      const s32 w = sizes[i].w + PADDING, h = sizes[i].h + PADDING;
+
+      if (x + w > width)
+      {
+        x = 0;
+        y += shelf;
+        shelf = 0;
+      }
+
+      placements[i] = { x, y };
+
+      x += w;
+      shelf = std::max(shelf, h);
+    }
+
+    sheet = size2d_t(width, nextPowerOfTwo(y + shelf));
+    return placements;
+  }
+}
@@ -0,0 +1,238 @@
+#include "Assets.h"
+
+#include "AssetBundle.h"
+#include "MappedFile.h"
+
+#include "SDL_image.h"
+
+#include <cstdio>
+
+SDL_Surface* Assets::loadSurface(const path& path)
+{
+  /* SDL_image is brought up only if something has to be decoded */
+  if (!_imageInit)
+  {
+    if (IMG_Init(IMG_INIT_PNG) != IMG_INIT_PNG)
+    {
+      printf("Error on IMG_Init().\n");
+      return nullptr;
+    }
+    _imageInit = true;
+  }
+
+  SDL_Surface* loaded = IMG_Load(path.c_str());
+
+  if (!loaded)
+  {
+    printf("Error loading %s: %s\n", path.c_str(), IMG_GetError());
+    return nullptr;
+  }
+
+  /* same layout for every source so that they can be copied in the atlas as they are */
+  SDL_Surface* surface = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+  SDL_FreeSurface(loaded);
+
+  return surface;
+}
+
+SDL_Texture* Assets::createTexture(SDL_Surface* surface)
+{
+  SDL_Texture* texture = SDL_CreateTextureFromSurface(_renderer, surface);
+
+  if (texture)
+  {
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+    _textures.push_back(texture);
+    ++_stats.textures;
+    _stats.textureBytes += u64(surface->w) * surface->h * 4;
+
+    /* every surface has been converted to RGBA32 */
+    keep(texture, static_cast<const u8*>(surface->pixels), surface->w, surface->h, surface->pitch, false);
+  }
+
+  return texture;
+}
+
+void Assets::keep(SDL_Texture* texture, const u8* data, s32 width, s32 height, s32 pitch, bool swapped)
+{
+  if (!_keepPixels)
+    return;
+
+  Pixmap& pixmap = _pixels[texture] = Pixmap(width, height);
+  const u32 r = swapped ? 2 : 0, b = swapped ? 0 : 2;
+
+  for (s32 y = 0; y < height; ++y)
+  {
+    const u8* from = data + size_t(y) * pitch;
+    u32* to = pixmap.row(y);
+
+    for (s32 x = 0; x < width; ++x, from += 4)
+      to[x] = (u32(from[3]) << 24) | (u32(from[r]) << 16) | (u32(from[1]) << 8) | from[b];
+  }
+}
+
+bool Assets::preload(const std::vector<path>& paths)
+{
+  const u64 start = SDL_GetPerformanceCounter();
+
+  std::vector<const path*> files;
+  std::vector<SDL_Surface*> surfaces;
+  std::vector<size2d_t> sizes;
+  bool success = true;
+
+  for (const path& file : paths)
+  {
+    if (_images.find(file) != _images.end())
+      continue;
+
+    SDL_Surface* surface = loadSurface(file);
+
+    if (surface)
+    {
+      files.push_back(&file);
+      surfaces.push_back(surface);
+      sizes.push_back(size2d_t(surface->w, surface->h));
+    }
+    else
+      success = false;
+  }
+
+  if (surfaces.empty())
+    return success;
+
+  size2d_t sheet(0, 0);
+  const auto placements = bundle::pack(sizes, sheet);
+
+  SDL_Surface* atlas = SDL_CreateRGBSurfaceWithFormat(0, sheet.w, sheet.h, 32, SDL_PIXELFORMAT_RGBA32);
+
+  for (size_t i = 0; i < surfaces.size(); ++i)
+  {
+    SDL_Rect to = { placements[i].x, placements[i].y, sizes[i].w, sizes[i].h };
+
+    /* copy the alpha as it is instead of blending it over the empty sheet */
+    SDL_SetSurfaceBlendMode(surfaces[i], SDL_BLENDMODE_NONE);
+    SDL_BlitSurface(surfaces[i], nullptr, atlas, &to);
+  }
+
+  SDL_Texture* texture = createTexture(atlas);
+  SDL_FreeSurface(atlas);
+
+  for (size_t i = 0; i < surfaces.size(); ++i)
+  {
+    if (texture)
+      _images[*files[i]] = Image(texture, rect_t(placements[i].x, placements[i].y, sizes[i].w, sizes[i].h));
+    SDL_FreeSurface(surfaces[i]);
+  }
+
+  _stats.images = _images.size();
+  _stats.loadMilliseconds += 1000.0f * (SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+  LOGD("assets: %u images packed in a %dx%d atlas, %u textures, %u KB, %.1f ms", u32(surfaces.size()), sheet.w, sheet.h,
+    _stats.textures, u32(_stats.textureBytes / 1024), _stats.loadMilliseconds);
+
+  return success && texture;
+}
+
+bool Assets::loadBundle(const path& path)
+{
+  const u64 start = SDL_GetPerformanceCounter();
+
+  MappedFile file;
+  if (!file.open(path) || file.size() < sizeof(bundle::Header))
+    return false;
+
+  const bundle::Header* header = file.at<bundle::Header>(0);
+
+  if (memcmp(header->magic, "ENAB", 4) != 0 || header->version != bundle::VERSION ||
+    file.size() < sizeof(bundle::Header) + header->images * sizeof(bundle::Entry) ||
+    file.size() < header->pixels + u64(header->pitch) * header->height)
+  {
+    printf("Error loading %s: invalid bundle\n", path.c_str());
+    return false;
+  }
+
+  const u32 format = header->format == bundle::PixelFormat::ARGB8888 ? SDL_PIXELFORMAT_ARGB8888 : SDL_PIXELFORMAT_ABGR8888;
+
+  /* pixels go from the mapping straight to the texture */
+  SDL_Texture* texture = SDL_CreateTexture(_renderer, format, SDL_TEXTUREACCESS_STATIC, header->width, header->height);
+
+  if (!texture || SDL_UpdateTexture(texture, nullptr, file.data() + header->pixels, header->pitch) != 0)
+  {
+    printf("Error loading %s: %s\n", path.c_str(), SDL_GetError());
+    if (texture)
+      SDL_DestroyTexture(texture);
+    return false;
+  }
+
+  SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+  _textures.push_back(texture);
+  ++_stats.textures;
+  _stats.textureBytes += u64(header->pitch) * header->height;
+
+  /* packed 32 bit values stored little endian, ARGB8888 is B, G, R, A in memory */
+  keep(texture, file.data() + header->pixels, header->width, header->height, header->pitch, header->format == bundle::PixelFormat::ARGB8888);
+
+  const bundle::Entry* entries = file.at<bundle::Entry>(sizeof(bundle::Header));
+
+  for (u32 i = 0; i < header->images; ++i)
+  {
+    const bundle::Entry& entry = entries[i];
+    const utf8_string name(entry.name, strnlen(entry.name, sizeof(entry.name)));
+
+    _images[name] = Image(texture, rect_t(entry.x, entry.y, entry.w, entry.h));
+  }
+
+  _stats.images = _images.size();
+  _stats.loadMilliseconds += 1000.0f * (SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+  LOGD("assets: %u images from %s, %dx%d atlas, %u KB, %.1f ms", header->images, path.c_str(), header->width, header->height,
+    u32(_stats.textureBytes / 1024), _stats.loadMilliseconds);
+
+  return true;
+}
+
+const Image& Assets::image(const path& path)
+{
+  auto it = _images.find(path);
+
+  if (it == _images.end())
+  {
+    const u64 start = SDL_GetPerformanceCounter();
+
+    Image image;
+    SDL_Surface* surface = loadSurface(path);
+
+    if (surface)
+    {
+      image = Image(createTexture(surface), rect_t(0, 0, surface->w, surface->h));
+      SDL_FreeSurface(surface);
+    }
+
+    /* failures are cached too, so a missing file is reported once */
+    it = _images.insert(std::make_pair(path, image)).first;
+
+    _stats.images = _images.size();
+    _stats.loadMilliseconds += 1000.0f * (SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+  }
+
+  return it->second;
+}
+
+void Assets::release()
+{
+  for (SDL_Texture* texture : _textures)
+    SDL_DestroyTexture(texture);
+
+  _textures.clear();
+  _images.clear();
+  _pixels.clear();
+  _stats = { 0, 0, 0, 0.0f };
+
+  if (_imageInit)
+  {
+    IMG_Quit();
+    _imageInit = false;
+  }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Common.h"
+#include "Pixmap.h"
+
+#include "SDL.h"
+
+#include <unordered_map>
+#include <vector>
+
+/* a region of a texture, sprites packed in the atlas share the same texture */
+struct Image
+{
+  SDL_Texture* texture;
+  rect_t rect;
+
+  Image() : texture(nullptr), rect(0, 0, 0, 0) { }
+  Image(SDL_Texture* texture, const rect_t& rect) : texture(texture), rect(rect) { }
+
+  bool isValid() const { return texture != nullptr; }
+};
+
+/* owns every texture loaded from disk, images are deduplicated by path */
+class Assets
+{
+public:
+  struct Stats
+  {
+    u32 images;
+    u32 textures;
+    u64 textureBytes;
+    float loadMilliseconds;
+  };
+
+private:
+  SDL_Renderer* _renderer;
+  bool _imageInit;
+
+  std::unordered_map<path, Image> _images;
+  std::vector<SDL_Texture*> _textures;
+
+  /* copies of the textures for the software framebuffer, which can't read them back */
+  bool _keepPixels;
+  std::unordered_map<SDL_Texture*, Pixmap> _pixels;
+
+  Stats _stats;
+
+  SDL_Surface* loadSurface(const path& path);
+  SDL_Texture* createTexture(SDL_Surface* surface);
+
+  /* rows of bytes in R, G, B, A order or, when swapped, B, G, R, A */
+  void keep(SDL_Texture* texture, const u8* data, s32 width, s32 height, s32 pitch, bool swapped);
+
+public:
+  Assets() : _renderer(nullptr), _imageInit(false), _keepPixels(false), _stats({ 0, 0, 0, 0.0f }) { }
+
+  void init(SDL_Renderer* renderer, bool keepPixels = false) { _renderer = renderer; _keepPixels = keepPixels; }
+
+  /* decodes every file up front and packs them into a single texture,
+     paths which are already loaded are skipped */
+  bool preload(const std::vector<path>& paths);
+
+  /* registers the images of a prebuilt atlas, see AssetBundle.h, nothing is decoded */
+  bool loadBundle(const path& path);
+
+  /* cached image for the path, decoded in its own texture if it wasn't preloaded */
+  const Image& image(const path& path);
+
+  /* nullptr unless pixels are kept */
+  const Pixmap* pixels(SDL_Texture* texture) const
+  {
+    auto it = _pixels.find(texture);
+    return it != _pixels.end() ? &it->second : nullptr;
+  }
+
+  const Stats& stats() const { return _stats; }
+
+  void release();
+};
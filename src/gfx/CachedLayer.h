@@ -0,0 +1,60 @@
+#pragma once
+
+#include "ViewManager.h"
+
+namespace ui
+{
+  /* a screen sized render target holding the part of a view which rarely changes,
+     it's drawn again only when the key it was built with changes or targets are lost */
+  class CachedLayer
+  {
+  private:
+    SDL_Texture* _texture;
+    u64 _key;
+    u32 _generation;
+    bool _valid;
+
+  public:
+    CachedLayer() : _texture(nullptr), _key(0), _generation(0), _valid(false) { }
+
+    void invalidate() { _valid = false; }
+
+    bool isValid(const ViewManager* gvm, u64 key) const
+    {
+      return _valid && _key == key && _generation == gvm->targetGeneration();
+    }
+
+    /* draw is invoked with the usual ViewManager API, what it records ends up in the layer */
+    template<typename F> void update(ViewManager* gvm, u64 key, F draw)
+    {
+      if (isValid(gvm, key))
+        return;
+
+      if (!_texture)
+      {
+        _texture = SDL_CreateTexture(gvm->renderer(), SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, WIDTH, HEIGHT);
+        SDL_SetTextureBlendMode(_texture, SDL_BLENDMODE_BLEND);
+      }
+
+      gvm->prerender(_texture, draw);
+
+      _key = key;
+      _generation = gvm->targetGeneration();
+      _valid = true;
+    }
+
+    void draw(ViewManager* gvm) { gvm->blit(_texture, 0, 0); }
+
+    void release(ViewManager* gvm)
+    {
+      if (_texture)
+      {
+        gvm->forget(_texture);
+        SDL_DestroyTexture(_texture);
+      }
+
+      _texture = nullptr;
+      _valid = false;
+    }
+  };
+}
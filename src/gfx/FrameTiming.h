@@ -0,0 +1,141 @@
+#pragma once
+
+#include "Common.h"
+
+#include "SDL.h"
+
+#include <array>
+#include <vector>
+
+/* keeps frames on a fixed period measured with the performance counter: it sleeps
+   with SDL_Delay until close to the deadline, then spins the rest to avoid the
+   millisecond granularity of the scheduler */
+class FramePacer
+{
+private:
+  u64 _frequency;
+  u64 _period;
+  u64 _spin;
+  u64 _deadline;
+  bool _vsync;
+
+public:
+  FramePacer() : _frequency(SDL_GetPerformanceFrequency()), _period(0), _spin(0), _deadline(0), _vsync(false)
+  {
+    setFrameRate(60);
+  }
+
+  void setFrameRate(u32 frameRate)
+  {
+    _period = _frequency / frameRate;
+    _spin = _frequency * 2 / 1000;
+  }
+
+  /* with vsync the present already blocks until the next refresh */
+  void setVSync(bool vsync) { _vsync = vsync; }
+  bool vsync() const { return _vsync; }
+
+  u64 period() const { return _period; }
+  u64 frequency() const { return _frequency; }
+
+  /* whole milliseconds left before the deadline, rounded up */
+  u32 remaining() const
+  {
+    const u64 now = SDL_GetPerformanceCounter();
+    return now < _deadline ? u32(((_deadline - now) * 1000 + _frequency - 1) / _frequency) : 0;
+  }
+
+  void wait()
+  {
+    u64 now = SDL_GetPerformanceCounter();
+
+    if (!_vsync && now < _deadline)
+    {
+      const u64 remaining = _deadline - now;
+
+      if (remaining > _spin)
+        SDL_Delay(u32((remaining - _spin) * 1000 / _frequency));
+
+      while ((now = SDL_GetPerformanceCounter()) < _deadline)
+        ;
+    }
+
+    advance(now);
+  }
+
+  /* moves to the next deadline without waiting for the current one */
+  void advance(u64 now)
+  {
+    /* after an idle wait or a long frame the schedule restarts from now instead of rushing to catch up */
+    if (now < _deadline || now - _deadline > _period)
+      _deadline = now + _period;
+    else
+      _deadline += _period;
+  }
+};
+
+/* ring buffers with the timings of the last frames, in milliseconds, latency
+   is pushed only by frames which had some input to show */
+class FrameStats
+{
+public:
+  enum Phase { Frame, Update, Render, Present, Latency, PHASES };
+
+  using Sample = std::array<float, PHASES>;
+
+  struct Summary
+  {
+    float p50, p95, p99, max;
+  };
+
+  static constexpr size_t CAPACITY = 240;
+
+private:
+  struct Ring
+  {
+    std::array<float, CAPACITY> values;
+    size_t next;
+    size_t count;
+
+    Ring() : next(0), count(0) { }
+  };
+
+  std::array<Ring, PHASES> _rings;
+
+  mutable std::vector<float> _sorted;
+
+public:
+  void push(Phase phase, float value)
+  {
+    Ring& ring = _rings[phase];
+
+    ring.values[ring.next] = value;
+    ring.next = (ring.next + 1) % CAPACITY;
+    if (ring.count < CAPACITY)
+      ++ring.count;
+  }
+
+  /* every phase but latency */
+  void push(const Sample& sample)
+  {
+    for (size_t i = 0; i < Latency; ++i)
+      push(Phase(i), sample[i]);
+  }
+
+  size_t size(Phase phase) const { return _rings[phase].count; }
+  void clear() { _rings = std::array<Ring, PHASES>(); }
+
+  Summary summarize(Phase phase) const
+  {
+    const Ring& ring = _rings[phase];
+
+    if (!ring.count)
+      return { 0.0f, 0.0f, 0.0f, 0.0f };
+
+    _sorted.assign(ring.values.begin(), ring.values.begin() + ring.count);
+    std::sort(_sorted.begin(), _sorted.end());
+
+    auto at = [this](float p) { return _sorted[std::min(size_t(p * _sorted.size()), _sorted.size() - 1)]; };
+    return { at(0.50f), at(0.95f), at(0.99f), _sorted.back() };
+  }
+};
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "Common.h"
+#include "ViewManager.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+namespace ui
+{
+  /* the interactive regions of a view, registered once whenever its layout changes
+     and bucketed in a uniform grid over the screen: what is under the pointer is
+     found by reading the one bucket it falls in, which holds the few regions that
+     overlap it, so mouse motion costs the same however many regions there are.
+     Where the gamepad moves focus from each region is worked out when building */
+  class HitGrid
+  {
+  public:
+    static constexpr s32 NONE = -1;
+
+  private:
+    static constexpr coord_t BUCKET = 8;
+    static constexpr s32 COLUMNS = WIDTH / BUCKET, ROWS = HEIGHT / BUCKET;
+
+    std::vector<rect_t> _regions;
+    std::vector<s32> _neighbours; // four for each region, in the order of the dpad buttons
+    std::vector<u16> _first; // where the regions of each bucket start in _entries
+    std::vector<u16> _entries;
+
+    static bool contains(const rect_t& rect, point_t p)
+    {
+      return p.x >= rect.x() && p.x < rect.x() + rect.w() && p.y >= rect.y() && p.y < rect.y() + rect.h();
+    }
+
+    template<typename F> static void forEachBucket(const rect_t& rect, F f)
+    {
+      const s32 x1 = std::max(rect.x(), 0) / BUCKET, x2 = std::min(rect.x() + rect.w() - 1, WIDTH - 1) / BUCKET;
+      const s32 y1 = std::max(rect.y(), 0) / BUCKET, y2 = std::min(rect.y() + rect.h() - 1, HEIGHT - 1) / BUCKET;
+
+      for (s32 y = y1; y <= y2; ++y)
+        for (s32 x = x1; x <= x2; ++x)
+          f(y * COLUMNS + x);
+    }
+
+    /* the closest region whose center is that way, within 45 degrees of it, with
+       straying sideways weighing twice as much as distance along the way */
+    s32 closest(s32 region, GamepadButton button) const
+    {
+      const rect_t& from = _regions[region];
+      s32 best = region, bestScore = 0;
+
+      for (s32 i = 0; i < _regions.size(); ++i)
+      {
+        const rect_t& to = _regions[i];
+
+        /* doubled so that centers of odd sizes stay whole */
+        const s32 dx = (2 * to.x() + to.w()) - (2 * from.x() + from.w());
+        const s32 dy = (2 * to.y() + to.h()) - (2 * from.y() + from.h());
+
+        const bool horizontal = button == GamepadButton::DpadLeft || button == GamepadButton::DpadRight;
+        const s32 along = button == GamepadButton::DpadLeft ? -dx : button == GamepadButton::DpadRight ? dx : button == GamepadButton::DpadUp ? -dy : dy;
+        const s32 across = std::abs(horizontal ? dy : dx);
+
+        if (i == region || along <= 0 || across > along)
+          continue;
+
+        const s32 score = along + 2 * across;
+        if (best == region || score < bestScore)
+        {
+          best = i;
+          bestScore = score;
+        }
+      }
+
+      return best;
+    }
+
+  public:
+    void clear()
+    {
+      _regions.clear();
+      _neighbours.clear();
+      _first.clear();
+      _entries.clear();
+    }
+
+    /* returns the index of the region, which is what lookups give back; where regions
+       overlap the one added last wins. Nothing is found until the grid is built again */
+    s32 add(const rect_t& rect)
+    {
+      _regions.push_back(rect);
+      return s32(_regions.size()) - 1;
+    }
+
+    void build()
+    {
+      /* counted first so that the buckets are laid out back to back in one array */
+      _first.assign(COLUMNS * ROWS + 1, 0);
+
+      for (const rect_t& rect : _regions)
+        forEachBucket(rect, [this](s32 bucket) { ++_first[bucket + 1]; });
+
+      for (s32 bucket = 0; bucket < COLUMNS * ROWS; ++bucket)
+        _first[bucket + 1] += _first[bucket];
+
+      std::vector<u16> next(_first.begin(), _first.end() - 1);
+      _entries.resize(_first.back());
+
+      for (s32 region = 0; region < _regions.size(); ++region)
+        forEachBucket(_regions[region], [this, &next, region](s32 bucket) { _entries[next[bucket]++] = u16(region); });
+
+      _neighbours.resize(_regions.size() * 4);
+
+      for (s32 region = 0; region < _regions.size(); ++region)
+        for (s32 button = 0; button < 4; ++button)
+          _neighbours[region * 4 + button] = closest(region, GamepadButton(button));
+    }
+
+    s32 at(point_t p) const
+    {
+      if (p.x < 0 || p.x >= WIDTH || p.y < 0 || p.y >= HEIGHT || _first.empty())
+        return NONE;
+
+      const s32 bucket = (p.y / BUCKET) * COLUMNS + p.x / BUCKET;
+
+      for (u16 i = _first[bucket + 1]; i-- > _first[bucket]; )
+        if (contains(_regions[_entries[i]], p))
+          return _entries[i];
+
+      return NONE;
+    }
+
+    /* where focus goes from the region for a dpad button, the region itself if nothing is that way */
+    s32 neighbour(s32 region, GamepadButton button) const
+    {
+      if (region < 0 || region * 4 >= _neighbours.size() || s32(button) > s32(GamepadButton::DpadDown))
+        return region;
+
+      return _neighbours[region * 4 + s32(button)];
+    }
+
+    const rect_t& rect(s32 region) const { return _regions[region]; }
+    size_t size() const { return _regions.size(); }
+  };
+}
@@ -27,9 +27,21 @@ static const float by = 0.1f;
 static const size2d_t s = { 14, 14 };
 static const size2d_t m = { 20, 20 };
 
-KeyboardView::KeyboardView(ViewManager* gvm) : View(gvm)
+static point_t keyPosition(s32 i, s32 j)
 {
+  return point_t(bounds.origin.x + rows[j].position.x * bounds.size.w + m.w * i, bounds.origin.y + bounds.size.h * by /*rows[j].position.y * bounds.size.h*/ + j * m.h);
+}
+
+KeyboardView::KeyboardView(ViewManager* gvm) : View(gvm), selected(HitGrid::NONE)
+{
+  for (s32 j = 0; j < rows.size(); ++j)
+    for (s32 i = 0; i < rows[j].characters.size(); ++i)
+    {
+      keys.add(rect_t(keyPosition(i, j), s));
+      characters.push_back(rows[j].characters[i]);
+    }
 
+  keys.build();
 }
 
 void KeyboardView::render()
@@ -37,47 +49,47 @@ void KeyboardView::render()
   gvm->fillRect(bounds, { 220, 220, 220, 220 });
   gvm->drawRect(bounds, { 0, 0, 0, 220 });
 
-  auto j = 0;
-  for (const auto& spec : rows)
-  {
-    for (s32 i = 0; i < spec.characters.size(); ++i)
-    {
-      point_t p = point_t(bounds.origin.x + spec.position.x * bounds.size.w + m.w * i, bounds.origin.y + bounds.size.h * by /*spec.position.y * bounds.size.h*/ + j * m.h);
-      drawKeyButton(spec.characters[i], p, selected == point_t{ i, j } ? ButtonState::Hover : ButtonState::Normal);
-    }
-    ++j;
-  }
+  for (s32 key = 0; key < characters.size(); ++key)
+    drawKeyButton(characters[key], keys.rect(key).origin, selected == key ? ButtonState::Hover : ButtonState::Normal);
 
   gvm->text(value, 5, 5, { 0,0,0 }, ui::TextAlign::LEFT, 1.0f);
 }
 
-point_t KeyboardView::characterForCoordinate(point_t position)
+void KeyboardView::select(s32 key)
 {
-  const auto x = position.x, y = position.y;
+  if (key == selected)
+    return;
 
-  auto j = 0;
-  for (const auto& spec : rows)
-  {
-    const auto miny = bounds.origin.y + bounds.size.h * by + m.h * j;
-    const auto maxy = miny + s.h;
-
-    if (y >= miny && y < maxy)
-    {
-      const coord_t bx = x - (bounds.origin.x + spec.position.x * bounds.size.w);
-      const coord_t i = bx / m.w, r = bx % m.h;
+  /* only the two keys whose border changes are drawn again */
+  if (selected != HitGrid::NONE)
+    gvm->invalidate(keys.rect(selected));
+  if (key != HitGrid::NONE)
+    gvm->invalidate(keys.rect(key));
 
-      if (i >= 0 && i < spec.characters.size() && r < s.w)
-        return { i, j };
-    }
-    ++j;
-  }
-
-  return { -1, -1 };
+  selected = key;
 }
 
 void KeyboardView::activate(bool full)
 {
-  selected = { -1, -1 };
+  selected = HitGrid::NONE;
+  gvm->invalidate();
+}
+
+void KeyboardView::handleGamepadEvent(GamepadButton button, bool pressed)
+{
+  if (!pressed)
+    return;
+
+  /* the first press only shows where focus is */
+  if (selected == HitGrid::NONE)
+    select(0);
+  else if (button == GamepadButton::A)
+  {
+    value += characters[selected];
+    gvm->invalidate();
+  }
+  else
+    select(keys.neighbour(selected, button));
 }
 
 void KeyboardView::handleKeyboardEvent(const SDL_Event& event)
@@ -88,17 +100,15 @@ void KeyboardView::handleKeyboardEvent(const SDL_Event& event)
 void KeyboardView::handleMouseEvent(const SDL_Event& event)
 {
   if (event.type == SDL_MOUSEMOTION)
-  {
-    selected = characterForCoordinate({ event.motion.x, event.motion.y });
-  }
+    select(keys.at({ event.motion.x, event.motion.y }));
   else if (event.type == SDL_MOUSEBUTTONUP && event.button.button == SDL_BUTTON_LEFT)
   {
-    selected = characterForCoordinate({ event.motion.x, event.motion.y });
+    selected = keys.at({ event.button.x, event.button.y });
 
-    if (selected.x != -1)
+    if (selected != HitGrid::NONE)
     {
-      auto c = rows[selected.y].characters[selected.x];
-      value += c;
+      value += characters[selected];
+      gvm->invalidate();
     }
   }
 }
@@ -107,5 +117,5 @@ void KeyboardView::drawKeyButton(utf8_char character, point_t p, ButtonState sta
 {
   gvm->fillRect(rect_t(p, s), { 255, 255, 255 });
   gvm->drawRect({ p, s }, state == ButtonState::Hover ? color_t{ 255, 0, 0} : color_t{ 0, 0, 0 });
-  gvm->text(std::string("") + character, p.x + s.w/2, p.y + s.h/4 - 1, { 0, 0, 0 }, ui::TextAlign::CENTER, 1.0f);
+  gvm->text(&character, 1, p.x + s.w/2, p.y + s.h/4 - 1, { 0, 0, 0 }, ui::TextAlign::CENTER, 1.0f);
 }
\ No newline at end of file
@@ -9,9 +9,14 @@ using namespace ui;
 
 extern GameRenderer* irenderer;
 
-MainView::MainView(ViewManager* gvm) : View(gvm)
+MainView::MainView(ViewManager* gvm) : MainView(gvm, irenderer)
 {
-  this->renderer = irenderer;
+}
+
+MainView::MainView(ViewManager* gvm, GameRenderer* renderer) : View(gvm), renderer(renderer)
+{
+  if (renderer)
+    renderer->attach(gvm);
 }
 
 void MainView::render()
@@ -29,6 +34,11 @@ void MainView::handleKeyboardEvent(const SDL_Event& event)
     switch (event.key.keysym.sym)
     {
     case SDLK_ESCAPE: gvm->exit(); break;
+    default:
+      if (renderer)
+        renderer->keyPressed(event.key.keysym.sym);
+      gvm->invalidate();
+      break;
     }
   }
 }
@@ -37,12 +47,14 @@ void MainView::handleGamepadEvent(GamepadButton button, bool pressed)
 {
   if (renderer)
     renderer->gamepadButton(button, pressed);
+  gvm->invalidate();
 }
 
 void MainView::handleMouseEvent(const SDL_Event& event)
 {
   if (event.type == SDL_MOUSEMOTION)
   {
+    /* motion only damages what the renderer reports */
     if (renderer)
       renderer->mouseMoved({ event.motion.x, event.motion.y });
     
@@ -56,5 +68,6 @@ void MainView::handleMouseEvent(const SDL_Event& event)
     if (renderer)
       //TODO: add other buttons
       renderer->mouseButton({ event.button.x, event.button.y }, ui::MouseButton::Left, event.type == SDL_MOUSEBUTTONDOWN);
+    gvm->invalidate();
   }
 }
\ No newline at end of file
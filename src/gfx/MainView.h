@@ -1,18 +1,40 @@
 #pragma once
 
+#include "HitGrid.h"
 #include "ViewManager.h"
 #include "Common.h"
+#include "Snapshot.h"
 
 namespace ui
 {
   class GameRenderer
   {
+  protected:
+    ViewManager* gvm = nullptr; // to report what has to be redrawn
+
   public:
+    virtual ~GameRenderer() { }
+
+    void attach(ViewManager* gvm) { this->gvm = gvm; }
+
     virtual void render(ViewManager* gvm) = 0;
     virtual void mouseMoved(point_t p) = 0;
     virtual void mouseButton(point_t p, MouseButton button, bool pressed) { }
     virtual void gamepadButton(GamepadButton button, bool pressed) { }
+    virtual void keyPressed(SDL_Keycode key) { }
+
+    /* writes whole sections, restore gets each section of the snapshot and tells whether it was its own */
+    virtual void save(snapshot::Writer& out) const { }
+    virtual bool restore(u32 tag, snapshot::Reader& in) { return false; }
+
+    /* picks up results of background work, called when a worker posts an SDL_USEREVENT */
+    virtual void poll() { }
   };
+
+  /* defined next to each renderer */
+  GameRenderer* createChessRenderer();
+  GameRenderer* createCheckersRenderer();
+  GameRenderer* createCrosswordRenderer();
   
   class MainView : public View
   {
@@ -21,12 +43,17 @@ namespace ui
 
   public:
     MainView(ViewManager* gvm);
+    MainView(ViewManager* gvm, GameRenderer* renderer);
 
     void render() override;
 
     void handleGamepadEvent(GamepadButton button, bool pressed) override;
     void handleKeyboardEvent(const SDL_Event& event) override;
     void handleMouseEvent(const SDL_Event& event) override;
+    void handleUserEvent(const SDL_Event& event) override { if (renderer) renderer->poll(); }
+
+    void save(snapshot::Writer& out) const { if (renderer) renderer->save(out); }
+    bool restore(u32 tag, snapshot::Reader& in) { return renderer && renderer->restore(tag, in); }
   };
 
   class KeyboardView : public View
@@ -36,11 +63,13 @@ namespace ui
     
     utf8_string value;
 
-    point_t selected;
+    /* a region for each key in the order of the rows, the layout never changes */
+    HitGrid keys;
+    std::vector<utf8_char> characters;
+    s32 selected;
 
     void drawKeyButton(utf8_char character, point_t position, ButtonState state);
-
-    point_t characterForCoordinate(point_t position);
+    void select(s32 key);
 
   public:
     KeyboardView(ViewManager* gvm);
@@ -48,7 +77,7 @@ namespace ui
     void activate(bool full) override;
 
     void render() override;
-    void handleGamepadEvent(GamepadButton button, bool pressed) override { }
+    void handleGamepadEvent(GamepadButton button, bool pressed) override;
     void handleKeyboardEvent(const SDL_Event& event) override;
     void handleMouseEvent(const SDL_Event& event) override;
   };
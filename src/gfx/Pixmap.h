@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Common.h"
+
+#include <vector>
+
+/* pixels in memory as packed 0xAARRGGBB, which is SDL_PIXELFORMAT_ARGB8888 */
+struct Pixmap
+{
+  s32 width;
+  s32 height;
+  std::vector<u32> pixels;
+
+  Pixmap() : width(0), height(0) { }
+  Pixmap(s32 width, s32 height) : width(width), height(height), pixels(size_t(width) * height, 0) { }
+
+  u32* row(s32 y) { return pixels.data() + size_t(y) * width; }
+  const u32* row(s32 y) const { return pixels.data() + size_t(y) * width; }
+
+  s32 pitch() const { return width * sizeof(u32); }
+};
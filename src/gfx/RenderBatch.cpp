@@ -0,0 +1,221 @@
+#include "RenderBatch.h"
+
+#include "SoftwareRenderer.h"
+
+size2d_t RenderBatch::textureSize(SDL_Texture* texture)
+{
+  auto it = _sizes.find(texture);
+
+  if (it == _sizes.end())
+  {
+    u32 format;
+    int access, w = 0, h = 0;
+    SDL_QueryTexture(texture, &format, &access, &w, &h);
+    it = _sizes.insert(std::make_pair(texture, size2d_t(w, h))).first;
+  }
+
+  return it->second;
+}
+
+void RenderBatch::sort()
+{
+  _order.resize(_primitives.size());
+  for (u32 i = 0; i < _order.size(); ++i)
+    _order[i] = i;
+
+  std::stable_sort(_order.begin(), _order.end(), [this](u32 a, u32 b) {
+    const Primitive& pa = _primitives[a];
+    const Primitive& pb = _primitives[b];
+
+    if (pa.layer != pb.layer)
+      return pa.layer < pb.layer;
+    else if (pa.texture != pb.texture)
+      return std::less<SDL_Texture*>()(pa.texture, pb.texture);
+    else
+      return pa.kind < pb.kind;
+  });
+}
+
+void RenderBatch::flush(SoftwareRenderer& renderer)
+{
+  renderer.clip(_clipped ? &_clip : nullptr);
+
+  if (_clear)
+  {
+    renderer.clear(color_t(_clearColor.r, _clearColor.g, _clearColor.b, 255));
+    _clear = false;
+  }
+
+  _stats.primitives += _primitives.size();
+
+  sort();
+
+  SDL_Texture* texture = nullptr;
+
+  for (u32 i : _order)
+  {
+    const Primitive& p = _primitives[i];
+
+    if (p.texture != texture)
+    {
+      texture = p.texture;
+      ++_stats.textureSwitches;
+    }
+
+    if (p.kind == Kind::Line)
+      renderer.line(p.dst.x, p.dst.y, p.dst.w, p.dst.h, p.color);
+    else if (p.texture)
+      renderer.blit(p.texture, p.src, p.dst, p.color);
+    else
+      renderer.fill(p.dst, p.color);
+  }
+
+  _primitives.clear();
+}
+
+void RenderBatch::flush(SDL_Renderer* renderer)
+{
+  SDL_RenderSetClipRect(renderer, _clipped ? &_clip : nullptr);
+
+  if (_clear)
+  {
+    SDL_SetRenderDrawColor(renderer, _clearColor.r, _clearColor.g, _clearColor.b, 255);
+
+    /* SDL_RenderClear ignores the clip rect */
+    if (_clipped)
+      SDL_RenderFillRect(renderer, &_clip);
+    else
+      SDL_RenderClear(renderer);
+
+    ++_stats.drawCalls;
+    _clear = false;
+  }
+
+  _stats.primitives += _primitives.size();
+
+  sort();
+
+  const u32* it = _order.data();
+  const u32* end = it + _order.size();
+  SDL_Texture* texture = nullptr;
+
+  while (it != end)
+  {
+    const Primitive& first = _primitives[*it];
+
+    const u32* run = it;
+    while (run != end && _primitives[*run].layer == first.layer && _primitives[*run].texture == first.texture && _primitives[*run].kind == first.kind)
+      ++run;
+
+    if (first.texture != texture)
+    {
+      texture = first.texture;
+      ++_stats.textureSwitches;
+    }
+
+    if (first.kind == Kind::Line)
+    {
+      for (const u32* i = it; i != run; ++i)
+        submitLine(renderer, _primitives[*i]);
+    }
+    else
+      submitQuads(renderer, it, run);
+
+    it = run;
+  }
+
+  _primitives.clear();
+
+  if (_clipped)
+    SDL_RenderSetClipRect(renderer, nullptr);
+}
+
+void RenderBatch::submitLine(SDL_Renderer* renderer, const Primitive& line)
+{
+  SDL_SetRenderDrawColor(renderer, line.color.r, line.color.g, line.color.b, line.color.a);
+  SDL_RenderDrawLine(renderer, line.dst.x, line.dst.y, line.dst.w, line.dst.h);
+  ++_stats.drawCalls;
+}
+
+#if RENDER_GEOMETRY
+
+/* a run of quads sharing the texture is a single call, color goes in the vertices */
+void RenderBatch::submitQuads(SDL_Renderer* renderer, const u32* begin, const u32* end)
+{
+  SDL_Texture* texture = _primitives[*begin].texture;
+
+  float sx = 0.0f, sy = 0.0f;
+  if (texture)
+  {
+    const size2d_t size = textureSize(texture);
+    sx = 1.0f / size.w;
+    sy = 1.0f / size.h;
+  }
+
+  _vertices.clear();
+  _indices.clear();
+
+  for (const u32* i = begin; i != end; ++i)
+  {
+    const Primitive& p = _primitives[*i];
+    const SDL_Color color = { p.color.r, p.color.g, p.color.b, p.color.a };
+    const int base = _vertices.size();
+
+    const float x1 = p.dst.x, y1 = p.dst.y, x2 = p.dst.x + p.dst.w, y2 = p.dst.y + p.dst.h;
+    const float u1 = p.src.x * sx, v1 = p.src.y * sy, u2 = (p.src.x + p.src.w) * sx, v2 = (p.src.y + p.src.h) * sy;
+
+    _vertices.push_back({ { x1, y1 }, color, { u1, v1 } });
+    _vertices.push_back({ { x2, y1 }, color, { u2, v1 } });
+    _vertices.push_back({ { x2, y2 }, color, { u2, v2 } });
+    _vertices.push_back({ { x1, y2 }, color, { u1, v2 } });
+
+    const int indices[] = { base, base + 1, base + 2, base, base + 2, base + 3 };
+    _indices.insert(_indices.end(), indices, indices + 6);
+  }
+
+  SDL_RenderGeometry(renderer, texture, _vertices.data(), _vertices.size(), _indices.data(), _indices.size());
+  ++_stats.drawCalls;
+}
+
+#else
+
+/* without geometry support consecutive quads of the same color share the state change */
+void RenderBatch::submitQuads(SDL_Renderer* renderer, const u32* begin, const u32* end)
+{
+  SDL_Texture* texture = _primitives[*begin].texture;
+
+  while (begin != end)
+  {
+    const color_t color = _primitives[*begin].color;
+
+    const u32* run = begin;
+    while (run != end && _primitives[*run].color == color)
+      ++run;
+
+    if (texture)
+    {
+      SDL_SetTextureColorMod(texture, color.r, color.g, color.b);
+      SDL_SetTextureAlphaMod(texture, color.a);
+
+      for (const u32* i = begin; i != run; ++i)
+      {
+        SDL_RenderCopy(renderer, texture, &_primitives[*i].src, &_primitives[*i].dst);
+        ++_stats.drawCalls;
+      }
+    }
+    else
+    {
+      _rects.clear();
+      for (const u32* i = begin; i != run; ++i)
+        _rects.push_back(_primitives[*i].dst);
+
+      SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+      SDL_RenderFillRects(renderer, _rects.data(), _rects.size());
+      ++_stats.drawCalls;
+    }
+
+    begin = run;
+  }
+}
+
+#endif
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "Common.h"
+
+#include "SDL.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+#define RENDER_GEOMETRY true
+#else
+#define RENDER_GEOMETRY false
+#endif
+
+class SoftwareRenderer;
+
+/* records the draw calls of a frame and submits them in as few SDL calls as
+   possible: inside a layer primitives are reordered by texture (untextured
+   first), so anything which must be painted over something else drawn with a
+   different texture has to go in a later layer */
+class RenderBatch
+{
+public:
+  struct Stats
+  {
+    u32 drawCalls;
+    u32 primitives;
+    u32 textureSwitches;
+
+    Stats() : drawCalls(0), primitives(0), textureSwitches(0) { }
+
+    Stats& operator+=(const Stats& o)
+    {
+      drawCalls += o.drawCalls;
+      primitives += o.primitives;
+      textureSwitches += o.textureSwitches;
+      return *this;
+    }
+  };
+
+private:
+  enum class Kind : u8 { Quad, Line };
+
+  struct Primitive
+  {
+    SDL_Texture* texture;
+    SDL_Rect src;
+    SDL_Rect dst; // for lines x, y, w, h are the two endpoints
+    color_t color;
+    u32 layer;
+    Kind kind;
+  };
+
+  std::vector<Primitive> _primitives;
+  std::vector<u32> _order;
+
+#if RENDER_GEOMETRY
+  std::vector<SDL_Vertex> _vertices;
+  std::vector<int> _indices;
+#endif
+  std::vector<SDL_Rect> _rects;
+
+  std::unordered_map<SDL_Texture*, size2d_t> _sizes;
+
+  bool _clear;
+  color_t _clearColor;
+  u32 _layer;
+
+  bool _clipped;
+  SDL_Rect _clip;
+
+  Stats _stats;
+
+  void push(SDL_Texture* texture, const SDL_Rect& src, const SDL_Rect& dst, color_t color, Kind kind)
+  {
+    _primitives.push_back({ texture, src, dst, color, _layer, kind });
+  }
+
+  /* fills _order with the order primitives are submitted in */
+  void sort();
+
+  void submitQuads(SDL_Renderer* renderer, const u32* begin, const u32* end);
+  void submitLine(SDL_Renderer* renderer, const Primitive& line);
+
+public:
+  RenderBatch() : _clear(false), _clearColor(0, 0, 0), _layer(0), _clipped(false), _clip({ 0, 0, 0, 0 }) { }
+
+  /* everything recorded so far would be painted over, so it's dropped */
+  void clear(color_t color)
+  {
+    _primitives.clear();
+    _clear = true;
+    _clearColor = color;
+  }
+
+  void fill(const SDL_Rect& rect, color_t color)
+  {
+    if (rect.w > 0 && rect.h > 0)
+      push(nullptr, rect, rect, color, Kind::Quad);
+  }
+
+  /* same pixels as SDL_RenderDrawRect */
+  void outline(const SDL_Rect& r, color_t color)
+  {
+    fill({ r.x, r.y, r.w, 1 }, color);
+    if (r.h > 1)
+      fill({ r.x, r.y + r.h - 1, r.w, 1 }, color);
+    fill({ r.x, r.y + 1, 1, r.h - 2 }, color);
+    if (r.w > 1)
+      fill({ r.x + r.w - 1, r.y + 1, 1, r.h - 2 }, color);
+  }
+
+  /* axis aligned lines, the only ones the views draw, become 1 pixel wide quads */
+  void line(int x1, int y1, int x2, int y2, color_t color)
+  {
+    if (y1 == y2)
+      fill({ std::min(x1, x2), y1, std::abs(x2 - x1) + 1, 1 }, color);
+    else if (x1 == x2)
+      fill({ x1, std::min(y1, y2), 1, std::abs(y2 - y1) + 1 }, color);
+    else
+      push(nullptr, { 0, 0, 0, 0 }, { x1, y1, x2, y2 }, color, Kind::Line);
+  }
+
+  void quad(SDL_Texture* texture, const SDL_Rect& src, const SDL_Rect& dst, color_t color = color_t(255, 255, 255))
+  {
+    push(texture, src, dst, color, Kind::Quad);
+  }
+
+  /* restricts the next flush to the rect, clears included, nullptr to draw everywhere */
+  void clip(const SDL_Rect* rect)
+  {
+    _clipped = rect != nullptr;
+    if (rect)
+      _clip = *rect;
+  }
+
+  void layer(u32 layer) { _layer = layer; }
+  void nextLayer() { ++_layer; }
+  u32 layer() const { return _layer; }
+
+  size2d_t textureSize(SDL_Texture* texture);
+  void forget(SDL_Texture* texture) { _sizes.erase(texture); }
+
+  void flush(SDL_Renderer* renderer);
+
+  /* same order and clipping, rasterized on the CPU in the current target of renderer */
+  void flush(SoftwareRenderer& renderer);
+
+  /* calls issued outside of the batch, like presenting the canvas */
+  void countDrawCall() { ++_stats.drawCalls; }
+
+  const Stats& stats() const { return _stats; }
+  void account(const Stats& stats) { _stats += stats; }
+  void resetStats() { _stats = Stats(); }
+};
@@ -1,13 +1,20 @@
 #pragma once
 
+#include "Arena.h"
 #include "Common.h"
+#include "Trace.h"
 
 #include "SDL.h"
-#include "SDL_image.h"
+
+#include "Assets.h"
+#include "FrameTiming.h"
+#include "RenderBatch.h"
+#include "SoftwareRenderer.h"
 
 #include <cstdint>
 #include <cstdio>
 #include <cassert>
+#include <ctime>
 
 #if !_WIN32
 constexpr int32_t WIDTH = 320;
@@ -21,6 +28,15 @@ constexpr int32_t HEIGHT = 240;
 #define MOUSE_ENABLED true
 #endif
 
+#define SOFTWARE_RENDERER false
+#define SOFTWARE_FRAMEBUFFER false
+#define VSYNC false
+#define RENDER_STATS false
+#define RENDER_STATS_PERIOD 5000
+
+/* how long the loop sleeps waiting for input when nothing has to be redrawn */
+#define IDLE_TIMEOUT 500
+
 template<typename EventHandler, typename Renderer>
 class SDL
 {
@@ -32,35 +48,99 @@ protected:
   SDL_Renderer* _renderer;
   SDL_Texture* _canvas;
 
-  bool willQuit;
-  u32 ticks;
-  float _lastFrameTicks;
+  /* what the software renderer draws to when there is no window */
+  SDL_Surface* _surface;
+
+  RenderBatch _batch;
+  RenderBatch _offscreen;
+
+  /* when enabled batches are rasterized in memory and the canvas is a streaming texture */
+  SoftwareRenderer _software;
+  bool _framebuffer;
+
+  /* bumped when the renderer loses the content of its targets */
+  u32 _targetGeneration;
+
+  /* the canvas keeps the last frame, only the damaged part of it is drawn again */
+  bool _redraw;
+  rect_t _damage;
+
+  struct
+  {
+    u32 frames;
+    u32 wakeups;
+    u64 renderTicks;
+    u64 drawCalls;
+    u64 primitives;
+    u64 allocations;
+    u32 start;
+    std::clock_t cpu;
+  } _stats;
 
-  u32 frameRate;
-  float ticksPerFrame;
+  FramePacer _pacer;
+  FrameStats _frameStats;
+  FrameStats::Sample _sample;
+  u64 _frameStart;
+  bool _sampling;
+
+  /* from init to the end of the first present, cleared once logged */
+  u64 _coldStart;
+
+  /* transient data of views, reset when a frame starts */
+  Arena _frameArena;
+
+  /* operator new calls during the last frame, a steady frame should have none */
+  u32 _frameAllocations;
+
+  /* SDL timestamp of the oldest input handled since the last frame, 0 if none */
+  u32 _inputTimestamp;
+  bool _lowLatency;
+
+  void dispatch(SDL_Event& event);
+
+  void frame();
+  void logStats();
+
+  float milliseconds(u64 ticks) const { return 1000.0f * ticks / _pacer.frequency(); }
+
+  bool willQuit;
 
 
 public:
   SDL(EventHandler& eventHandler, Renderer& loopRenderer) : eventHandler(eventHandler), loopRenderer(loopRenderer),
-    _window(nullptr), _renderer(nullptr), _canvas(nullptr), willQuit(false), ticks(0)
+    _window(nullptr), _renderer(nullptr), _canvas(nullptr), _surface(nullptr), _framebuffer(SOFTWARE_FRAMEBUFFER), _targetGeneration(0), _redraw(true), _damage(0, 0, WIDTH, HEIGHT), _stats{ 0, 0, 0, 0, 0, 0, 0, 0 }, _sample(), _frameStart(0), _sampling(false), _coldStart(0), _frameAllocations(0), _inputTimestamp(0), _lowLatency(false), willQuit(false)
   {
-    setFrameRate(60);
   }
 
-  void setFrameRate(u32 frameRate)
-  {
-    this->frameRate = frameRate;
-    this->ticksPerFrame = 1000 / (float)frameRate;
-  }
+  void setFrameRate(u32 frameRate) { _pacer.setFrameRate(frameRate); }
+
+  /* must be chosen before init() */
+  void setSoftwareFramebuffer(bool enabled) { _framebuffer = enabled; }
+  bool softwareFramebuffer() const { return _framebuffer; }
 
-  float lastFrameTicks() const { return _lastFrameTicks; }
+  /* frames are drawn as soon as input arrives instead of waiting for the next deadline */
+  void setLowLatency(bool lowLatency) { _lowLatency = lowLatency; }
+  bool lowLatency() const { return _lowLatency; }
 
-  bool init();
+  float lastFrameTicks() const { return _sample[FrameStats::Frame]; }
+  const FrameStats& frameStats() const { return _frameStats; }
+
+  /* headless renders in memory with the software renderer, no display is needed */
+  bool init(bool headless = false);
   void deinit();
-  void capFPS();
+
+  /* draws a frame if something was invalidated, for driving the renderer without loop() */
+  bool update() { if (!_redraw) return false; frame(); return true; }
+  const FrameStats::Sample& lastSample() const { return _sample; }
+  u32 lastFrameAllocations() const { return _frameAllocations; }
+
+  Arena& frameArena() { return _frameArena; }
+
+  /* writes the content of the canvas, which is the last frame, as a BMP */
+  bool screenshot(const path& file);
 
   void loop();
-  void handleEvents();
+  void handleEvents(u32 timeout = 0);
 
   void exit() { willQuit = true; }
 
@@ -69,6 +149,10 @@ public:
   void blit(SDL_Texture* texture, int sx, int sy, int w, int h, int dx, int dy, int dw, int dh);
   void blit(SDL_Texture* texture, int dx, int dy);
 
+  /* src is relative to the image */
+  void blit(const Image& image, const rect_t& src, int dx, int dy) { blit(image.texture, src.x() + image.rect.x(), src.y() + image.rect.y(), src.w(), src.h(), dx, dy); }
+  void blit(const Image& image, int dx, int dy) { blit(image.texture, image.rect, dx, dy); }
+
   void drawRect(int x, int y, int w, int h, color_t color);
   void fillRect(int x, int y, int w, int h, color_t color);
   void line(int x1, int y1, int x2, int y2, color_t color);
@@ -80,6 +164,26 @@ public:
 
   void toggleMouseCursor(bool visible);
 
+  /* nothing is drawn until something is invalidated */
+  void invalidate() { invalidate(rect_t(0, 0, WIDTH, HEIGHT)); }
+  void invalidate(const rect_t& rect) { _damage = _damage.united(rect); _redraw = true; }
+  bool needsRedraw() const { return _redraw; }
+
+  /* primitives are reordered by texture inside a layer, see RenderBatch */
+  void layer(u32 layer) { _batch.layer(layer); }
+  void nextLayer() { _batch.nextLayer(); }
+  void flush() { _batch.flush(_renderer); }
+
+  /* records draw() in a separate batch and flushes it to target, which is cleared to transparent first */
+  template<typename F> void prerender(SDL_Texture* target, F draw);
+  u32 targetGeneration() const { return _targetGeneration; }
+
+  RenderBatch& batch() { return _batch; }
+
+  /* a texture about to be destroyed */
+  void forget(SDL_Texture* texture) { _batch.forget(texture); _offscreen.forget(texture); _software.forget(texture); }
+  const RenderBatch::Stats& renderStats() const { return _batch.stats(); }
+
   //void slowTextBlit(TTF_Font* font, int dx, int dy, Align align, const std::string& string);
 
   SDL_Window* window() { return _window; }
@@ -87,27 +191,45 @@ public:
 };
 
 template<typename EventHandler, typename Renderer>
-bool SDL<EventHandler, Renderer>::init()
+bool SDL<EventHandler, Renderer>::init(bool headless)
 {
-  if (SDL_Init(SDL_INIT_EVERYTHING))
+  _coldStart = SDL_GetPerformanceCounter();
+
+  if (SDL_Init(headless ? SDL_INIT_TIMER | SDL_INIT_EVENTS : SDL_INIT_EVERYTHING))
   {
     printf("Error on SDL_Init().\n");
     return false;
   }
 
-  if (IMG_Init(IMG_INIT_PNG) != IMG_INIT_PNG)
+  if (headless)
   {
-    printf("Error on IMG_Init().\n");
+    _surface = SDL_CreateRGBSurfaceWithFormat(0, WIDTH, HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    _renderer = _surface ? SDL_CreateSoftwareRenderer(_surface) : nullptr;
+  }
+  else
+  {
+    // SDL_WINDOW_FULLSCREEN
+    _window = SDL_CreateWindow("Enigmistica", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, WIDTH * WINDOW_SCALE, HEIGHT * WINDOW_SCALE, SDL_WINDOW_OPENGL);
+    _renderer = SDL_CreateRenderer(_window, -1, (SOFTWARE_RENDERER ? SDL_RENDERER_SOFTWARE : SDL_RENDERER_ACCELERATED) | (VSYNC ? SDL_RENDERER_PRESENTVSYNC : 0));
+  }
+
+  if (!_renderer)
+  {
+    printf("Error creating renderer: %s\n", SDL_GetError());
     return false;
   }
 
-  // SDL_WINDOW_FULLSCREEN
-  _window = SDL_CreateWindow("Enigmistica", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, WIDTH * WINDOW_SCALE, HEIGHT * WINDOW_SCALE, SDL_WINDOW_OPENGL);
-  _renderer = SDL_CreateRenderer(_window, -1, SDL_RENDERER_ACCELERATED);
+  /* the driver may not honor the request */
+  SDL_RendererInfo info;
+  if (SDL_GetRendererInfo(_renderer, &info) == 0)
+    _pacer.setVSync((info.flags & SDL_RENDERER_PRESENTVSYNC) != 0);
 
   SDL_SetRenderDrawBlendMode(_renderer, SDL_BLENDMODE_BLEND);
 
-  if (WINDOW_SCALE != 1)
+  /* always needed since the back buffer is undefined after a present, the software framebuffer streams into it */
+  if (_framebuffer)
+    _canvas = SDL_CreateTexture(_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, WIDTH, HEIGHT);
+  else
     _canvas = SDL_CreateTexture(_renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, WIDTH, HEIGHT);
 
   //toggleMouseCursor(false);
@@ -116,104 +238,350 @@ bool SDL<EventHandler, Renderer>::init()
 }
 
 template<typename EventHandler, typename Renderer>
-void SDL<EventHandler, Renderer>::loop()
+void SDL<EventHandler, Renderer>::frame()
 {
-  while (!willQuit)
+  TRACE_ZONE("frame");
+
+  const u64 start = SDL_GetPerformanceCounter();
+  const u64 allocations = heap::allocations();
+
+  _frameArena.reset();
+
+  /* a sample is complete when the next frame starts */
+  if (_sampling)
   {
-#if defined(WINDOW_SCALE)
+    _sample[FrameStats::Frame] = milliseconds(start - _frameStart);
+    _frameStats.push(_sample);
+  }
+
+  _frameStart = start;
+  _sampling = true;
+
+  const coord_t x1 = std::max(_damage.x(), 0), y1 = std::max(_damage.y(), 0);
+  const coord_t x2 = std::min(_damage.x() + _damage.w(), WIDTH), y2 = std::min(_damage.y() + _damage.h(), HEIGHT);
+
+  const SDL_Rect clip = { x1, y1, x2 - x1, y2 - y1 };
+  const bool full = clip.w == WIDTH && clip.h == HEIGHT;
+
+  _redraw = false;
+  _damage = rect_t(0, 0, 0, 0);
+
+  _batch.resetStats();
+  _batch.layer(0);
+  _batch.clip(full ? nullptr : &clip);
+
+  if (_framebuffer)
+  {
+    TRACE_ZONE("render");
+
+    _software.setTarget(_canvas);
+    loopRenderer.render();
+    _batch.flush(_software);
+
+    /* the only pixels which reach the renderer */
+    _software.upload(_canvas, clip);
+    _batch.countDrawCall();
+  }
+  else
+  {
+    TRACE_ZONE("render");
+
     SDL_SetRenderTarget(_renderer, _canvas);
-#endif
     loopRenderer.render();
+    _batch.flush(_renderer);
 
-#if defined(WINDOW_SCALE)
     SDL_SetRenderTarget(_renderer, nullptr);
-    SDL_RenderCopy(_renderer, _canvas, nullptr, nullptr);
-#endif
+  }
+
+  SDL_RenderCopy(_renderer, _canvas, nullptr, nullptr);
+  _batch.countDrawCall();
+
+  const u64 rendered = SDL_GetPerformanceCounter();
 
+  _stats.renderTicks += rendered - start;
+  _stats.drawCalls += _batch.stats().drawCalls;
+  _stats.primitives += _batch.stats().primitives;
+  ++_stats.frames;
+
+  {
+    TRACE_ZONE("present");
     SDL_RenderPresent(_renderer);
+  }
 
-    handleEvents();
+  _sample[FrameStats::Render] = milliseconds(rendered - start);
+  _sample[FrameStats::Present] = milliseconds(SDL_GetPerformanceCounter() - rendered);
 
-    capFPS();
+  /* SDL itself allocates with malloc, only what C++ code on this thread asks for is counted */
+  _frameAllocations = u32(heap::allocations() - allocations);
+  _stats.allocations += _frameAllocations;
+
+  if (_coldStart)
+  {
+    LOGD("first frame %.1f ms after init", milliseconds(SDL_GetPerformanceCounter() - _coldStart));
+    _coldStart = 0;
+  }
+
+  /* up to the end of the present, the closest this side of the driver gets to the photons */
+  if (_inputTimestamp)
+  {
+    _frameStats.push(FrameStats::Latency, float(SDL_GetTicks() - _inputTimestamp));
+    _inputTimestamp = 0;
   }
 }
 
 template<typename EventHandler, typename Renderer>
-void SDL<EventHandler, Renderer>::capFPS()
+template<typename F>
+void SDL<EventHandler, Renderer>::prerender(SDL_Texture* target, F draw)
 {
-  u32 ticks = SDL_GetTicks();
-  u32 elapsed = ticks - SDL::ticks;
+  std::swap(_batch, _offscreen);
 
-  _lastFrameTicks = elapsed;
+  _batch.resetStats();
+  _batch.layer(0);
+  draw();
 
-  if (elapsed < ticksPerFrame)
+  if (_framebuffer)
   {
-    SDL_Delay(ticksPerFrame - elapsed);
-    _lastFrameTicks = ticksPerFrame;
+    _software.setTarget(target);
+    _software.clear(color_t(0, 0, 0, 0));
+    _batch.flush(_software);
+    _software.setTarget(_canvas);
+  }
+  else
+  {
+    SDL_SetRenderTarget(_renderer, target);
+    SDL_SetRenderDrawColor(_renderer, 0, 0, 0, 0);
+    SDL_RenderClear(_renderer);
+    _batch.flush(_renderer);
+    _batch.countDrawCall();
+    SDL_SetRenderTarget(_renderer, _canvas);
   }
 
-  SDL::ticks = SDL_GetTicks();
+  std::swap(_batch, _offscreen);
+  _batch.account(_offscreen.stats());
 }
 
 template<typename EventHandler, typename Renderer>
-void SDL<EventHandler, Renderer>::deinit()
+void SDL<EventHandler, Renderer>::loop()
+{
+  _stats.start = SDL_GetTicks();
+  _stats.cpu = std::clock();
+
+  bool drawn = false;
+
+  while (!willQuit)
+  {
+    /* input is sampled after waiting for the deadline, right before it's drawn */
+    u32 timeout = 0;
+
+    if (!_redraw)
+      timeout = IDLE_TIMEOUT;
+    else if (drawn && _lowLatency)
+      timeout = _pacer.remaining();
+    else if (drawn)
+      _pacer.wait();
+
+    /* a blocking wait means the pending sample would span an idle period */
+    if (!_redraw)
+      _sampling = false;
+
+    const u64 update = SDL_GetPerformanceCounter();
+    {
+      TRACE_ZONE("events");
+      handleEvents(timeout);
+    }
+    _sample[FrameStats::Update] = milliseconds(SDL_GetPerformanceCounter() - update);
+
+    if (drawn && _lowLatency)
+      _pacer.advance(SDL_GetPerformanceCounter());
+
+    drawn = _redraw && !willQuit;
+
+    if (drawn)
+      frame();
+
+#if RENDER_STATS
+    logStats();
+#endif
+  }
+}
+
+template<typename EventHandler, typename Renderer>
+void SDL<EventHandler, Renderer>::logStats()
+{
+  const u32 now = SDL_GetTicks();
+  const u32 elapsed = now - _stats.start;
+
+  if (elapsed < RENDER_STATS_PERIOD)
+    return;
+
+  const std::clock_t cpu = std::clock();
+  const double usage = 100.0 * (cpu - _stats.cpu) / CLOCKS_PER_SEC / (elapsed / 1000.0);
+  const u32 frames = std::max(_stats.frames, 1u);
+
+  LOGD("render: %u frames, %u wakeups, cpu %.1f%%, %.3f ms/frame, %.1f draw calls/frame, %.1f primitives/frame, %.1f allocations/frame",
+    _stats.frames, _stats.wakeups, usage, 1000.0 * _stats.renderTicks / SDL_GetPerformanceFrequency() / frames,
+    double(_stats.drawCalls) / frames, double(_stats.primitives) / frames, double(_stats.allocations) / frames);
+
+  _stats = { 0, 0, 0, 0, 0, 0, now, cpu };
+}
+
+template<typename EventHandler, typename Renderer>
+bool SDL<EventHandler, Renderer>::screenshot(const path& file)
 {
-  IMG_Quit();
+  SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, WIDTH, HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+
+  if (!surface)
+    return false;
+
+  bool success;
+
+  if (_framebuffer)
+  {
+    /* a streaming texture can't be read back, but the pixmap is the same thing */
+    const Pixmap* canvas = _software.target(_canvas);
+    success = canvas != nullptr;
 
-  if (_canvas)
-    SDL_DestroyTexture(_canvas);
+    for (s32 y = 0; success && y < HEIGHT; ++y)
+      memcpy(static_cast<u8*>(surface->pixels) + y * surface->pitch, canvas->row(y), WIDTH * sizeof(u32));
+  }
+  else
+  {
+    SDL_SetRenderTarget(_renderer, _canvas);
+    success = SDL_RenderReadPixels(_renderer, nullptr, SDL_PIXELFORMAT_ARGB8888, surface->pixels, surface->pitch) == 0;
+    SDL_SetRenderTarget(_renderer, nullptr);
+  }
+
+  success = success && SDL_SaveBMP(surface, file.c_str()) == 0;
+
+  if (!success)
+    printf("Error saving %s: %s\n", file.c_str(), SDL_GetError());
+
+  SDL_FreeSurface(surface);
+  return success;
+}
+
+template<typename EventHandler, typename Renderer>
+void SDL<EventHandler, Renderer>::deinit()
+{
+  SDL_DestroyTexture(_canvas);
 
   SDL_DestroyRenderer(_renderer);
-  SDL_DestroyWindow(_window);
+
+  if (_window)
+    SDL_DestroyWindow(_window);
+  if (_surface)
+    SDL_FreeSurface(_surface);
 
   SDL_Quit();
 }
 
 template<typename EventHandler, typename Renderer>
-void SDL<EventHandler, Renderer>::handleEvents()
+void SDL<EventHandler, Renderer>::handleEvents(u32 timeout)
 {
-  SDL_Event event;
-  while (SDL_PollEvent(&event))
+  SDL_Event event, motion;
+  bool hasMotion = false;
+
+  bool pending = timeout ? SDL_WaitEventTimeout(&event, timeout) : SDL_PollEvent(&event);
+  ++_stats.wakeups;
+
+  for (; pending; pending = SDL_PollEvent(&event))
   {
-    switch (event.type)
+    if (event.type == SDL_KEYDOWN || event.type == SDL_KEYUP || event.type == SDL_MOUSEBUTTONDOWN || event.type == SDL_MOUSEBUTTONUP || event.type == SDL_MOUSEMOTION)
+    {
+      if (!_inputTimestamp)
+        _inputTimestamp = std::max(event.common.timestamp, 1u);
+    }
+
+    /* only the last position of a run of motion events matters, the deltas are summed */
+    if (event.type == SDL_MOUSEMOTION)
     {
-    case SDL_QUIT:
-      willQuit = true;
-      break;
+      if (hasMotion)
+      {
+        event.motion.xrel += motion.motion.xrel;
+        event.motion.yrel += motion.motion.yrel;
+      }
+
+      motion = event;
+      hasMotion = true;
+      continue;
+    }
+
+    /* anything else is dispatched after the motion which came before it */
+    if (hasMotion)
+    {
+      dispatch(motion);
+      hasMotion = false;
+    }
+
+    dispatch(event);
+  }
+
+  if (hasMotion)
+    dispatch(motion);
+
+  /* input which didn't change anything has no frame to be measured by */
+  if (!_redraw)
+    _inputTimestamp = 0;
+}
 
-    case SDL_KEYDOWN:
-    case SDL_KEYUP:
-      eventHandler.handleKeyboardEvent(event);
-      break;
+template<typename EventHandler, typename Renderer>
+void SDL<EventHandler, Renderer>::dispatch(SDL_Event& event)
+{
+  switch (event.type)
+  {
+  case SDL_QUIT:
+    willQuit = true;
+    break;
+
+  case SDL_WINDOWEVENT:
+    if (event.window.event == SDL_WINDOWEVENT_EXPOSED)
+      invalidate();
+    break;
+
+  case SDL_RENDER_TARGETS_RESET:
+    ++_targetGeneration;
+    invalidate();
+    break;
+
+  /* the process may be gone before the loop comes around again */
+  case SDL_APP_WILLENTERBACKGROUND:
+  case SDL_APP_TERMINATING:
+    eventHandler.suspend();
+    break;
+
+  case SDL_KEYDOWN:
+  case SDL_KEYUP:
+    eventHandler.handleKeyboardEvent(event);
+    break;
+
+  /* posted by background work which has something to show */
+  case SDL_USEREVENT:
+    eventHandler.handleUserEvent(event);
+    break;
 
 #if MOUSE_ENABLED
-    case SDL_MOUSEBUTTONDOWN:
-    case SDL_MOUSEBUTTONUP:
-    case SDL_MOUSEMOTION:
+  case SDL_MOUSEBUTTONDOWN:
+  case SDL_MOUSEBUTTONUP:
+  case SDL_MOUSEMOTION:
 #if defined(WINDOW_SCALE)
-      event.button.x /= WINDOW_SCALE;
-      event.button.y /= WINDOW_SCALE;
+    event.button.x /= WINDOW_SCALE;
+    event.button.y /= WINDOW_SCALE;
 #endif
-      eventHandler.handleMouseEvent(event);
+    eventHandler.handleMouseEvent(event);
 #endif
-    }
   }
 }
 
 template<typename EventHandler, typename Renderer>
 inline void SDL<EventHandler, Renderer>::blit(SDL_Texture* texture, int sx, int sy, int w, int h, int dx, int dy, int dw, int dh)
 {
-  SDL_Rect from = { sx, sy, w, h };
-  SDL_Rect to = { dx, dy, dw, dh };
-  SDL_RenderCopy(_renderer, texture, &from, &to);
+  _batch.quad(texture, { sx, sy, w, h }, { dx, dy, dw, dh });
 }
 
 template<typename EventHandler, typename Renderer>
 inline void SDL<EventHandler, Renderer>::blit(SDL_Texture* texture, const rect_t& from, int dx, int dy)
 {
-  SDL_Rect to = { dx, dy, from.w(), from.h() };
-  SDL_Rect rfrom = { from.x(), from.y(), from.w(), from.h() };
-  SDL_RenderCopy(_renderer, texture, &rfrom, &to);
+  _batch.quad(texture, { from.x(), from.y(), from.w(), from.h() }, { dx, dy, from.w(), from.h() });
 }
 
 template<typename EventHandler, typename Renderer>
@@ -226,48 +594,32 @@ inline void SDL<EventHandler, Renderer>::blit(SDL_Texture* texture, int sx, int
 template<typename EventHandler, typename Renderer>
 inline void SDL<EventHandler, Renderer>::blit(SDL_Texture* texture, int dx, int dy)
 {
-  u32 dummy;
-  int dummy2;
-
-  SDL_Rect from = { 0, 0, 0, 0 };
-  SDL_Rect to = { dx, dy, 0, 0 };
-
-  SDL_QueryTexture(texture, &dummy, &dummy2, &from.w, &from.h);
-
-  to.w = from.w;
-  to.h = from.h;
-
-  SDL_RenderCopy(_renderer, texture, &from, &to);
+  const size2d_t size = _batch.textureSize(texture);
+  _batch.quad(texture, { 0, 0, size.w, size.h }, { dx, dy, size.w, size.h });
 }
 
 template<typename EventHandler, typename Renderer>
 inline void SDL<EventHandler, Renderer>::drawRect(int x, int y, int w, int h, color_t color)
 {
-  SDL_SetRenderDrawColor(_renderer, color.r, color.g, color.b, color.a);
-  SDL_Rect rect = { x, y, w, h };
-  SDL_RenderDrawRect(_renderer, &rect);
+  _batch.outline({ x, y, w, h }, color);
 }
 
 template<typename EventHandler, typename Renderer>
 inline void SDL<EventHandler, Renderer>::fillRect(int x, int y, int w, int h, color_t color)
 {
-  SDL_SetRenderDrawColor(_renderer, color.r, color.g, color.b, color.a);
-  SDL_Rect rect = { x, y, w, h };
-  SDL_RenderFillRect(_renderer, &rect);
+  _batch.fill({ x, y, w, h }, color);
 }
 
 template<typename EventHandler, typename Renderer>
 inline void SDL<EventHandler, Renderer>::line(int x1, int y1, int x2, int y2, color_t color)
 {
-  SDL_SetRenderDrawColor(_renderer, color.r, color.g, color.b, color.a);
-  SDL_RenderDrawLine(_renderer, x1, y1, x2, y2);
+  _batch.line(x1, y1, x2, y2, color);
 }
 
 template<typename EventHandler, typename Renderer>
 inline void SDL<EventHandler, Renderer>::clear(color_t color)
 {
-  SDL_SetRenderDrawColor(_renderer, color.r, color.g, color.b, 255);
-  SDL_RenderClear(_renderer);
+  _batch.clear(color);
 }
 
 template<typename EventHandler, typename Renderer>
@@ -0,0 +1,264 @@
+#include "SoftwareRenderer.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+  u32 pack(color_t c) { return (u32(c.a) << 24) | (u32(c.r) << 16) | (u32(c.g) << 8) | c.b; }
+
+  /* x / 255 for x up to 255 * 255, on two 16 bit lanes at once */
+  u32 div255x2(u32 x) { return ((x + 0x00010001 + ((x >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF; }
+  u32 div255(u32 x) { return (x + 1 + (x >> 8)) >> 8; }
+
+  /* same as SDL_BLENDMODE_BLEND, red with blue and green with alpha are computed
+     together in the two halves of a register, the GCW0 has no usable SIMD */
+  u32 blend(u32 src, u32 dst)
+  {
+    const u32 a = src >> 24;
+
+    if (a == 255)
+      return src;
+    else if (a == 0)
+      return dst;
+
+    const u32 ia = 255 - a;
+    const u32 rb = (src & 0x00FF00FF) * a + (dst & 0x00FF00FF) * ia;
+    const u32 ga = (((src >> 8) & 0xFF) * a + ((255 * a) << 16)) + ((dst >> 8) & 0x00FF00FF) * ia;
+
+    return div255x2(rb) | (div255x2(ga) << 8);
+  }
+
+  u32 modulate(u32 p, color_t c)
+  {
+    return (div255((p >> 24) * c.a) << 24) | (div255(((p >> 16) & 0xFF) * c.r) << 16) | (div255(((p >> 8) & 0xFF) * c.g) << 8) | div255((p & 0xFF) * c.b);
+  }
+
+  /* a constant color over a span, the source side of the blend is computed once */
+  void blendSpan(u32* dst, s32 count, u32 color)
+  {
+    const u32 a = color >> 24, ia = 255 - a;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i inverse = _mm_set1_epi16(short(ia));
+    const __m128i one = _mm_set1_epi16(1);
+    const short b = short((color & 0xFF) * a), g = short(((color >> 8) & 0xFF) * a), r = short(((color >> 16) & 0xFF) * a), o = short(255 * a);
+    const __m128i source = _mm_set_epi16(o, r, g, b, o, r, g, b);
+
+    for (; count >= 4; count -= 4, dst += 4)
+    {
+      const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst));
+
+      __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(pixels, zero), inverse), source);
+      __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(pixels, zero), inverse), source);
+
+      lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo, one), _mm_srli_epi16(lo, 8)), 8);
+      hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi, one), _mm_srli_epi16(hi, 8)), 8);
+
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    const u32 rb = (color & 0x00FF00FF) * a;
+    const u32 ga = ((color >> 8) & 0xFF) * a + ((255 * a) << 16);
+
+    for (s32 i = 0; i < count; ++i)
+      dst[i] = div255x2(rb + (dst[i] & 0x00FF00FF) * ia) | (div255x2(ga + ((dst[i] >> 8) & 0x00FF00FF) * ia) << 8);
+  }
+}
+
+const Pixmap* SoftwareRenderer::source(SDL_Texture* texture)
+{
+  if (texture != _sourceTexture)
+  {
+    auto it = _targets.find(texture);
+
+    _sourceTexture = texture;
+    _source = it != _targets.end() ? &it->second : (_assets ? _assets->pixels(texture) : nullptr);
+  }
+
+  return _source;
+}
+
+bool SoftwareRenderer::clipped(const SDL_Rect& rect, SDL_Rect& result) const
+{
+  const s32 x1 = std::max(rect.x, _clip.x), y1 = std::max(rect.y, _clip.y);
+  const s32 x2 = std::min(rect.x + rect.w, _clip.x + _clip.w), y2 = std::min(rect.y + rect.h, _clip.y + _clip.h);
+
+  result = { x1, y1, x2 - x1, y2 - y1 };
+  return _target && x1 < x2 && y1 < y2;
+}
+
+void SoftwareRenderer::setTarget(SDL_Texture* texture)
+{
+  auto it = _targets.find(texture);
+
+  if (it == _targets.end())
+  {
+    u32 format;
+    int access, w = 0, h = 0;
+    SDL_QueryTexture(texture, &format, &access, &w, &h);
+
+    it = _targets.insert(std::make_pair(texture, Pixmap(w, h))).first;
+  }
+
+  _target = &it->second;
+  clip(nullptr);
+
+  /* the texture may have been looked up as a source before it became a target */
+  _sourceTexture = nullptr;
+}
+
+const Pixmap* SoftwareRenderer::target(SDL_Texture* texture) const
+{
+  auto it = _targets.find(texture);
+  return it != _targets.end() ? &it->second : nullptr;
+}
+
+void SoftwareRenderer::clip(const SDL_Rect* rect)
+{
+  const SDL_Rect bounds = { 0, 0, _target ? _target->width : 0, _target ? _target->height : 0 };
+
+  _clip = bounds;
+
+  if (rect && !clipped(*rect, _clip))
+    _clip = { 0, 0, 0, 0 };
+}
+
+void SoftwareRenderer::clear(color_t color)
+{
+  if (!_target)
+    return;
+
+  const u32 value = pack(color);
+
+  for (s32 y = _clip.y; y < _clip.y + _clip.h; ++y)
+    std::fill_n(_target->row(y) + _clip.x, _clip.w, value);
+}
+
+void SoftwareRenderer::fill(const SDL_Rect& rect, color_t color)
+{
+  SDL_Rect area;
+
+  if (color.a == 0 || !clipped(rect, area))
+    return;
+
+  const u32 value = pack(color);
+
+  for (s32 y = area.y; y < area.y + area.h; ++y)
+  {
+    u32* row = _target->row(y) + area.x;
+
+    if (color.a == 255)
+      std::fill_n(row, area.w, value);
+    else
+      blendSpan(row, area.w, value);
+  }
+}
+
+void SoftwareRenderer::blit(SDL_Texture* texture, const SDL_Rect& src, const SDL_Rect& dst, color_t color)
+{
+  const Pixmap* pixmap = source(texture);
+  SDL_Rect area;
+
+  if (!pixmap || pixmap == _target || src.w <= 0 || src.h <= 0 || !clipped(dst, area))
+    return;
+
+  if (src.x < 0 || src.y < 0 || src.x + src.w > pixmap->width || src.y + src.h > pixmap->height)
+    return;
+
+  const bool tinted = color != color_t(255, 255, 255, 255);
+
+  /* nearest neighbour in 16.16 fixed point, text is drawn at integer scales */
+  const u32 stepX = (u32(src.w) << 16) / dst.w, stepY = (u32(src.h) << 16) / dst.h;
+
+  for (s32 y = area.y; y < area.y + area.h; ++y)
+  {
+    const u32* from = pixmap->row(src.y + s32((u32(y - dst.y) * stepY) >> 16)) + src.x;
+    u32* to = _target->row(y);
+
+    u32 u = u32(area.x - dst.x) * stepX;
+
+    for (s32 x = area.x; x < area.x + area.w; ++x, u += stepX)
+    {
+      u32 pixel = from[u >> 16];
+
+      if (tinted)
+        pixel = modulate(pixel, color);
+
+      to[x] = blend(pixel, to[x]);
+    }
+  }
+}
+
+void SoftwareRenderer::line(s32 x1, s32 y1, s32 x2, s32 y2, color_t color)
+{
+  if (!_target || _clip.w == 0)
+    return;
+
+  const u32 value = pack(color);
+  const s32 dx = std::abs(x2 - x1), dy = -std::abs(y2 - y1);
+  const s32 sx = x1 < x2 ? 1 : -1, sy = y1 < y2 ? 1 : -1;
+
+  s32 error = dx + dy;
+
+  for (;;)
+  {
+    if (x1 >= _clip.x && x1 < _clip.x + _clip.w && y1 >= _clip.y && y1 < _clip.y + _clip.h)
+    {
+      u32& pixel = _target->row(y1)[x1];
+      pixel = blend(value, pixel);
+    }
+
+    if (x1 == x2 && y1 == y2)
+      break;
+
+    const s32 e2 = 2 * error;
+
+    if (e2 >= dy)
+    {
+      error += dy;
+      x1 += sx;
+    }
+
+    if (e2 <= dx)
+    {
+      error += dx;
+      y1 += sy;
+    }
+  }
+}
+
+bool SoftwareRenderer::upload(SDL_Texture* texture, const SDL_Rect& rect)
+{
+  const Pixmap* pixmap = target(texture);
+
+  if (!pixmap || rect.w <= 0 || rect.h <= 0)
+    return false;
+
+  return SDL_UpdateTexture(texture, &rect, pixmap->row(rect.y) + rect.x, pixmap->pitch()) == 0;
+}
+
+void SoftwareRenderer::forget(SDL_Texture* texture)
+{
+  auto it = _targets.find(texture);
+
+  if (it != _targets.end())
+  {
+    if (_target == &it->second)
+      _target = nullptr;
+
+    _targets.erase(it);
+  }
+
+  if (_sourceTexture == texture)
+  {
+    _sourceTexture = nullptr;
+    _source = nullptr;
+  }
+}
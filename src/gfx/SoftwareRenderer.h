@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Common.h"
+
+#include "Assets.h"
+#include "Pixmap.h"
+
+#include "SDL.h"
+
+#include <unordered_map>
+
+/* rasterizes the primitives of a RenderBatch on the CPU, each target texture is
+   backed by a pixmap and only the canvas is ever uploaded, with a single
+   SDL_UpdateTexture of the damaged rect; sources are the pixels Assets keeps
+   around and the pixmaps of other targets, like cached layers */
+class SoftwareRenderer
+{
+private:
+  const Assets* _assets;
+  std::unordered_map<SDL_Texture*, Pixmap> _targets;
+
+  Pixmap* _target;
+  SDL_Rect _clip; // always inside the target
+
+  /* strings and boards come from a single texture, so the lookup is cached */
+  SDL_Texture* _sourceTexture;
+  const Pixmap* _source;
+
+  const Pixmap* source(SDL_Texture* texture);
+
+  /* the part of rect inside the clip, false if nothing is left */
+  bool clipped(const SDL_Rect& rect, SDL_Rect& result) const;
+
+public:
+  SoftwareRenderer() : _assets(nullptr), _target(nullptr), _clip({ 0, 0, 0, 0 }), _sourceTexture(nullptr), _source(nullptr) { }
+
+  void setAssets(const Assets* assets) { _assets = assets; }
+
+  /* the pixmap of a target is created transparent, sized as its texture, on first use */
+  void setTarget(SDL_Texture* texture);
+  const Pixmap* target(SDL_Texture* texture) const;
+
+  void clip(const SDL_Rect* rect);
+
+  /* the clipped area is replaced, not blended */
+  void clear(color_t color);
+
+  void fill(const SDL_Rect& rect, color_t color);
+  void blit(SDL_Texture* texture, const SDL_Rect& src, const SDL_Rect& dst, color_t color);
+  void line(s32 x1, s32 y1, s32 x2, s32 y2, color_t color);
+
+  /* copies rect of the pixmap of texture into texture itself */
+  bool upload(SDL_Texture* texture, const SDL_Rect& rect);
+
+  void forget(SDL_Texture* texture);
+};
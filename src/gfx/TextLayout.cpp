@@ -0,0 +1,78 @@
+#include "TextLayout.h"
+
+using namespace ui;
+
+void TextLayout::build(const glyph_t* glyphs, size_t length, const FontMetrics& metrics, float scale, TextAlign align)
+{
+  _quads.resize(length);
+
+  float pen = 0.0f;
+  for (size_t i = 0; i < length; ++i)
+  {
+    const GlyphMetrics& glyph = metrics[glyphs[i]];
+
+    _quads[i].src = metrics.source(glyphs[i]);
+    _quads[i].dst = { s32(pen), 0, s32(glyph.width * scale), s32(FontMetrics::GLYPH_HEIGHT * scale) };
+
+    pen += glyph.advance * scale;
+  }
+
+  _width = s32(pen);
+  _height = s32(FontMetrics::GLYPH_HEIGHT * scale);
+
+  const s32 shift = align == TextAlign::CENTER ? _width / 2 : (align == TextAlign::RIGHT ? _width : 0);
+
+  for (GlyphQuad& quad : _quads)
+    quad.dst.x -= shift;
+}
+
+const TextLayout& TextLayoutCache::find(const FontMetrics& metrics)
+{
+  auto it = _layouts.find(_lookup);
+
+  if (it == _layouts.end())
+  {
+    if (_layouts.size() >= CAPACITY)
+      _layouts.clear();
+
+    it = _layouts.insert(std::make_pair(_lookup, TextLayout())).first;
+
+    if (_lookup.decoded)
+      it->second.build(reinterpret_cast<const glyph_t*>(_lookup.content.data()), _lookup.content.size(), metrics, _lookup.scale, _lookup.align);
+    else
+    {
+      _glyphs.clear();
+
+      const char* c = _lookup.content.data();
+      const char* end = c + _lookup.content.size();
+
+      while (c != end)
+        _glyphs.push_back(toGlyph(utf8::next(c, end)));
+
+      it->second.build(_glyphs.data(), _glyphs.size(), metrics, _lookup.scale, _lookup.align);
+    }
+  }
+
+  return it->second;
+}
+
+const TextLayout& TextLayoutCache::get(const char* text, size_t length, const FontMetrics& metrics, float scale, TextAlign align)
+{
+  /* the key is reused so that hits don't allocate */
+  _lookup.content.assign(text, length);
+  _lookup.decoded = false;
+  _lookup.scale = scale;
+  _lookup.align = align;
+
+  return find(metrics);
+}
+
+const TextLayout& TextLayoutCache::get(const glyph_t* glyphs, size_t length, const FontMetrics& metrics, float scale, TextAlign align)
+{
+  _lookup.content.assign(reinterpret_cast<const char*>(glyphs), length);
+  _lookup.decoded = true;
+  _lookup.scale = scale;
+  _lookup.align = align;
+
+  return find(metrics);
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "Common.h"
+#include "Unicode.h"
+
+#include "SDL.h"
+
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+namespace ui
+{
+  enum TextAlign
+  {
+    LEFT, CENTER, RIGHT
+  };
+
+  /* index of a cell in the font atlas, which is laid out as Latin-1 */
+  using glyph_t = u8;
+  using glyph_string = std::vector<glyph_t>;
+
+  inline glyph_t toGlyph(unicode_t cp) { return cp < 256 ? glyph_t(cp) : glyph_t('?'); }
+
+  struct GlyphMetrics
+  {
+    u8 width; // visible part of the cell
+    u8 advance; // distance to the next glyph
+  };
+
+  /* the font atlas is a grid of 32 cells per row, every glyph starts at the top left of its cell */
+  class FontMetrics
+  {
+  public:
+    static constexpr s32 GLYPHS_PER_ROW = 32;
+    static constexpr s32 CELL_WIDTH = 6, CELL_HEIGHT = 9;
+    static constexpr s32 GLYPH_HEIGHT = 8;
+
+  private:
+    std::array<GlyphMetrics, 256> _glyphs;
+
+  public:
+    /* font.png is monospaced, 5 pixels of glyph plus 1 of spacing */
+    FontMetrics() { _glyphs.fill({ 5, 6 }); }
+
+    void set(glyph_t glyph, GlyphMetrics metrics) { _glyphs[glyph] = metrics; }
+    const GlyphMetrics& operator[](glyph_t glyph) const { return _glyphs[glyph]; }
+
+    SDL_Rect source(glyph_t glyph) const
+    {
+      return { CELL_WIDTH * (glyph % GLYPHS_PER_ROW), CELL_HEIGHT * (glyph / GLYPHS_PER_ROW), _glyphs[glyph].width, GLYPH_HEIGHT };
+    }
+  };
+
+  struct GlyphQuad
+  {
+    SDL_Rect src; // relative to the font image
+    SDL_Rect dst; // relative to the anchor, alignment included
+  };
+
+  /* the quads of a string at a given scale and alignment, drawing it is just offsetting them */
+  class TextLayout
+  {
+  private:
+    std::vector<GlyphQuad> _quads;
+    s32 _width;
+    s32 _height;
+
+  public:
+    TextLayout() : _width(0), _height(0) { }
+
+    void build(const glyph_t* glyphs, size_t length, const FontMetrics& metrics, float scale, TextAlign align);
+
+    const std::vector<GlyphQuad>& quads() const { return _quads; }
+    s32 width() const { return _width; }
+    s32 height() const { return _height; }
+  };
+
+  /* layouts by content, strings drawn every frame are laid out only once */
+  class TextLayoutCache
+  {
+  private:
+    struct Key
+    {
+      std::string content; // UTF-8 or glyph indices depending on decoded
+      bool decoded;
+      float scale;
+      TextAlign align;
+
+      bool operator==(const Key& o) const { return decoded == o.decoded && scale == o.scale && align == o.align && content == o.content; }
+    };
+
+    struct KeyHash
+    {
+      size_t operator()(const Key& key) const
+      {
+        return std::hash<std::string>()(key.content) ^ (std::hash<float>()(key.scale) * 31) ^ (size_t(key.align) << 1) ^ size_t(key.decoded);
+      }
+    };
+
+    std::unordered_map<Key, TextLayout, KeyHash> _layouts;
+    Key _lookup;
+    glyph_string _glyphs;
+
+    const TextLayout& find(const FontMetrics& metrics);
+
+  public:
+    /* dropped all at once when full, the set of strings on screen is small and changes rarely */
+    static constexpr size_t CAPACITY = 512;
+
+    const TextLayout& get(const utf8_string& text, const FontMetrics& metrics, float scale, TextAlign align) { return get(text.data(), text.size(), metrics, scale, align); }
+    const TextLayout& get(const char* text, size_t length, const FontMetrics& metrics, float scale, TextAlign align);
+    const TextLayout& get(const glyph_t* glyphs, size_t length, const FontMetrics& metrics, float scale, TextAlign align);
+
+    void clear() { _layouts.clear(); }
+    size_t size() const { return _layouts.size(); }
+  };
+}
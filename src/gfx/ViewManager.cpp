@@ -2,12 +2,20 @@
 
 #include "MainView.h"
 
+#include "MappedFile.h"
+#include "Snapshot.h"
+
+#include <cstdarg>
+
 #define KEYBOARD_MAPPED_TO_GAMEPAD true
+#define TIMINGS_KEY SDLK_TAB // L shoulder on the GCW0
+
+static const rect_t timingsBounds = rect_t(2, HEIGHT - 78, 190, 76);
 
 using namespace ui;
 
-ui::ViewManager::ViewManager() : SDL<ui::ViewManager, ui::ViewManager>(*this, *this), _font(nullptr),
-_mainView(new MainView(this)), _keyboardView(new KeyboardView(this))
+ui::ViewManager::ViewManager() : SDL<ui::ViewManager, ui::ViewManager>(*this, *this),
+_mainView(new MainView(this)), _keyboardView(new KeyboardView(this)), _showTimings(false), _snapshot(snapshot::CAPACITY)
 {
   change(_mainView);
   //push(_keyboardView);
@@ -15,29 +23,70 @@ _mainView(new MainView(this)), _keyboardView(new KeyboardView(this))
 
 void ui::ViewManager::deinit()
 {
-  SDL_DestroyTexture(_font);
+  _assets.release();
 
   SDL::deinit();
 }
 
 bool ui::ViewManager::loadData()
 {
-  _font = loadTexture("font.png");
+  /* the software framebuffer reads sprites from memory */
+  _assets.init(_renderer, _framebuffer);
+  _software.setAssets(&_assets);
+
+  /* everything drawn every frame ends up in a single texture, prebuilt by
+     tools/assetpack on the handheld and packed from the PNGs elsewhere */
+  if (!_assets.loadBundle("assets.bin") && !_assets.preload({ "font.png", "chess.png", "checkers.png" }))
+    return false;
+
+  _font = _assets.image("font.png");
 
   return true;
 }
 
-SDL_Texture* ui::ViewManager::loadTexture(const std::string& path)
+bool ui::ViewManager::suspend()
 {
-  SDL_Surface* surface = IMG_Load(path.c_str());
-  assert(surface);
+  const u64 start = SDL_GetPerformanceCounter();
+
+  snapshot::Writer out(_snapshot.data(), _snapshot.size());
 
-  SDL_Texture* texture = SDL_CreateTextureFromSurface(_renderer, surface);
+  _mainView->save(out);
 
-  SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
-  SDL_FreeSurface(surface);
+  const size_t size = out.finish();
+  const path file = snapshot::location();
+
+  if (!size || !snapshot::save(file, _snapshot.data(), size))
+  {
+    printf("Error saving %s\n", file.c_str());
+    return false;
+  }
 
-  return texture;
+  LOGD("snapshot: %u bytes saved in %.2f ms", u32(size), milliseconds(SDL_GetPerformanceCounter() - start));
+  return true;
+}
+
+bool ui::ViewManager::resume()
+{
+  const u64 start = SDL_GetPerformanceCounter();
+
+  MappedFile file;
+  if (!file.open(snapshot::location()))
+    return false;
+
+  snapshot::Reader in = snapshot::open(file);
+  snapshot::Reader section;
+  u32 tag;
+
+  /* sections nobody claims, like those of another game, are skipped */
+  bool restored = false;
+  while (!in.eof() && in.section(tag, section))
+    restored |= _mainView->restore(tag, section);
+
+  if (restored)
+    invalidate();
+
+  LOGD("snapshot: %s %u bytes in %.2f ms", restored ? "resumed from" : "ignored", u32(file.size()), milliseconds(SDL_GetPerformanceCounter() - start));
+  return restored;
 }
 
 /*
@@ -57,6 +106,26 @@ SDL_Texture* ui::ViewManager::loadTexture(const std::string& path)
 
 void ui::ViewManager::handleKeyboardEvent(const SDL_Event& event)
 {
+  if (event.key.keysym.sym == TIMINGS_KEY)
+  {
+    /* cycles through hidden, shown and shown in low latency mode */
+    if (event.type == SDL_KEYDOWN)
+    {
+      if (!_showTimings)
+        _showTimings = true;
+      else if (!lowLatency())
+        setLowLatency(true);
+      else
+      {
+        _showTimings = false;
+        setLowLatency(false);
+      }
+
+      invalidate();
+    }
+    return;
+  }
+
 #if KEYBOARD_MAPPED_TO_GAMEPAD
   if (!_stack.empty())
   {
@@ -70,6 +139,7 @@ void ui::ViewManager::handleKeyboardEvent(const SDL_Event& event)
       case SDLK_DOWN: button = GamepadButton::DpadDown; break;
       case SDLK_LCTRL: button = GamepadButton::A; break;
       case SDLK_LALT: button = GamepadButton::B; break;
+      case SDLK_SPACE: button = GamepadButton::Y; break;
       default:
         _stack.back()->handleKeyboardEvent(event);
         return;
@@ -89,45 +159,109 @@ void ui::ViewManager::handleMouseEvent(const SDL_Event& event)
     _stack.back()->handleMouseEvent(event);
 }
 
+void ui::ViewManager::handleUserEvent(const SDL_Event& event)
+{
+  if (!_stack.empty())
+    _stack.back()->handleUserEvent(event);
+}
+
 
 void ui::ViewManager::render()
 {
-  for (auto* view : _stack)
-    view->render();
+  TRACE_ZONE("views");
+
+  /* a stacked view must cover whatever the ones below have drawn */
+  for (size_t i = 0; i < _stack.size(); ++i)
+  {
+    layer(i * VIEW_LAYERS);
+    _stack[i]->render();
+  }
+
+  if (_showTimings)
+  {
+    layer(_stack.size() * VIEW_LAYERS);
+    renderTimings();
+
+    /* keeps frames coming while the overlay is visible so that it has something to measure */
+    invalidate(timingsBounds);
+  }
 }
 
-void ui::ViewManager::text(const std::string& text, int32_t x, int32_t y)
+void ui::ViewManager::renderTimings()
 {
-  const float scale = 1.0;
-  constexpr int32_t GLYPHS_PER_ROW = 32;
+  static const char* names[] = { "frame", "update", "render", "present", "latency" };
+
+  fillRect(timingsBounds, { 0, 0, 0, 200 });
+
+  const int32_t x = timingsBounds.x() + 4;
+  int32_t y = timingsBounds.y() + 4;
+
+  text("ms       p50   p95   p99   max", x, y, { 255, 220, 0 }, TextAlign::LEFT, 1.0f);
 
-  for (size_t i = 0; i < text.length(); ++i)
+  for (size_t i = 0; i < FrameStats::PHASES; ++i)
   {
-    SDL_Rect src = { 6 * (text[i] % GLYPHS_PER_ROW), 9 * (text[i] / GLYPHS_PER_ROW), 5, 8 };
-    SDL_Rect dest = { x + 6 * i * scale, y, 5 * scale, 8 * scale };
-    SDL_RenderCopy(_renderer, _font, &src, &dest);
+    const FrameStats::Summary summary = frameStats().summarize(FrameStats::Phase(i));
+
+    y += 10;
+    text(format("%-7s%5.1f %5.1f %5.1f %5.1f", names[i], summary.p50, summary.p95, summary.p99, summary.max), x, y, { 255, 255, 255 }, TextAlign::LEFT, 1.0f);
   }
+
+  y += 10;
+  text(lowLatency() ? "low latency" : "paced", x, y, { 255, 220, 0 }, TextAlign::LEFT, 1.0f);
 }
 
-void ViewManager::text(const std::string& text, int32_t x, int32_t y, SDL_Color color, TextAlign align, float scale)
+void ui::ViewManager::glyphs(const utf8_string& text, glyph_string& out)
 {
-  constexpr int32_t GLYPHS_PER_ROW = 32;
+  out.clear();
 
-  const int32_t width = text.size() * 6 * scale;
+  const char* it = text.data();
+  const char* end = it + text.size();
 
-  if (align == TextAlign::CENTER)
-    x -= width / 2;
-  else if (align == TextAlign::RIGHT)
-    x -= width;
-
-  SDL_SetTextureColorMod(_font, color.r, color.g, color.b);
+  while (it != end)
+    out.push_back(glyph(utf8::next(it, end)));
+}
 
-  for (size_t i = 0; i < text.length(); ++i)
+void ui::ViewManager::text(const TextLayout& layout, int32_t x, int32_t y, color_t color)
+{
+  for (const GlyphQuad& quad : layout.quads())
   {
-    SDL_Rect src = { 6 * (text[i] % GLYPHS_PER_ROW), 9 * (text[i] / GLYPHS_PER_ROW), 5, 8 };
-    SDL_Rect dest = { x + 6 * i * scale, y, 5 * scale, 8 * scale };
-    SDL_RenderCopy(_renderer, _font, &src, &dest);
+    const SDL_Rect src = { _font.rect.x() + quad.src.x, _font.rect.y() + quad.src.y, quad.src.w, quad.src.h };
+    const SDL_Rect dst = { x + quad.dst.x, y + quad.dst.y, quad.dst.w, quad.dst.h };
+
+    /* the tint travels with each glyph so strings of different colors still end up in the same batch */
+    _batch.quad(_font.texture, src, dst, color);
   }
+}
 
-  SDL_SetTextureColorMod(_font, 255, 255, 255);
-}
\ No newline at end of file
+void ui::ViewManager::text(const std::string& text, int32_t x, int32_t y)
+{
+  this->text(_layouts.get(text, _metrics, 1.0f, TextAlign::LEFT), x, y, color_t(255, 255, 255));
+}
+
+void ViewManager::text(const char* text, size_t length, int32_t x, int32_t y, SDL_Color color, TextAlign align, float scale)
+{
+  this->text(_layouts.get(text, length, _metrics, scale, align), x, y, color_t(color.r, color.g, color.b));
+}
+
+frame_string ViewManager::format(const char* format, ...)
+{
+  va_list args, copy;
+  va_start(args, format);
+  va_copy(copy, args);
+
+  const int length = vsnprintf(nullptr, 0, format, copy);
+  va_end(copy);
+
+  frame_string result(std::max(length, 0), '\0', ArenaAllocator<char>(frameArena()));
+
+  if (length > 0)
+    vsnprintf(&result[0], length + 1, format, args);
+
+  va_end(args);
+  return result;
+}
+
+void ViewManager::text(const glyph_t* glyphs, size_t length, int32_t x, int32_t y, SDL_Color color, TextAlign align, float scale)
+{
+  this->text(_layouts.get(glyphs, length, _metrics, scale, align), x, y, color_t(color.r, color.g, color.b));
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "SdlHelper.h"
+#include "TextLayout.h"
+#include "Unicode.h"
 
 #include <array>
 #include <vector>
@@ -25,11 +27,7 @@ namespace ui
     virtual void handleGamepadEvent(GamepadButton button, bool pressed) = 0;
     virtual void handleKeyboardEvent(const SDL_Event& event) = 0;
     virtual void handleMouseEvent(const SDL_Event& event) = 0;
-  };
-
-  enum TextAlign
-  {
-    LEFT, CENTER, RIGHT
+    virtual void handleUserEvent(const SDL_Event& event) { }
   };
 
   class MainView;
@@ -40,36 +38,75 @@ namespace ui
   public:
     using view_t = View;
 
-    SDL_Texture* _font;
+    /* batch layers each view can use through nextLayer() */
+    static constexpr u32 VIEW_LAYERS = 16;
 
   private:
+    Assets _assets;
+    Image _font;
+    FontMetrics _metrics;
+    mutable TextLayoutCache _layouts;
+
+    void text(const TextLayout& layout, int32_t x, int32_t y, color_t color);
+
     MainView* _mainView;
     KeyboardView* _keyboardView;
 
     std::vector<view_t*> _stack;
 
+
+    bool _showTimings;
+    void renderTimings();
+
+    /* allocated with the manager, suspending shouldn't depend on finding 64 KB of heap */
+    std::vector<u8> _snapshot;
+
   public:
     ViewManager();
 
-    SDL_Texture* loadTexture(const std::string& path);
+    /* decoded and packed by loadData, anything else is loaded on first use */
+    const Image& image(const path& path) { return _assets.image(path); }
+    const Assets& assets() const { return _assets; }
 
     bool loadData();
 
+    /* the game state, see Snapshot.h; resume goes before the first frame */
+    bool suspend();
+    bool resume();
+
     void handleKeyboardEvent(const SDL_Event& event);
     void handleMouseEvent(const SDL_Event& event);
+    void handleUserEvent(const SDL_Event& event);
     void render();
 
     void deinit();
 
-    void push(view_t* view) { _stack.push_back(view); view->activate(false); }
-    void pop() { _stack.pop_back(); }
+    void push(view_t* view) { _stack.push_back(view); view->activate(false); invalidate(); }
+    void pop() { _stack.pop_back(); invalidate(); }
     void change(view_t* view) { if (!_stack.empty()) pop(); push(view); view->activate(); }
 
-    SDL_Texture* font() { return _font; }
+    const Image& font() const { return _font; }
+
+    static glyph_t glyph(unicode_t cp) { return toGlyph(cp); }
+    static void glyphs(const utf8_string& text, glyph_string& out);
+    static glyph_string glyphs(const utf8_string& text) { glyph_string out; glyphs(text, out); return out; }
 
-    int32_t textWidth(const std::string& text, float scale = 2.0f) const { return text.length() * scale * 4; }
-    void text(const std::string& text, int32_t x, int32_t y, SDL_Color color, TextAlign align, float scale = 2.0f);
+    const FontMetrics& fontMetrics() const { return _metrics; }
+    int32_t textWidth(const std::string& text, float scale = 2.0f) const { return _layouts.get(text, _metrics, scale, TextAlign::LEFT).width(); }
+    void text(const std::string& text, int32_t x, int32_t y, SDL_Color color, TextAlign align, float scale = 2.0f) { this->text(text.data(), text.size(), x, y, color, align, scale); }
     void text(const std::string& text, int32_t x, int32_t y);
+
+    /* UTF-8 which isn't in a std::string, no temporary is built for literals or formatted text */
+    void text(const char* text, size_t length, int32_t x, int32_t y, SDL_Color color, TextAlign align, float scale = 2.0f);
+    void text(const char* text, int32_t x, int32_t y, SDL_Color color, TextAlign align, float scale = 2.0f) { this->text(text, strlen(text), x, y, color, align, scale); }
+    void text(const frame_string& text, int32_t x, int32_t y, SDL_Color color, TextAlign align, float scale = 2.0f) { this->text(text.data(), text.size(), x, y, color, align, scale); }
+
+    /* printf into the frame arena, the result is valid until the next frame starts */
+    frame_string format(const char* format, ...);
+
+    /* already translated text, nothing is decoded while drawing */
+    void text(const glyph_t* glyphs, size_t length, int32_t x, int32_t y, SDL_Color color, TextAlign align, float scale = 2.0f);
+    void text(const glyph_string& glyphs, int32_t x, int32_t y, SDL_Color color, TextAlign align, float scale = 2.0f) { text(glyphs.data(), glyphs.size(), x, y, color, align, scale); }
   };
 }
 
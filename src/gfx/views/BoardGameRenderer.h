@@ -1,8 +1,14 @@
+#include "gfx/CachedLayer.h"
+#include "gfx/HitGrid.h"
 #include "gfx/MainView.h"
 #include "gfx/ViewManager.h"
 
+#include "games/board/Analysis.h"
 #include "games/board/Board.h"
 
+#include <cmath>
+#include <memory>
+
 namespace ui
 {
   template<typename Game, typename Renderer>
@@ -41,13 +47,52 @@ namespace ui
     games::MoveSet<Move> availableMoves;
     games::PlayerMoveSet<Move> availableMovesForPlayer;
 
+    /* highlights of each cell, rebuilt from the sets above whenever they change */
+    enum Overlay : u8 { MoveTarget = 0x01, HeldFrom = 0x02, Movable = 0x04 };
+    std::vector<u8> overlay;
+
+    void updateOverlay();
+    u8& overlayAt(point_t coord) { return overlay[coord.y * game.boardSize().w + coord.x]; }
+
     point_t margin;
     coord_t cs; // cell size
     bool flipped = true;
 
+    /* background, grid, dark squares and coordinates */
+    CachedLayer boardLayer;
+
+    u64 layoutKey() const { return u64(flipped) | (u64(cs & 0xFF) << 8) | (u64(margin.x & 0xFFFF) << 16) | (u64(margin.y & 0xFFFF) << 32); }
+    void renderBoard(ViewManager* gvm);
+
+    /* a region for each cell at y * width + x in board coordinates, laid out again when the layout key changes */
+    HitGrid cells;
+    u64 cellsLayout = ~0ULL;
+
+    void layoutCells();
+
+    rect_t cellRect(point_t coord) const
+    {
+      return rect_t(margin.x + coord.x * cs, margin.y + (flipped ? (game.boardSize().h - coord.y - 1) : coord.y) * cs, cs + 1, cs + 1);
+    }
+
     bool tryToPickupPieceAt(point_t coord);
     bool tryToDropPieceAt(point_t coord);
 
+    /* engine lines drawn over the board, games without an engine can't turn it on */
+    std::unique_ptr<games::Analyzer<Game>> analyzer;
+    typename games::Analyzer<Game>::Report analysis;
+    u32 analysisGeneration = 0;
+    bool analyzing = false;
+
+    /* labels of the report, built when it arrives rather than every frame */
+    std::vector<std::string> analysisScores;
+    std::vector<std::string> analysisMoves;
+    std::string analysisLine;
+
+    void toggleAnalysis();
+    void analyze();
+    void renderAnalysis(ViewManager* gvm);
+
   public:
     BoardGameRenderer();
 
@@ -55,6 +100,11 @@ namespace ui
     void mouseMoved(point_t p) override;
     void mouseButton(point_t p, MouseButton button, bool pressed) override;
     void gamepadButton(GamepadButton button, bool pressed) override;
+
+    void save(snapshot::Writer& out) const override;
+    bool restore(u32 tag, snapshot::Reader& in) override;
+
+    void poll() override;
   };
 
   template<typename T, typename Renderer>
@@ -64,10 +114,104 @@ namespace ui
     availableMovesForPlayer = game.allowedMoveSetForPlayer(game.currentPlayer());
 
     margin.x = WIDTH / 2 - cs * game.boardSize().w / 2;
+
+    updateOverlay();
   }
 
   template<typename T, typename Renderer>
-  void BoardGameRenderer<T, Renderer>::render(ViewManager* gvm)
+  void BoardGameRenderer<T, Renderer>::updateOverlay()
+  {
+    overlay.assign(game.boardSize().w * game.boardSize().h, 0);
+
+    for (const Move& move : availableMoves)
+      overlayAt(move.to) |= MoveTarget;
+
+    if (held.present)
+      overlayAt(held.from) |= HeldFrom;
+    else
+    {
+      for (const auto& entry : availableMovesForPlayer)
+        overlayAt(entry.first) |= Movable;
+    }
+  }
+
+  template<typename T, typename Renderer>
+  void BoardGameRenderer<T, Renderer>::save(snapshot::Writer& out) const
+  {
+    const size_t section = out.begin(game.snapshotTag());
+
+    /* a held piece isn't on the board, it's written with the renderer and is still held after resuming */
+    game.save(out);
+    out.write(held);
+    out.write(gamepad);
+    out.write(mouseMode);
+    out.write(flipped);
+
+    out.end(section);
+  }
+
+  template<typename T, typename Renderer>
+  bool BoardGameRenderer<T, Renderer>::restore(u32 tag, snapshot::Reader& in)
+  {
+    if (tag != game.snapshotTag())
+      return false;
+
+    /* read aside and range checked, the bytes are whatever the file had */
+    decltype(held) heldRead;
+    decltype(gamepad) gamepadRead;
+    bool mouseModeRead, flippedRead;
+
+    const bool restored = game.restore(in) && in.read(heldRead) && in.read(gamepadRead) && in.read(mouseModeRead) && in.read(flippedRead) &&
+      snapshot::isBool(heldRead.present) && (!heldRead.present || (heldRead.piece.present && heldRead.piece.valid() && game.isValid(heldRead.from))) &&
+      snapshot::isBool(gamepadRead.valid) && (!gamepadRead.valid || game.isValid(gamepadRead.cell)) &&
+      snapshot::isBool(mouseModeRead) && snapshot::isBool(flippedRead);
+
+    if (restored)
+    {
+      held = heldRead;
+      gamepad = gamepadRead;
+      mouseMode = mouseModeRead;
+      flipped = flippedRead;
+    }
+    else
+    {
+      game.resetBoard();
+      held = { false };
+      gamepad = { false };
+    }
+
+    availableMovesForPlayer = game.allowedMoveSetForPlayer(game.currentPlayer());
+
+    if (held.present)
+      availableMoves = game.allowedMoves(held.piece, held.from);
+    else
+      availableMoves.clear();
+
+    updateOverlay();
+    analyze();
+    return restored;
+  }
+
+  template<typename T, typename Renderer>
+  void BoardGameRenderer<T, Renderer>::layoutCells()
+  {
+    if (cellsLayout == layoutKey())
+      return;
+
+    const auto boardSize = game.boardSize();
+
+    /* without the pixel cellRect adds for the border, cells don't overlap */
+    cells.clear();
+    for (auto y = 0; y < boardSize.h; ++y)
+      for (auto x = 0; x < boardSize.w; ++x)
+        cells.add(rect_t(margin.x + x * cs, margin.y + (flipped ? (boardSize.h - y - 1) : y) * cs, cs, cs));
+
+    cells.build();
+    cellsLayout = layoutKey();
+  }
+
+  template<typename T, typename Renderer>
+  void BoardGameRenderer<T, Renderer>::renderBoard(ViewManager* gvm)
   {
     const auto boardSize = game.boardSize();
     const auto BW = boardSize.w;
@@ -96,27 +240,47 @@ namespace ui
       for (auto y = 0; y < BH; ++y)
       {
         point_t base = point_t(margin.x + x * cs, margin.y + (flipped ? (BH - y - 1) : y) * cs);
-        const auto coord = point_t(x, y);
 
         if ((y + x) % 2 == 1)
           gvm->fillRect({ base.x + 1, base.y + 1, cs - 1, cs - 1 }, color_t{ 80, 80, 80 });
+      }
+  }
 
-        auto it = std::find_if(availableMoves.begin(), availableMoves.end(), [&coord](const Move& move) { return move.endsOn(coord); });
+  template<typename T, typename Renderer>
+  void BoardGameRenderer<T, Renderer>::render(ViewManager* gvm)
+  {
+    TRACE_ZONE("board");
 
-        if (it != availableMoves.end())
+    const auto boardSize = game.boardSize();
+    const auto BW = boardSize.w;
+    const auto BH = boardSize.h;
+
+    boardLayer.update(gvm, layoutKey(), [this, gvm]() { renderBoard(gvm); });
+    boardLayer.draw(gvm);
+
+    /* highlights and pieces go over the cached board */
+    gvm->nextLayer();
+
+    const point_t none = point_t(-1, -1);
+    const point_t cursor = mouseMode ? (mouse.valid ? mouse.cell : none) : (gamepad.valid ? gamepad.cell : none);
+
+    for (auto x = 0; x < BW; ++x)
+      for (auto y = 0; y < BH; ++y)
+      {
+        point_t base = point_t(margin.x + x * cs, margin.y + (flipped ? (BH - y - 1) : y) * cs);
+        const auto coord = point_t(x, y);
+        const u8 mask = overlayAt(coord);
+
+        if (mask & MoveTarget)
           gvm->drawRect(rect_t(base.x + 1, base.y + 1, cs - 1, cs - 1), color_t{ 0, 220, 0 });
-        else if (held.present && held.from == coord)
+        else if (mask & HeldFrom)
           gvm->drawRect(rect_t(base.x + 1, base.y + 1, cs - 1, cs - 1), color_t{ 220, 220, 0 });
-        if (!held.present && availableMovesForPlayer.find(coord) != availableMovesForPlayer.end())
+        if (mask & Movable)
           gvm->drawRect(rect_t(base.x + 1, base.y + 1, cs - 1, cs - 1), color_t{ 0, 220, 0 });
 
-
-        if (mouseMode && mouse.cell == coord)
-          gvm->drawRect(rect_t(base.x + 1, base.y + 1, cs - 1, cs - 1), color_t{ 220, 0, 0 });
-        if (!mouseMode && gamepad.valid && gamepad.cell == coord)
+        if (cursor == coord)
           gvm->drawRect(rect_t(base.x + 1, base.y + 1, cs - 1, cs - 1), color_t{ 220, 0, 0 });
 
-
         const auto& cell = game.get(coord);
 
         if (cell.present)
@@ -125,6 +289,8 @@ namespace ui
 
     if (held.present)
     {
+      gvm->nextLayer();
+
       if (mouseMode)
         pieceRenderer.render(gvm, mouse.position, held.piece);
       else
@@ -133,21 +299,159 @@ namespace ui
         pieceRenderer.render(gvm, base + cs / 2 + point_t(0, -6), held.piece, true);
       }
     }
+
+    if (analyzing)
+      renderAnalysis(gvm);
+  }
+
+  template<typename T, typename Renderer>
+  void BoardGameRenderer<T, Renderer>::toggleAnalysis()
+  {
+    if (!analyzer)
+    {
+      /* wakes the loop up, which waits for input otherwise */
+      analyzer.reset(games::createAnalyzer<decltype(game)>([]() {
+        SDL_Event event = { };
+        event.type = SDL_USEREVENT;
+        SDL_PushEvent(&event);
+      }));
+
+      if (!analyzer)
+        return;
+    }
+
+    analyzing = !analyzing;
+
+    if (analyzing)
+      analyze();
+    else
+      analyzer->stop();
+
+    gvm->invalidate();
+  }
+
+  template<typename T, typename Renderer>
+  void BoardGameRenderer<T, Renderer>::analyze()
+  {
+    if (!analyzing)
+      return;
+
+    analysis.lines.clear();
+    analysisScores.clear();
+    analysisMoves.clear();
+    analysisLine.clear();
+
+    analyzer->analyze(game);
+  }
+
+  template<typename T, typename Renderer>
+  void BoardGameRenderer<T, Renderer>::poll()
+  {
+    if (!analyzing || !analyzer->poll(analysisGeneration, analysis))
+      return;
+
+    auto square = [](point_t p) { return std::string(1, char('a' + p.x)) + char('1' + p.y); };
+
+    analysisScores.clear();
+    analysisMoves.clear();
+    analysisLine.clear();
+
+    char score[16];
+
+    for (const auto& line : analysis.lines)
+    {
+      if (line.mate)
+        snprintf(score, sizeof(score), line.mate > 0 ? "#%d" : "-#%d", std::abs(line.mate));
+      else
+        snprintf(score, sizeof(score), "%+.2f", line.score / 100.0f);
+
+      analysisScores.push_back(score);
+      analysisMoves.push_back(line.pv.empty() ? std::string() : square(line.pv.front().from) + square(line.pv.front().to));
+    }
+
+    /* the best line in full, as far as it fits above the board */
+    if (!analysis.lines.empty())
+    {
+      analysisLine = "d" + std::to_string(analysis.depth);
+
+      for (const Move& move : analysis.lines.front().pv)
+      {
+        const std::string next = analysisLine + " " + square(move.from) + square(move.to);
+
+        if (gvm->textWidth(next, 1.0f) > WIDTH - 4)
+          break;
+
+        analysisLine = next;
+      }
+    }
+
+    gvm->invalidate();
+  }
+
+  template<typename T, typename Renderer>
+  void BoardGameRenderer<T, Renderer>::renderAnalysis(ViewManager* gvm)
+  {
+    static const color_t colors[] = { { 0, 120, 255, 220 }, { 0, 180, 120, 200 }, { 200, 120, 0, 180 } };
+
+    gvm->nextLayer();
+
+    /* worst first so that the best arrow ends up on top */
+    for (size_t i = analysis.lines.size(); i-- > 0; )
+    {
+      const auto& pv = analysis.lines[i].pv;
+
+      if (pv.empty())
+        continue;
+
+      const color_t color = colors[std::min<size_t>(i, 2)];
+      const rect_t from = cellRect(pv.front().from), to = cellRect(pv.front().to);
+      const point_t a = point_t(from.x() + cs / 2, from.y() + cs / 2), b = point_t(to.x() + cs / 2, to.y() + cs / 2);
+
+      /* three lines side by side make the shaft, across its main direction */
+      const bool steep = std::abs(b.y - a.y) > std::abs(b.x - a.x);
+      for (coord_t o = -1; o <= 1; ++o)
+        gvm->line(a.x + (steep ? o : 0), a.y + (steep ? 0 : o), b.x + (steep ? o : 0), b.y + (steep ? 0 : o), color);
+
+      const float dx = float(b.x - a.x), dy = float(b.y - a.y), length = std::sqrt(dx * dx + dy * dy);
+      const float ux = dx / length, uy = dy / length, head = cs / 3.0f;
+
+      gvm->line(b.x, b.y, b.x - coord_t(head * (ux - uy * 0.6f)), b.y - coord_t(head * (uy + ux * 0.6f)), color);
+      gvm->line(b.x, b.y, b.x - coord_t(head * (ux + uy * 0.6f)), b.y - coord_t(head * (uy - ux * 0.6f)), color);
+    }
+
+    for (size_t i = 0; i < analysisScores.size(); ++i)
+    {
+      const color_t color = colors[std::min<size_t>(i, 2)];
+      const SDL_Color text = { color.r, color.g, color.b, 255 };
+
+      gvm->text(analysisScores[i], 2, margin.y + s32(i) * 22, text, TextAlign::LEFT, 1.0f);
+      gvm->text(analysisMoves[i], 2, margin.y + s32(i) * 22 + 9, text, TextAlign::LEFT, 1.0f);
+    }
+
+    if (!analysisLine.empty())
+      gvm->text(analysisLine, 2, 2, { 0, 0, 0 }, TextAlign::LEFT, 1.0f);
+    else
+      gvm->text("...", 2, 2, { 0, 0, 0 }, TextAlign::LEFT, 1.0f);
   }
 
   template<typename T, typename Renderer>
   void BoardGameRenderer<T, Renderer>::mouseMoved(point_t p)
   {
+    /* leaving gamepad mode hides its cursor and moves the held piece */
+    if (!mouseMode)
+      gvm->invalidate();
+
     mouseMode = true;
 
-    auto x = (p.x - margin.x) / cs, y = (p.y - margin.y) / cs;
+    const point_t previousCell = mouse.valid ? mouse.cell : point_t(-1, -1);
+    const point_t previousPosition = mouse.position;
+
+    layoutCells();
+    const s32 cell = cells.at(p);
 
-    if (p.x >= margin.x && p.y >= margin.y && x >= 0 && x < game.boardSize().w && y >= 0 && y < game.boardSize().h)
+    if (cell != HitGrid::NONE)
     {
-      if (flipped)
-        mouse.cell = { x, game.boardSize().h - y - 1 };
-      else
-        mouse.cell = { x, y };
+      mouse.cell = { cell % game.boardSize().w, cell / game.boardSize().w };
       mouse.valid = true;
     }
     else
@@ -157,6 +461,20 @@ namespace ui
     }
 
     mouse.position = p;
+
+    if (held.present)
+    {
+      gvm->invalidate(rect_t(previousPosition.x - cs / 2, previousPosition.y - cs / 2, cs, cs));
+      gvm->invalidate(rect_t(p.x - cs / 2, p.y - cs / 2, cs, cs));
+    }
+
+    if (mouse.cell != previousCell)
+    {
+      if (previousCell.x != -1)
+        gvm->invalidate(cellRect(previousCell));
+      if (mouse.valid)
+        gvm->invalidate(cellRect(mouse.cell));
+    }
   }
 
   template<typename T, typename Renderer>
@@ -170,6 +488,7 @@ namespace ui
       {
         held = { true, coord, cell };
         cell = T();
+        updateOverlay();
         return true;
       }
     }
@@ -186,6 +505,7 @@ namespace ui
       game.get(held.from) = held.piece;
       held.piece = T();
       availableMoves.clear();
+      updateOverlay();
       return true;
     }
     else if (game.pieceMoved(held.piece, Move(held.from, coord)))
@@ -196,6 +516,8 @@ namespace ui
 
       game.nextTurn();
       availableMovesForPlayer = game.allowedMoveSetForPlayer(game.currentPlayer());
+      updateOverlay();
+      analyze();
       return true;
     }
 
@@ -270,6 +592,13 @@ namespace ui
 
           break;
         }
+
+        case GamepadButton::Y:
+          toggleAnalysis();
+          break;
+
+        default:
+          break;
       }
     }
 
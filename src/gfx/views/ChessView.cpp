@@ -4,20 +4,21 @@
 #include "BoardGameRenderer.h"
 
 #include "games/board/Chess.h"
+#include "games/board/ChessAnalysis.h"
 #include "games/board/Checkers.h"
 
 using namespace ui;
 
 struct ChessPieceRenderer
 {
-  SDL_Texture* pieces;
+  const Image* pieces;
 
   ChessPieceRenderer() : pieces(nullptr) { }
 
   void render(ViewManager* gvm, point_t p, const games::chess::Piece& piece, bool floating = false)
   {
     if (!pieces)
-      pieces = gvm->loadTexture("chess.png");
+      pieces = &gvm->image("chess.png");
 
     using Piece = games::chess::Piece;
 
@@ -44,11 +45,11 @@ struct ChessPieceRenderer
     if (floating)
     {
       rect_t src = { 96, 0, 16, 16 };
-      gvm->blit(pieces, src, p.x - size / 2, p.y - size / 2);
+      gvm->blit(*pieces, src, p.x - size / 2, p.y - size / 2);
       p.y -= 6;
     }
 
-    gvm->blit(pieces, rect, p.x - size / 2, p.y - size / 2);
+    gvm->blit(*pieces, rect, p.x - size / 2, p.y - size / 2);
   }
 };
 
@@ -58,14 +59,14 @@ using ChessRenderer = BoardGameRenderer<games::chess::Chess, ChessPieceRenderer>
 
 struct CheckersPieceRenderer
 {
-  SDL_Texture* pieces;
+  const Image* pieces;
 
   CheckersPieceRenderer() : pieces(nullptr) { }
 
-  void render(ViewManager* gvm, point_t p, const games::checkers::Piece& piece)
+  void render(ViewManager* gvm, point_t p, const games::checkers::Piece& piece, bool floating = false)
   {
     if (!pieces)
-      pieces = gvm->loadTexture("checkers.png");
+      pieces = &gvm->image("checkers.png");
 
     using Piece = games::checkers::Piece;
 
@@ -78,11 +79,18 @@ struct CheckersPieceRenderer
     if (piece.color == games::Color::Black)
       rect.origin.y += size;
 
-    gvm->blit(pieces, rect, p.x - size / 2, p.y - size / 2);
+    /* there is no shadow in the sheet, a held piece is just lifted */
+    if (floating)
+      p.y -= 6;
+
+    gvm->blit(*pieces, rect, p.x - size / 2, p.y - size / 2);
   }
 };
 
 using CheckersRenderer = BoardGameRenderer<games::checkers::Game, CheckersPieceRenderer>;
 
 
-GameRenderer* irenderer = new ChessRenderer();
\ No newline at end of file
+GameRenderer* ui::createChessRenderer() { return new ChessRenderer(); }
+GameRenderer* ui::createCheckersRenderer() { return new CheckersRenderer(); }
+
+GameRenderer* irenderer = createChessRenderer();
\ No newline at end of file
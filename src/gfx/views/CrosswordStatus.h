@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Common.h"
+#include "gfx/TextLayout.h"
+
+#include "games/CrosswordGrid.h"
+
+#include <vector>
+
+namespace gfx
+{
+  enum class Status { Normal, Hidden, Blocked };
+
+  struct CellStatus
+  {
+    ui::glyph_t glyph;
+    Status status;
+    bool solved;
+
+    CellStatus() : glyph(0), status(Status::Blocked), solved(false) { }
+  };
+
+  class CrosswordGfxStatus
+  {
+  private:
+    s32 w;
+    std::vector<CellStatus> status;
+
+  public:
+    CrosswordGfxStatus(s32 w, s32 h) : w(w)
+    {
+      status.resize(w*h);
+    }
+
+    CellStatus& at(s32 x, s32 y) { return status[y * w + x]; }
+    const CellStatus& at(s32 x, s32 y) const { return status[y*w + x]; }
+
+    /* pulls only the cells which changed since the last update, returns whether there were any */
+    bool update(games::CrosswordGrid& grid)
+    {
+      const bool changed = !grid.dirty().empty();
+
+      for (s32 index : grid.dirty())
+      {
+        const games::CrosswordCell& cell = grid.at(index);
+        CellStatus& cs = status[index];
+
+        cs.glyph = cell.isFilled() ? ui::toGlyph(cell.letter) : 0;
+        cs.status = cell.isBlocked() ? Status::Blocked : Status::Normal;
+        cs.solved = grid.isInSolvedWord(cell);
+      }
+
+      grid.clearDirty();
+      return changed;
+    }
+  };
+}
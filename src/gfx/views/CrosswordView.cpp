@@ -1,52 +1,63 @@
+#include "gfx/CachedLayer.h"
+#include "gfx/HitGrid.h"
 #include "gfx/MainView.h"
 #include "gfx/ViewManager.h"
 
 #include "games/Crossword.h"
+#include "games/CrosswordAssistant.h"
+#include "games/CrosswordGrid.h"
+#include "games/CrosswordValidator.h"
+
+#include "CrosswordStatus.h"
+
+#include <type_traits>
+#include <vector>
 
 using namespace ui;
 
 
 namespace gfx
 {
-  enum class Status { Normal, Hidden, Blocked };
-
-  struct CellStatus
-  {
-    char text; //TODO: utf8 support
-    Status status;
-
-    CellStatus() : text('\0'), status(Status::Blocked) { }
-  };
-
-  class CrosswordGfxStatus
+  /* hints translated to glyphs and word wrapped once, when the scheme is loaded */
+  class HintCache
   {
   private:
-    s32 w;
-    std::vector<CellStatus> status;
+    std::vector<std::vector<ui::glyph_string>> lines;
 
   public:
-    CrosswordGfxStatus(s32 w, s32 h) : w(w)
+    void build(const games::CrosswordScheme& scheme, size_t columns)
     {
-      status.resize(w*h);
-    }
+      lines.clear();
 
-    CellStatus& at(s32 x, s32 y) { return status[y * w + x]; }
-    const CellStatus& at(s32 x, s32 y) const { return status[y*w + x]; }
-
-    void update(const games::CrosswordScheme* scheme)
-    {
-      for (const auto& def : scheme->definitions())
+      for (const auto& def : scheme.definitions())
       {
-        auto p = def.position;
-        for (s32 i = 0; i < def.definition.text.size(); ++i)
-        {
-          at(p.x, p.y).text = def.definition.text[i];
-          at(p.x, p.y).status = Status::Normal;
+        const ui::glyph_string glyphs = ViewManager::glyphs(def.definition.hint);
+        lines.push_back(std::vector<ui::glyph_string>());
 
-          p += def.orientation;
+        size_t start = 0;
+        while (start < glyphs.size())
+        {
+          size_t end = std::min(start + columns, glyphs.size());
+
+          if (end < glyphs.size())
+          {
+            size_t space = end;
+            while (space > start && glyphs[space] != ' ')
+              --space;
+            if (space > start)
+              end = space;
+          }
+
+          lines.back().push_back(ui::glyph_string(glyphs.begin() + start, glyphs.begin() + end));
+
+          start = end;
+          while (start < glyphs.size() && glyphs[start] == ' ')
+            ++start;
         }
       }
     }
+
+    const std::vector<ui::glyph_string>& operator[](games::word_id id) const { return lines[id]; }
   };
 
   void renderTinyNumber(uint64_t n, int32_t x, int32_t y, color_t color)
@@ -58,24 +69,72 @@ namespace gfx
 class CrosswordRenderer : public GameRenderer
 {
 private:
+  /* the indexed dictionary behind suggestions stays resident, words past this are dropped */
+  static constexpr size_t DICTIONARY_BUDGET = 4 << 20;
+  static constexpr size_t SUGGESTIONS = 6;
+
   point_t cellHover;
+  point_t cursor;
+  games::Dir direction;
   point_t margin;
   coord_t cs; // cell size
 
   games::CrosswordScheme scheme = games::CrosswordScheme(13, 13);
+  games::CrosswordGrid grid = games::CrosswordGrid(scheme);
   gfx::CrosswordGfxStatus schemeStatus = gfx::CrosswordGfxStatus(13, 13);
+  gfx::HintCache hints;
+
+  /* suggestions for the word under the cursor, only when a dictionary.txt was found */
+  games::Dictionary dictionary;
+  games::CrosswordAssistant assistant = games::CrosswordAssistant(dictionary);
+  bool assisting;
+
+  games::word_id suggested;
+  bool suggestionsStale;
+  games::Suggestion suggestions[SUGGESTIONS];
+  size_t suggestionCount;
+
+  void loadDictionary();
+  void renderSuggestions(ViewManager* gvm, games::word_id word, coord_t y);
+
+  /* types or clears the cell under the cursor, keeping the candidates in step */
+  void setCell(unicode_t letter);
+
+  /* grid lines, blocked cells and letters, rebuilt when a cell changes */
+  CachedLayer gridLayer;
+
+  void renderGrid(ViewManager* gvm);
+  void moveCursor(coord_t dx, coord_t dy);
+
+  /* a region for each cell at y * width + x, the grid doesn't move once laid out */
+  HitGrid cells;
+
+  void layoutCells();
+
+  rect_t cellRect(point_t cell) const { return rect_t(margin.x + cs * cell.x, margin.y + cs * cell.y, cs + 1, cs + 1); }
+
+  /* tells the scheme progress was saved on apart from any other */
+  u32 schemeKey() const;
 
 public:
   CrosswordRenderer();
 
   void render(ViewManager* gvm) override;
   void mouseMoved(point_t p) override;
+  void mouseButton(point_t p, MouseButton button, bool pressed) override;
+  void gamepadButton(GamepadButton button, bool pressed) override;
+  void keyPressed(SDL_Keycode key) override;
+
+  void save(snapshot::Writer& out) const override;
+  bool restore(u32 tag, snapshot::Reader& in) override;
 };
 
 
-CrosswordRenderer::CrosswordRenderer() : GameRenderer(), margin({ 1, 1 }), cs(14)
+CrosswordRenderer::CrosswordRenderer() : GameRenderer(), direction(games::Dir::Hor), margin({ 1, 1 }), cs(14),
+  assisting(false), suggested(games::NO_WORD), suggestionsStale(true), suggestionCount(0)
 {
   cellHover = { -1, -1 };
+  cursor = { 0, 0 };
 
   scheme.addDefinition(0, 0, games::Dir::Hor, "casse", "Servono per imballare");
   scheme.addDefinition(6, 0, games::Dir::Hor, "iago", "Desta la gelosia di Otello");
@@ -85,13 +144,64 @@ CrosswordRenderer::CrosswordRenderer() : GameRenderer(), margin({ 1, 1 }), cs(14
   scheme.addDefinition(0, 0, games::Dir::Ver, "cibo", "Cosa da mangiare");
   scheme.addDefinition(1, 0, games::Dir::Ver, "anonima", "Priva di firma");
 
-  schemeStatus.update(&scheme);
+  grid.reset(scheme);
+
+  /* the grid keeps the first letter where answers disagree, the log tells what was wrong */
+  for (const games::CrosswordIssue& issue : games::CrosswordValidator().validate(scheme).issues)
+    if (issue.error)
+      LOGD("crossword: %s, word %d at %d,%d: %s", games::CrosswordValidator::name(issue.kind), issue.word, issue.cell.x, issue.cell.y, issue.detail.c_str());
+
+  hints.build(scheme, (WIDTH - (margin.x + scheme.width() * cs) - 8) / 6);
+  layoutCells();
+
+  loadDictionary();
 }
 
-void CrosswordRenderer::render(ViewManager* gvm)
+void CrosswordRenderer::layoutCells()
+{
+  cells.clear();
+
+  for (s32 y = 0; y < scheme.height(); ++y)
+    for (s32 x = 0; x < scheme.width(); ++x)
+      cells.add(rect_t(margin.x + cs * x, margin.y + cs * y, cs, cs));
+
+  cells.build();
+}
+
+void CrosswordRenderer::loadDictionary()
+{
+  const u64 start = SDL_GetPerformanceCounter();
+
+  if (!dictionary.load("dictionary.txt"))
+    return;
+
+  dictionary.build(DICTIONARY_BUDGET);
+  assistant.reset(grid);
+  assisting = true;
+
+  LOGD("dictionary: %u words in %u KB, %.1f ms", u32(dictionary.size()), u32(dictionary.memory() / 1024),
+    (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+}
+
+void CrosswordRenderer::renderSuggestions(ViewManager* gvm, games::word_id word, coord_t y)
 {
-  auto r = gvm->renderer();
+  if (word != suggested || suggestionsStale)
+  {
+    suggestionCount = assistant.suggest(grid, word, suggestions, SUGGESTIONS);
+    suggested = word;
+    suggestionsStale = false;
+  }
+
+  const coord_t x = margin.x + scheme.width() * cs + 6;
 
+  gvm->text(gvm->format("%u words", u32(assistant.count(word))), x, y, { 120, 120, 120 }, ui::TextAlign::LEFT, 1.0f);
+
+  for (size_t i = 0; i < suggestionCount; ++i)
+    gvm->text(dictionary.word(suggestions[i].word).text, x, y + 10 + i * 10, { 0, 0, 160 }, ui::TextAlign::LEFT, 1.0f);
+}
+
+void CrosswordRenderer::renderGrid(ViewManager* gvm)
+{
   gvm->clear({ 255, 255, 255 });
 
   const auto w = scheme.width(), h = scheme.height();
@@ -109,9 +219,39 @@ void CrosswordRenderer::render(ViewManager* gvm)
 
       if (status.status == gfx::Status::Blocked)
         gvm->fillRect(1 + x * cs + 2, 1 + y * cs + 2, cs - 3, cs - 3, { 40, 40, 40, 255 });
-      else if (status.status == gfx::Status::Normal)
-        gvm->text(utf8_string("") + status.text, x * cs + cs/2 + 1, y * cs + cs/4 + 1, { 0, 0, 0 }, ui::TextAlign::CENTER, 1.0f);
+      else if (status.status == gfx::Status::Normal && status.glyph)
+        gvm->text(&status.glyph, 1, x * cs + cs/2 + 1, y * cs + cs/4 + 1, status.solved ? SDL_Color{ 0, 160, 0 } : SDL_Color{ 0, 0, 0 }, ui::TextAlign::CENTER, 1.0f);
     }
+}
+
+void CrosswordRenderer::render(ViewManager* gvm)
+{
+  if (schemeStatus.update(grid))
+    gridLayer.invalidate();
+
+  const auto w = scheme.width();
+  const u64 layout = u64(w) | (u64(scheme.height()) << 16) | (u64(cs) << 32);
+
+  gridLayer.update(gvm, layout, [this, gvm]() { renderGrid(gvm); });
+  gridLayer.draw(gvm);
+
+  /* hint and cursors go over the cached grid */
+  gvm->nextLayer();
+
+  const auto& cell = grid.at(cursor.x, cursor.y);
+  const games::word_id word = cell.words[direction == games::Dir::Hor ? 0 : 1];
+
+  if (word != games::NO_WORD)
+  {
+    const auto& lines = hints[word];
+    for (size_t i = 0; i < lines.size(); ++i)
+      gvm->text(lines[i], margin.x + w * cs + 6, margin.y + 2 + i * 10, { 0, 0, 0 }, ui::TextAlign::LEFT, 1.0f);
+
+    if (assisting)
+      renderSuggestions(gvm, word, margin.y + 2 + (lines.size() + 1) * 10);
+  }
+
+  gvm->drawRect(margin.x + cs * cursor.x, margin.y + cs * cursor.y, cs+1, cs+1, grid.isSolved() ? color_t{ 0, 160, 0 } : color_t{ 0, 0, 220 });
 
   if (cellHover.x != -1)
     gvm->drawRect(margin.x + cs * cellHover.x, margin.y + cs * cellHover.y, cs+1, cs+1, { 255, 0, 0 });
@@ -119,12 +259,158 @@ void CrosswordRenderer::render(ViewManager* gvm)
 
 void CrosswordRenderer::mouseMoved(point_t p)
 {
-  auto x = (p.x - margin.x) / cs, y = (p.y - margin.y) / cs;
+  const s32 cell = cells.at(p);
+  const point_t previous = cellHover;
 
-  if (p.x >= margin.x && p.y >= margin.y && x >= 0 && x < scheme.width() && y >= 0 && y < scheme.height())
-  {
-    cellHover = { x, y };
-  }
+  if (cell != HitGrid::NONE)
+    cellHover = { cell % scheme.width(), cell / scheme.width() };
   else
     cellHover = { -1, -1 };
+
+  if (cellHover != previous)
+  {
+    if (previous.x != -1)
+      gvm->invalidate(cellRect(previous));
+    if (cellHover.x != -1)
+      gvm->invalidate(cellRect(cellHover));
+  }
+}
+
+void CrosswordRenderer::mouseButton(point_t p, MouseButton button, bool pressed)
+{
+  if (pressed && button == MouseButton::Left && cellHover.x != -1)
+  {
+    /* clicking the cursor again switches the direction of typing */
+    if (cellHover == cursor)
+      direction = direction == games::Dir::Hor ? games::Dir::Ver : games::Dir::Hor;
+    cursor = cellHover;
+  }
 }
+
+void CrosswordRenderer::moveCursor(coord_t dx, coord_t dy)
+{
+  point_t next = cursor + point_t(dx, dy);
+
+  if (grid.isValid(next.x, next.y))
+    cursor = next;
+}
+
+void CrosswordRenderer::gamepadButton(GamepadButton button, bool pressed)
+{
+  if (!pressed)
+    return;
+
+  switch (button)
+  {
+    case GamepadButton::DpadLeft: moveCursor(-1, 0); break;
+    case GamepadButton::DpadRight: moveCursor(+1, 0); break;
+    case GamepadButton::DpadUp: moveCursor(0, -1); break;
+    case GamepadButton::DpadDown: moveCursor(0, +1); break;
+    case GamepadButton::A: direction = direction == games::Dir::Hor ? games::Dir::Ver : games::Dir::Hor; break;
+    default: break;
+  }
+}
+
+void CrosswordRenderer::setCell(unicode_t letter)
+{
+  const s32 index = cursor.y * grid.width() + cursor.x;
+  const unicode_t previous = grid.at(index).letter;
+
+  if (!grid.set(cursor.x, cursor.y, letter))
+    return;
+
+  if (assisting)
+  {
+    assistant.update(grid, index, previous);
+    suggestionsStale = true;
+  }
+}
+
+void CrosswordRenderer::keyPressed(SDL_Keycode key)
+{
+  const coord_t dx = direction == games::Dir::Hor ? 1 : 0, dy = 1 - dx;
+
+  /* printable keycodes are the code point of the key, accented ones come from Latin-1 layouts */
+  const bool letter = (key >= SDLK_a && key <= SDLK_z) || (key >= 0xE0 && key <= 0xFE && key != 0xF7);
+
+  if (letter)
+  {
+    if (!grid.at(cursor.x, cursor.y).isBlocked())
+    {
+      setCell(unicode_t(key));
+      moveCursor(dx, dy);
+    }
+  }
+  else if (key == SDLK_BACKSPACE)
+  {
+    if (!grid.at(cursor.x, cursor.y).isFilled())
+      moveCursor(-dx, -dy);
+    setCell(0);
+  }
+}
+
+u32 CrosswordRenderer::schemeKey() const
+{
+  u32 key = 2166136261u;
+
+  for (s32 i = 0; i < grid.width() * grid.height(); ++i)
+    key = (key ^ grid.at(i).solution) * 16777619u;
+
+  return key;
+}
+
+void CrosswordRenderer::save(snapshot::Writer& out) const
+{
+  const size_t section = out.begin(snapshot::tag("XWRD"));
+
+  out.write(grid.width());
+  out.write(grid.height());
+  out.write(schemeKey());
+
+  for (s32 i = 0; i < grid.width() * grid.height(); ++i)
+    out.write(grid.at(i).letter);
+
+  out.write(cursor);
+  out.write(direction);
+
+  out.end(section);
+}
+
+bool CrosswordRenderer::restore(u32 tag, snapshot::Reader& in)
+{
+  coord_t w, h;
+  u32 key;
+
+  if (tag != snapshot::tag("XWRD") || !in.read(w) || !in.read(h) || !in.read(key) || w != grid.width() || h != grid.height() || key != schemeKey())
+    return false;
+
+  /* the whole section is read and checked before the grid is touched, a short one leaves the game as it was */
+  std::vector<unicode_t> letters(w * h);
+  for (unicode_t& letter : letters)
+    if (!in.read(letter))
+      return false;
+
+  point_t position;
+  std::underlying_type<games::Dir>::type orientation;
+
+  if (!in.read(position) || !in.read(orientation) || !grid.isValid(position.x, position.y))
+    return false;
+  else if (orientation != s32(games::Dir::Hor) && orientation != s32(games::Dir::Ver))
+    return false;
+
+  for (s32 y = 0; y < h; ++y)
+    for (s32 x = 0; x < w; ++x)
+      grid.set(x, y, letters[y * w + x]);
+
+  if (assisting)
+  {
+    assistant.reset(grid);
+    suggestionsStale = true;
+  }
+
+  cursor = position;
+  direction = games::Dir(orientation);
+  return true;
+}
+
+GameRenderer* ui::createCrosswordRenderer() { return new CrosswordRenderer(); }
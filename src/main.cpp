@@ -2,6 +2,7 @@
 #include <cstdlib>
 
 #include "gfx/ViewManager.h"
+#include "Trace.h"
 
 int main(int argc, char* argv[])
 {
@@ -17,9 +18,17 @@ int main(int argc, char* argv[])
     return -1;
   }
 
+  ui.resume();
+
   ui.loop();
+
+  ui.suspend();
   ui.deinit();
 
+  /* zones of the whole session, see Trace.h */
+  if (const char* file = getenv("ENIGMISTICA_TRACE"))
+    trace::write(file);
+
   //loader.load("1level.l");
 
   //getchar();
@@ -0,0 +1,265 @@
+/* builds assets.bin for the handheld: decodes the PNGs, packs them with the same
+   layout the game uses at runtime and stores the atlas in the texture format of
+   the renderer, so that startup only has to mmap it and upload it
+
+   usage: assetpack [--format argb8888|abgr8888] output.bin input.png...
+   build: c++ -std=c++11 -O2 -Isrc tools/assetpack.cpp -lz -o assetpack */
+
+#include "Common.h"
+#include "gfx/AssetBundle.h"
+
+#include <zlib.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace
+{
+  struct Bitmap
+  {
+    std::string name;
+    s32 w, h;
+    std::vector<u8> rgba;
+  };
+
+  u32 bigEndian(const u8* data) { return (u32(data[0]) << 24) | (u32(data[1]) << 16) | (u32(data[2]) << 8) | data[3]; }
+
+  u8 paeth(u8 a, u8 b, u8 c)
+  {
+    const s32 p = s32(a) + b - c, pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    return pa <= pb && pa <= pc ? a : (pb <= pc ? b : c);
+  }
+
+  /* 8 bit non interlaced grayscale, RGB and their alpha variants, which is what the art is saved as */
+  bool decodePng(const path& file, Bitmap& bitmap)
+  {
+    std::ifstream in(file, std::ios::binary);
+    const std::vector<u8> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    static const u8 signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    if (data.size() < 8 || memcmp(data.data(), signature, 8) != 0)
+    {
+      printf("%s: not a PNG\n", file.c_str());
+      return false;
+    }
+
+    u32 depth = 0, colorType = 0, interlace = 0;
+    std::vector<u8> compressed;
+
+    for (size_t i = 8; i + 12 <= data.size(); )
+    {
+      const u32 length = bigEndian(&data[i]);
+      const u8* type = &data[i + 4];
+      const u8* chunk = &data[i + 8];
+
+      if (i + 12 + length > data.size())
+        break;
+
+      if (!memcmp(type, "IHDR", 4))
+      {
+        bitmap.w = bigEndian(chunk);
+        bitmap.h = bigEndian(chunk + 4);
+        depth = chunk[8];
+        colorType = chunk[9];
+        interlace = chunk[12];
+      }
+      else if (!memcmp(type, "IDAT", 4))
+        compressed.insert(compressed.end(), chunk, chunk + length);
+      else if (!memcmp(type, "IEND", 4))
+        break;
+
+      i += 12 + length;
+    }
+
+    static const u32 channelsForType[] = { 1, 0, 3, 0, 2, 0, 4 };
+    const u32 channels = colorType < 7 ? channelsForType[colorType] : 0;
+
+    if (depth != 8 || !channels || interlace)
+    {
+      printf("%s: unsupported PNG (depth %u, color type %u, interlace %u)\n", file.c_str(), depth, colorType, interlace);
+      return false;
+    }
+
+    const size_t stride = bitmap.w * channels;
+    std::vector<u8> raw(bitmap.h * (stride + 1));
+    uLongf rawSize = raw.size();
+
+    if (uncompress(raw.data(), &rawSize, compressed.data(), compressed.size()) != Z_OK || rawSize != raw.size())
+    {
+      printf("%s: corrupted image data\n", file.c_str());
+      return false;
+    }
+
+    std::vector<u8> pixels(bitmap.h * stride);
+    const std::vector<u8> zero(stride, 0);
+
+    for (s32 y = 0; y < bitmap.h; ++y)
+    {
+      const u8 filter = raw[y * (stride + 1)];
+      const u8* src = &raw[y * (stride + 1) + 1];
+      u8* row = &pixels[y * stride];
+      const u8* up = y ? &pixels[(y - 1) * stride] : zero.data();
+
+      for (size_t x = 0; x < stride; ++x)
+      {
+        const u8 a = x >= channels ? row[x - channels] : 0, b = up[x], c = x >= channels ? up[x - channels] : 0;
+
+        switch (filter)
+        {
+          case 0: row[x] = src[x]; break;
+          case 1: row[x] = src[x] + a; break;
+          case 2: row[x] = src[x] + b; break;
+          case 3: row[x] = src[x] + ((a + b) >> 1); break;
+          case 4: row[x] = src[x] + paeth(a, b, c); break;
+          default:
+            printf("%s: invalid filter %u\n", file.c_str(), filter);
+            return false;
+        }
+      }
+    }
+
+    bitmap.rgba.resize(bitmap.w * bitmap.h * 4);
+
+    for (s32 i = 0; i < bitmap.w * bitmap.h; ++i)
+    {
+      const u8* p = &pixels[i * channels];
+      u8* q = &bitmap.rgba[i * 4];
+
+      switch (channels)
+      {
+        case 1: q[0] = q[1] = q[2] = p[0]; q[3] = 255; break;
+        case 2: q[0] = q[1] = q[2] = p[0]; q[3] = p[1]; break;
+        case 3: q[0] = p[0]; q[1] = p[1]; q[2] = p[2]; q[3] = 255; break;
+        case 4: memcpy(q, p, 4); break;
+      }
+    }
+
+    return true;
+  }
+
+  path baseName(const path& file)
+  {
+    const size_t slash = file.find_last_of("/\\");
+    return slash == path::npos ? file : file.substr(slash + 1);
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  bundle::PixelFormat format = bundle::PixelFormat::ARGB8888;
+  int arg = 1;
+
+  if (arg + 1 < argc && std::string(argv[arg]) == "--format")
+  {
+    const std::string name = argv[arg + 1];
+
+    if (name == "argb8888")
+      format = bundle::PixelFormat::ARGB8888;
+    else if (name == "abgr8888")
+      format = bundle::PixelFormat::ABGR8888;
+    else
+    {
+      printf("unknown format %s\n", name.c_str());
+      return -1;
+    }
+
+    arg += 2;
+  }
+
+  if (argc - arg < 2)
+  {
+    printf("usage: %s [--format argb8888|abgr8888] output.bin input.png...\n", argv[0]);
+    return -1;
+  }
+
+  const path output = argv[arg++];
+
+  std::vector<Bitmap> bitmaps;
+  std::vector<size2d_t> sizes;
+
+  for (; arg < argc; ++arg)
+  {
+    Bitmap bitmap;
+    bitmap.name = baseName(argv[arg]);
+
+    if (bitmap.name.size() >= sizeof(bundle::Entry::name))
+    {
+      printf("%s: name too long\n", argv[arg]);
+      return -1;
+    }
+
+    if (!decodePng(argv[arg], bitmap))
+      return -1;
+
+    sizes.push_back(size2d_t(bitmap.w, bitmap.h));
+    bitmaps.push_back(std::move(bitmap));
+  }
+
+  size2d_t sheet(0, 0);
+  const auto placements = bundle::pack(sizes, sheet);
+
+  bundle::Header header;
+  memcpy(header.magic, "ENAB", 4);
+  header.version = bundle::VERSION;
+  header.format = format;
+  header.width = sheet.w;
+  header.height = sheet.h;
+  header.pitch = sheet.w * 4;
+  header.images = bitmaps.size();
+
+  /* pixels aligned to 16 bytes, for whatever copies them into the texture */
+  header.pixels = (sizeof(bundle::Header) + sizeof(bundle::Entry) * bitmaps.size() + 15) & ~u64(15);
+
+  std::vector<bundle::Entry> entries(bitmaps.size());
+  std::vector<u8> atlas(header.pitch * sheet.h, 0);
+
+  for (size_t i = 0; i < bitmaps.size(); ++i)
+  {
+    const Bitmap& bitmap = bitmaps[i];
+    bundle::Entry& entry = entries[i];
+
+    memset(entry.name, 0, sizeof(entry.name));
+    memcpy(entry.name, bitmap.name.data(), bitmap.name.size());
+    entry.x = placements[i].x;
+    entry.y = placements[i].y;
+    entry.w = bitmap.w;
+    entry.h = bitmap.h;
+
+    for (s32 y = 0; y < bitmap.h; ++y)
+      for (s32 x = 0; x < bitmap.w; ++x)
+      {
+        const u8* p = &bitmap.rgba[(y * bitmap.w + x) * 4];
+        const u32 r = p[0], g = p[1], b = p[2], a = p[3];
+
+        /* both formats are packed 32 bit values, stored little endian */
+        const u32 value = format == bundle::PixelFormat::ARGB8888 ? (a << 24) | (r << 16) | (g << 8) | b : (a << 24) | (b << 16) | (g << 8) | r;
+
+        u8* q = &atlas[(entry.y + y) * header.pitch + (entry.x + x) * 4];
+        q[0] = value & 0xFF;
+        q[1] = (value >> 8) & 0xFF;
+        q[2] = (value >> 16) & 0xFF;
+        q[3] = value >> 24;
+      }
+  }
+
+  std::ofstream out(output, std::ios::binary);
+
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(entries.data()), sizeof(bundle::Entry) * entries.size());
+
+  const std::vector<char> padding(header.pixels - sizeof(header) - sizeof(bundle::Entry) * entries.size(), 0);
+  out.write(padding.data(), padding.size());
+  out.write(reinterpret_cast<const char*>(atlas.data()), atlas.size());
+
+  if (!out)
+  {
+    printf("error writing %s\n", output.c_str());
+    return -1;
+  }
+
+  printf("%s: %u images, %dx%d atlas, %u bytes\n", output.c_str(), header.images, sheet.w, sheet.h, u32(header.pixels + atlas.size()));
+  return 0;
+}
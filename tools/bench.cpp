@@ -0,0 +1,647 @@
+/* micro and macro benchmarks of the game code, neither the SDL libraries nor a
+   display are needed: every benchmark is calibrated to run for about the same
+   time per sample and is reported with the median and the spread over all the
+   samples, so that two runs can be told apart from noise; the crossword generator
+   is swept over 1..N threads to show how it scales. Whole frames are measured by
+   framebench, which writes the same kind of JSON
+
+   usage: enigmistica_bench [--filter text] [--samples N] [--no-sweep] [--json file] [--baseline file]
+   --baseline prints how each median changed against the --json output of an earlier run */
+
+#include "Common.h"
+#include "ThreadPool.h"
+#include "gfx/HitGrid.h"
+#include "gfx/TextLayout.h"
+#include "gfx/views/CrosswordStatus.h"
+
+#include "games/CrosswordAssistant.h"
+#include "games/CrosswordGenerator.h"
+#include "games/CrosswordGrid.h"
+#include "games/CrosswordPack.h"
+#include "games/CrosswordValidator.h"
+#include "games/Dictionary.h"
+#include "games/board/Chess.h"
+#include "games/board/ChessProblems.h"
+#include "games/board/Pgn.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace games;
+
+namespace
+{
+  using clock_type = std::chrono::steady_clock;
+
+  double seconds(clock_type::time_point start) { return std::chrono::duration<double>(clock_type::now() - start).count(); }
+
+  /* the compiler has to assume value is read, so the code computing it stays */
+  template<typename T> inline void keep(const T& value)
+  {
+#if defined(_MSC_VER)
+    static const void* volatile sink;
+    sink = &value;
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : "r"(&value) : "memory");
+#endif
+  }
+
+  struct Result
+  {
+    std::string name;
+    u64 iterations; // of each sample
+    std::vector<double> samples; // ns for each operation
+    double median, mean, stddev, min, max;
+  };
+
+  struct Scaling
+  {
+    u32 threads;
+    double seconds; // median of the rounds
+    u64 nodes;
+    u32 attempts;
+  };
+
+  class Suite
+  {
+  private:
+    static constexpr double SAMPLE_SECONDS = 0.02;
+
+    u32 _samples;
+    std::string _filter;
+    std::vector<Result> _results;
+
+    template<typename F> static double time(F& op, u64 iterations)
+    {
+      const auto start = clock_type::now();
+      for (u64 i = 0; i < iterations; ++i)
+        op();
+      return seconds(start);
+    }
+
+  public:
+    Suite(u32 samples, const std::string& filter) : _samples(samples), _filter(filter) { }
+
+    bool enabled(const std::string& name) const { return _filter.empty() || name.find(_filter) != std::string::npos; }
+
+    template<typename F> void run(const std::string& name, F op)
+    {
+      if (!enabled(name))
+        return;
+
+      /* doubles until a batch is long enough to scale from, which also warms caches up */
+      u64 iterations = 1;
+      double elapsed = time(op, iterations);
+
+      while (elapsed < SAMPLE_SECONDS / 10 && iterations < (u64(1) << 32))
+      {
+        iterations *= 2;
+        elapsed = time(op, iterations);
+      }
+
+      iterations = std::max<u64>(1, u64(iterations * SAMPLE_SECONDS / std::max(elapsed, 1e-9)));
+
+      Result result = { name, iterations, std::vector<double>(), 0, 0, 0, 0, 0 };
+
+      for (u32 i = 0; i < _samples; ++i)
+        result.samples.push_back(time(op, iterations) * 1e9 / iterations);
+
+      std::vector<double> sorted = result.samples;
+      std::sort(sorted.begin(), sorted.end());
+
+      result.median = sorted.size() % 2 ? sorted[sorted.size() / 2] : (sorted[sorted.size() / 2 - 1] + sorted[sorted.size() / 2]) / 2;
+      result.min = sorted.front();
+      result.max = sorted.back();
+
+      for (double sample : sorted)
+        result.mean += sample / sorted.size();
+
+      for (double sample : sorted)
+        result.stddev += (sample - result.mean) * (sample - result.mean) / std::max<size_t>(sorted.size() - 1, 1);
+      result.stddev = std::sqrt(result.stddev);
+
+      printf("%-44s %12.1f %7.1f%% %12.1f %10llu\n", name.c_str(), result.median, 100.0 * result.stddev / result.mean, result.min, (unsigned long long)iterations);
+      _results.push_back(result);
+    }
+
+    const std::vector<Result>& results() const { return _results; }
+  };
+
+  /* words over a few letters only, dense enough that any pattern has fills */
+  void synthesize(Dictionary& dictionary, u32 count, s32 maxLength, u64 seed)
+  {
+    static const char letters[] = "aeinorst";
+
+    std::mt19937_64 rng(seed);
+
+    for (u32 i = 0; i < count; ++i)
+    {
+      utf8_string word(2 + rng() % (maxLength - 1), ' ');
+      for (auto& c : word)
+        c = letters[rng() % (sizeof(letters) - 1)];
+      dictionary.add(word, "");
+    }
+
+    dictionary.build();
+  }
+
+  void bitsets(Suite& suite)
+  {
+    constexpr size_t BITS = 4096;
+
+    HeapBitSet<u64> bits;
+    bits.init(BITS);
+
+    suite.run("bitset/set+unset 4096", [&]() {
+      for (size_t i = 0; i < BITS; ++i)
+        bits.set(i);
+      keep(bits.data[BITS / 128]);
+      for (size_t i = 0; i < BITS; ++i)
+        bits.unset(i);
+      keep(bits.data[BITS / 128]);
+    });
+
+    for (size_t i = 0; i < BITS; i += 3)
+      bits.set(i);
+
+    suite.run("bitset/isSet 4096", [&]() {
+      u32 count = 0;
+      for (size_t i = 0; i < BITS; ++i)
+        count += bits.isSet(i);
+      keep(count);
+    });
+
+    suite.run("bitset/clear+fill 4096", [&]() {
+      bits.clear();
+      keep(bits.data[0]);
+      bits.fill();
+      keep(bits.data[0]);
+    });
+  }
+
+  void matching(Suite& suite, const Dictionary& dictionary)
+  {
+    static const char* patterns[] = { "a\0\0\0\0", "\0e\0s\0", "ra\0\0o", "\0\0\0\0\0" };
+
+    word_set set;
+    size_t index = 0;
+
+    suite.run("dictionary/match length 5", [&]() {
+      dictionary.match(patterns[index++ % 4], 5, set);
+      keep(set.data());
+    });
+
+    dictionary.match("\0e\0\0\0", 5, set);
+
+    suite.run("dictionary/count", [&]() {
+      size_t count = Dictionary::count(set);
+      keep(count);
+    });
+  }
+
+  void moves(Suite& suite)
+  {
+    using namespace games::chess;
+
+    static const std::pair<const char*, const char*> positions[] = {
+      { "start", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1" },
+      { "kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1" },
+    };
+
+    for (const auto& position : positions)
+    {
+      Chess game;
+      game.loadFen(position.second);
+
+      suite.run(std::string("chess/allowedMoves all pieces ") + position.first, [&]() {
+        size_t count = 0;
+        for (coord_t y = 0; y < 8; ++y)
+          for (coord_t x = 0; x < 8; ++x)
+          {
+            const Piece piece = game.get(point_t(x, y));
+            if (piece == game.currentPlayer().color)
+              count += game.allowedMoves(piece, point_t(x, y)).size();
+          }
+        keep(count);
+      });
+
+      suite.run(std::string("chess/allowedMoveSetForPlayer ") + position.first, [&]() {
+        auto set = game.allowedMoveSetForPlayer(game.currentPlayer());
+        keep(set);
+      });
+    }
+
+    /* random games written once and read back, SAN is resolved against the position */
+    std::mt19937 rng(1);
+    std::string text;
+
+    for (u32 g = 0; g < 50; ++g)
+    {
+      Chess game;
+      game.resetBoard();
+
+      for (u32 ply = 0; ply < 120; ++ply)
+      {
+        std::vector<Move> moves;
+        for (const auto& entry : game.allowedMoveSetForPlayer(game.currentPlayer()))
+          moves.insert(moves.end(), entry.second.begin(), entry.second.end());
+
+        if (moves.empty())
+          break;
+
+        game.play(moves[rng() % moves.size()]);
+      }
+
+      text += pgn::write(game, { { "Event", "bench" } }, "*");
+    }
+
+    suite.run("pgn/read 50 games", [&]() {
+      pgn::Reader reader(text.data(), text.size());
+      pgn::Game game;
+      size_t moves = 0;
+      while (reader.next(game))
+        moves += game.moves.size();
+      keep(moves);
+    });
+  }
+
+  /* from a cold table each time, the uniqueness of the key included */
+  void mates(Suite& suite)
+  {
+    using namespace games::chess;
+
+    static const problems::Problem pack[] = {
+      { "mate in 2", "kbK5/pp6/1P6/8/8/8/8/R7 w - - 0 1", 2 },
+      { "mate in 3", "r5nr/2p1k3/7R/1p5K/pP2P3/7P/P1P5/2b3NR b - - 0 25", 3 },
+    };
+
+    problems::Solver solver(1 << 16);
+
+    for (const problems::Problem& problem : pack)
+    {
+      Chess game;
+      game.loadFen(problem.fen);
+
+      suite.run("chess/" + problem.name + " df-pn", [&]() {
+        solver.clear();
+        const problems::Solution solution = solver.solve(game, problem.moves, ~u64(0));
+        keep(solution);
+      });
+    }
+  }
+
+  void crossword(Suite& suite, const CrosswordScheme& scheme)
+  {
+    CrosswordGrid grid(scheme);
+    gfx::CrosswordGfxStatus status(scheme.width(), scheme.height());
+
+    status.update(grid);
+
+    /* as typed: every open cell filled and then cleared, the view pulling changes after each key */
+    suite.run("crossword/type+update whole grid", [&]() {
+      for (s32 y = 0; y < grid.height(); ++y)
+        for (s32 x = 0; x < grid.width(); ++x)
+          if (!grid.at(x, y).isBlocked())
+          {
+            grid.set(x, y, grid.at(x, y).solution);
+            status.update(grid);
+          }
+
+      for (s32 y = 0; y < grid.height(); ++y)
+        for (s32 x = 0; x < grid.width(); ++x)
+          if (!grid.at(x, y).isBlocked())
+          {
+            grid.clear(x, y);
+            status.update(grid);
+          }
+
+      keep(status.at(0, 0));
+    });
+  }
+
+  /* a key typed in the middle of the grid and taken back, suggestions refreshed after each */
+  void assistant(Suite& suite, const Dictionary& dictionary, const CrosswordScheme& scheme)
+  {
+    CrosswordGrid grid(scheme);
+    CrosswordAssistant assistant(dictionary);
+    Suggestion suggestions[8];
+
+    assistant.reset(grid);
+
+    const s32 x = grid.width() / 2, y = grid.height() / 2;
+    const s32 index = y * grid.width() + x;
+    const word_id word = grid.at(index).words[0];
+
+    suite.run("crossword/assistant keystroke+suggest", [&]() {
+      grid.set(x, y, grid.at(index).solution);
+      assistant.update(grid, index, 0);
+      size_t count = assistant.suggest(grid, word, suggestions, 8);
+
+      grid.clear(x, y);
+      assistant.update(grid, index, grid.at(index).solution);
+      count += assistant.suggest(grid, word, suggestions, 8);
+
+      keep(count);
+    });
+  }
+
+  /* a pack as packlint checks it, written once to a file next to the binary and
+     mapped back; the median is the time per pack, packs per second its inverse */
+  void validation(Suite& suite, const Dictionary& dictionary, const CrosswordPattern& pattern)
+  {
+    if (!suite.enabled("crossword/validate"))
+      return;
+
+    const path file = "enigmistica_bench.pack";
+    CrosswordPackWriter writer;
+
+    for (u64 seed = 1; writer.size() < 256 && seed <= 1024; ++seed)
+    {
+      CrosswordScheme scheme(pattern.w, pattern.h);
+      CrosswordGenerator::Options options;
+      options.threads = 1;
+      options.seed = seed;
+
+      if (CrosswordGenerator(dictionary).generate(pattern, scheme, options))
+        writer.add(scheme);
+    }
+
+    CrosswordPack pack;
+    if (!writer.write(file) || !pack.open(file))
+      return;
+
+    ThreadPool pool;
+    const CrosswordValidator validator(&dictionary);
+
+    suite.run("crossword/validate pack of " + std::to_string(pack.size()), [&]() {
+      keep(validator.validate(pack, pool).size());
+    });
+
+    pack.close();
+    std::remove(file.c_str());
+  }
+
+  /* pointer motion over the crossword grid, a lookup for every pixel of a sweep across the screen */
+  void hitTest(Suite& suite)
+  {
+    ui::HitGrid cells;
+
+    for (s32 y = 0; y < 13; ++y)
+      for (s32 x = 0; x < 13; ++x)
+        cells.add(rect_t(1 + 14 * x, 1 + 14 * y, 14, 14));
+
+    cells.build();
+
+    suite.run("ui/hit-test 320 motion events", [&]() {
+      s32 found = 0;
+      for (coord_t x = 0; x < WIDTH; ++x)
+        found += cells.at(point_t(x, x * HEIGHT / WIDTH));
+      keep(found);
+    });
+  }
+
+  void text(Suite& suite)
+  {
+    const ui::FontMetrics metrics;
+    ui::TextLayoutCache cache;
+
+    const utf8_string line = "render   1.2   3.4   5.6   7.8";
+    const ui::glyph_string glyphs(line.begin(), line.end());
+
+    suite.run("text/layout cache hit", [&]() {
+      const ui::TextLayout& layout = cache.get(line, metrics, 1.0f, ui::TextAlign::LEFT);
+      keep(layout);
+    });
+
+    ui::TextLayout layout;
+
+    suite.run("text/layout build 30 glyphs", [&]() {
+      layout.build(glyphs.data(), glyphs.size(), metrics, 1.0f, ui::TextAlign::CENTER);
+      keep(layout);
+    });
+  }
+
+  /* the same set of fills searched with more and more threads, the median of a few rounds */
+  std::vector<Scaling> sweep(const Dictionary& dictionary, const CrosswordPattern& pattern)
+  {
+    constexpr u32 ROUNDS = 3, SCHEMES = 4;
+
+    std::vector<u32> threads;
+    for (u32 t = 1; t < ThreadPool::hardwareThreads(); t *= 2)
+      threads.push_back(t);
+    threads.push_back(u32(ThreadPool::hardwareThreads()));
+
+    std::vector<Scaling> results;
+
+    for (u32 count : threads)
+    {
+      std::vector<double> rounds;
+      Scaling scaling = { count, 0, 0, 0 };
+
+      for (u32 round = 0; round < ROUNDS; ++round)
+      {
+        CrosswordGenerator generator(dictionary);
+        const auto start = clock_type::now();
+
+        for (u32 s = 0; s < SCHEMES; ++s)
+        {
+          CrosswordGenerator::Options options;
+          options.threads = count;
+          options.seed = 1 + s;
+
+          CrosswordScheme scheme(pattern.w, pattern.h);
+          generator.generate(pattern, scheme, options);
+
+          scaling.nodes += generator.stats().nodes;
+          scaling.attempts += generator.stats().attempts;
+        }
+
+        rounds.push_back(seconds(start));
+      }
+
+      std::sort(rounds.begin(), rounds.end());
+      scaling.seconds = rounds[rounds.size() / 2];
+      scaling.nodes /= ROUNDS;
+      scaling.attempts /= ROUNDS;
+
+      printf("generator/%u threads %30s %9.3f s %6.2fx %12llu nodes %5u attempts\n", count, "", scaling.seconds,
+        results.empty() ? 1.0 : results.front().seconds / scaling.seconds, (unsigned long long)scaling.nodes, scaling.attempts);
+
+      results.push_back(scaling);
+    }
+
+    return results;
+  }
+
+  /* reads back the medians of an earlier run, which has one benchmark per line */
+  std::map<std::string, double> baseline(const char* file)
+  {
+    std::map<std::string, double> medians;
+    std::ifstream in(file);
+    std::string line;
+
+    while (std::getline(in, line))
+    {
+      const size_t name = line.find("\"name\":\""), median = line.find("\"median\":");
+
+      if (name != std::string::npos && median != std::string::npos)
+      {
+        const size_t end = line.find('"', name + 8);
+        medians[line.substr(name + 8, end - name - 8)] = atof(line.c_str() + median + 9);
+      }
+    }
+
+    return medians;
+  }
+
+  bool writeJson(const char* file, const std::vector<Result>& results, const std::vector<Scaling>& scaling)
+  {
+    FILE* out = fopen(file, "wb");
+    if (!out)
+      return false;
+
+#if defined(_MSC_VER)
+    const char* compiler = "msvc";
+#else
+    const char* compiler = __VERSION__;
+#endif
+
+    fprintf(out, "{\n\"compiler\":\"%s\",\n\"threads\":%u,\n\"unit\":\"ns\",\n\"benchmarks\":[\n", compiler, u32(ThreadPool::hardwareThreads()));
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+      const Result& r = results[i];
+      fprintf(out, "{\"name\":\"%s\",\"iterations\":%llu,\"samples\":%u,\"median\":%.3f,\"mean\":%.3f,\"stddev\":%.3f,\"min\":%.3f,\"max\":%.3f}%s\n",
+        r.name.c_str(), (unsigned long long)r.iterations, u32(r.samples.size()), r.median, r.mean, r.stddev, r.min, r.max, i + 1 < results.size() ? "," : "");
+    }
+
+    fprintf(out, "],\n\"scaling\":[\n");
+
+    for (size_t i = 0; i < scaling.size(); ++i)
+      fprintf(out, "{\"threads\":%u,\"seconds\":%.6f,\"nodes\":%llu,\"attempts\":%u}%s\n",
+        scaling[i].threads, scaling[i].seconds, (unsigned long long)scaling[i].nodes, scaling[i].attempts, i + 1 < scaling.size() ? "," : "");
+
+    fprintf(out, "]\n}\n");
+
+    return fclose(out) == 0;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  u32 samples = 15;
+  bool sweeping = true;
+  std::string filter;
+  const char* json = nullptr;
+  const char* previous = nullptr;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+
+    if (arg == "--filter" && i + 1 < argc)
+      filter = argv[++i];
+    else if (arg == "--samples" && i + 1 < argc)
+      samples = std::max(atoi(argv[++i]), 3);
+    else if (arg == "--no-sweep")
+      sweeping = false;
+    else if (arg == "--json" && i + 1 < argc)
+      json = argv[++i];
+    else if (arg == "--baseline" && i + 1 < argc)
+      previous = argv[++i];
+    else
+    {
+      printf("usage: %s [--filter text] [--samples N] [--no-sweep] [--json file] [--baseline file]\n", argv[0]);
+      return -1;
+    }
+  }
+
+  Dictionary words;
+  synthesize(words, 40000, 7, 1);
+
+  /* the scheme typed into by the crossword benchmark */
+  const CrosswordPattern pattern = CrosswordPattern::fromRows({
+    "....#..",
+    "...#...",
+    "..#....",
+    ".......",
+    "....#..",
+    "...#...",
+    "..#....",
+  });
+
+  CrosswordScheme scheme(pattern.w, pattern.h);
+  {
+    CrosswordGenerator::Options options;
+    options.seed = 1;
+    if (!CrosswordGenerator(words).generate(pattern, scheme, options))
+    {
+      printf("the benchmark pattern has no fill\n");
+      return -1;
+    }
+  }
+
+  printf("%-44s %12s %8s %12s %10s\n", "benchmark", "median ns", "stddev", "min ns", "iterations");
+
+  Suite suite(samples, filter);
+
+  bitsets(suite);
+  matching(suite, words);
+  moves(suite);
+  mates(suite);
+  crossword(suite, scheme);
+  assistant(suite, words, scheme);
+  validation(suite, words, pattern);
+  hitTest(suite);
+  text(suite);
+
+  std::vector<Scaling> scaling;
+  if (sweeping && suite.enabled("generator"))
+  {
+    /* sparse enough that some fills need restarts, about a second of search on one core */
+    Dictionary sparse;
+    synthesize(sparse, 5000, 9, 1);
+
+    scaling = sweep(sparse, CrosswordPattern::fromRows({
+      "....#....",
+      "...#.....",
+      "..#......",
+      ".........",
+      "....#....",
+      ".........",
+      "......#..",
+      ".....#...",
+      "....#....",
+    }));
+  }
+
+  if (previous)
+  {
+    const std::map<std::string, double> medians = baseline(previous);
+
+    printf("\n%-44s %12s %12s %8s\n", "against baseline", "before ns", "after ns", "change");
+
+    for (const Result& result : suite.results())
+    {
+      auto it = medians.find(result.name);
+      if (it != medians.end() && it->second > 0)
+        printf("%-44s %12.1f %12.1f %+7.1f%%\n", result.name.c_str(), it->second, result.median, 100.0 * (result.median - it->second) / it->second);
+    }
+  }
+
+  if (json && !writeJson(json, suite.results(), scaling))
+  {
+    printf("can't write %s\n", json);
+    return -1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,380 @@
+/* verifies a pack of chess problems before it ships: every problem is solved on a
+   pool thread with the proof-number solver of ChessProblems.h and reported with
+   its key, how many nodes it took and how long; the exit code is 1 unless every
+   problem is sound, that is it mates in time with exactly one first move
+
+   usage: chessproblems [--threads N] [--nodes N] [--alphabeta] pack.pgn...
+          chessproblems --verify
+   problems are PGN games with a FEN and a Stipulation tag like "#3", --alphabeta
+   solves each one again with a plain alpha-beta over the same move generator to
+   check the verdict and compare the time; --verify checks the move generation the
+   solver and the game rely on instead: perft counts of reference positions, SAN
+   of every move read back as the same move, illegal SAN and FEN rejected and
+   random games written to PGN and read back */
+
+#include "Common.h"
+#include "ThreadPool.h"
+
+#include "games/board/Chess.h"
+#include "games/board/ChessPosition.h"
+#include "games/board/ChessProblems.h"
+#include "games/board/Pgn.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace games;
+using namespace games::chess;
+using namespace games::chess::engine;
+
+namespace
+{
+  using clock_type = std::chrono::steady_clock;
+
+  double seconds(clock_type::time_point start) { return std::chrono::duration<double>(clock_type::now() - start).count(); }
+
+  /* the baseline: full width to the last ply, the only pruning is stopping at the
+     first refutation, which is all alpha-beta can do with a won or lost score */
+  bool mated(const Position& position, u32 plies, u64& nodes);
+
+  bool mates(const Position& position, u32 plies, u64& nodes)
+  {
+    move_t moves[MAX_MOVES];
+    const size_t count = position.generate(moves, false);
+    Position next;
+
+    ++nodes;
+
+    for (size_t i = 0; i < count; ++i)
+      if (position.play(moves[i], next) && mated(next, plies - 1, nodes))
+        return true;
+
+    return false;
+  }
+
+  bool mated(const Position& position, u32 plies, u64& nodes)
+  {
+    move_t moves[MAX_MOVES];
+    const size_t count = position.generate(moves, false);
+    Position next;
+    bool escapes = false;
+
+    ++nodes;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      if (!position.play(moves[i], next))
+        continue;
+
+      escapes = true;
+      if (plies == 0 || !mates(next, plies - 1, nodes))
+        return false;
+    }
+
+    return escapes || position.inCheck();
+  }
+
+  struct Baseline
+  {
+    size_t keys;
+    u64 nodes;
+    double seconds;
+  };
+
+  Baseline alphaBeta(const problems::Problem& problem)
+  {
+    const auto start = clock_type::now();
+    Baseline baseline = { 0, 0, 0.0 };
+
+    Chess game;
+    if (problem.moves == 0 || !game.loadFen(problem.fen))
+      return baseline;
+
+    const Position position = fromGame(game);
+    move_t moves[MAX_MOVES];
+    const size_t count = position.generate(moves, false);
+    Position next;
+
+    for (size_t i = 0; i < count; ++i)
+      if (position.play(moves[i], next) && mated(next, 2 * problem.moves - 2, baseline.nodes))
+        ++baseline.keys;
+
+    baseline.seconds = seconds(start);
+    return baseline;
+  }
+
+  std::string keys(const problems::Problem& problem, const problems::Solution& solution)
+  {
+    Chess game;
+    std::string text;
+
+    if (!game.loadFen(problem.fen))
+      return text;
+
+    for (const Move& move : solution.keys)
+      text += (text.empty() ? "" : " ") + game.san(move);
+
+    return text.empty() ? "-" : text;
+  }
+
+  /* the legal moves as the game offers them to the UI, not through the engine's generator */
+  std::vector<Move> legalMoves(Chess& game)
+  {
+    std::vector<Move> moves;
+
+    for (coord_t y = 0; y < 8; ++y)
+      for (coord_t x = 0; x < 8; ++x)
+      {
+        const Piece piece = game.get({ x, y });
+
+        if (piece.present && piece.color == game.currentPlayer().color)
+          for (const Move& move : game.allowedMoves(piece, { x, y }))
+            moves.push_back(move);
+      }
+
+    return moves;
+  }
+
+  /* leaf count of the legal move tree, every move of the first plies is also read back from its SAN */
+  u64 perft(Chess& game, u32 depth, u32 sanDepth, size_t& sanFailures)
+  {
+    if (depth == 0)
+      return 1;
+
+    u64 nodes = 0;
+
+    for (const Move& move : legalMoves(game))
+    {
+      if (sanDepth)
+      {
+        const std::string san = game.san(move);
+        Move parsed(point_t(-1, -1), point_t(-1, -1));
+
+        if (!game.parseSan(san.data(), san.size(), parsed) || !(parsed == move))
+        {
+          if (++sanFailures <= 8)
+            printf("  %s doesn't read back in %s\n", san.c_str(), game.fen().c_str());
+        }
+      }
+
+      Chess next = game;
+      next.play(move);
+      nodes += perft(next, depth - 1, sanDepth ? sanDepth - 1 : 0, sanFailures);
+    }
+
+    return nodes;
+  }
+
+  int verify()
+  {
+    struct Perft
+    {
+      const char* fen;
+      u64 nodes[3];
+    };
+
+    /* the usual perft suite, the last one is all promotions */
+    const Perft positions[] = {
+      { "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", { 20, 400, 8902 } },
+      { "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", { 48, 2039, 97862 } },
+      { "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", { 6, 264, 9467 } },
+      { "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", { 44, 1486, 62379 } },
+      { "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1", { 24, 496, 9483 } },
+    };
+
+    /* a pinned piece, a pinned pawn, en passant uncovering the king and the king walking into check */
+    const std::pair<const char*, const char*> illegal[] = {
+      { "4k3/4r3/8/8/8/8/4N3/4K3 w - - 0 1", "Nc3" },
+      { "4k3/8/8/b7/8/8/3P4/4K3 w - - 0 1", "d3" },
+      { "4k3/4r3/8/8/8/3p4/4P3/4K3 w - - 0 1", "exd3" },
+      { "8/8/8/K2pP2r/8/8/8/4k3 w - d6 0 1", "exd6" },
+      { "4k3/8/8/8/8/8/3r4/4K3 w - - 0 1", "Kf2" },
+    };
+
+    /* pawns on the back ranks, the side not to move in check, en passant on the wrong rank */
+    const char* invalid[] = {
+      "P3k3/8/8/8/8/8/8/4K3 w - - 0 1",
+      "4k3/8/8/8/8/8/8/4K2p w - - 0 1",
+      "4k3/8/8/8/8/8/8/4R1K1 w - - 0 1",
+      "4k3/8/8/3pP3/8/8/8/4K3 w - d3 0 1",
+    };
+
+    size_t failures = 0, sanFailures = 0;
+
+    for (const Perft& position : positions)
+    {
+      Chess game;
+      if (!game.loadFen(position.fen))
+      {
+        printf("perft: can't load %s\n", position.fen);
+        ++failures;
+        continue;
+      }
+
+      printf("perft");
+      for (u32 depth = 1; depth <= 3; ++depth)
+      {
+        const u64 nodes = perft(game, depth, depth == 3 ? 2 : 0, sanFailures);
+        printf(" %llu%s", (unsigned long long)nodes, nodes == position.nodes[depth - 1] ? "" : "!");
+        failures += nodes == position.nodes[depth - 1] ? 0 : 1;
+      }
+      printf("  %s\n", position.fen);
+    }
+
+    printf("san: %u moves don't read back\n", u32(sanFailures));
+    failures += sanFailures;
+
+    for (const auto& test : illegal)
+    {
+      Chess game;
+      Move move(point_t(-1, -1), point_t(-1, -1));
+      const bool parsed = game.loadFen(test.first) && game.parseSan(test.second, strlen(test.second), move);
+
+      printf("illegal san %s %s in %s\n", test.second, parsed ? "ACCEPTED" : "rejected", test.first);
+      failures += parsed ? 1 : 0;
+    }
+
+    for (const char* fen : invalid)
+    {
+      Chess game;
+      const bool loaded = game.loadFen(fen);
+
+      printf("invalid fen %s %s\n", loaded ? "ACCEPTED" : "rejected", fen);
+      failures += loaded ? 1 : 0;
+    }
+
+    /* random games, promotions to any piece included, have to come back from their PGN as they were written */
+    std::mt19937 random(1);
+    std::string written;
+    size_t games = 0;
+
+    for (; games < 200; ++games)
+    {
+      Chess game;
+      game.resetBoard();
+
+      for (u32 ply = 0; ply < 200; ++ply)
+      {
+        const std::vector<Move> moves = legalMoves(game);
+        if (moves.empty())
+          break;
+
+        game.play(moves[random() % moves.size()]);
+      }
+
+      written += pgn::write(game, { { "Event", "verify" } }, "*");
+    }
+
+    pgn::Reader reader(written.data(), written.size());
+    pgn::Game game;
+    std::string read;
+    size_t count = 0, broken = 0;
+
+    while (reader.next(game))
+    {
+      ++count;
+      broken += game.valid ? 0 : 1;
+      read += pgn::write(game.position, { { "Event", "verify" } }, game.result.str());
+    }
+
+    const bool same = count == games && broken == 0 && read == written;
+    printf("pgn: %u of %u games read back, %u broken, text %s\n", u32(count), u32(games), u32(broken), read == written ? "identical" : "DIFFERS");
+    failures += same ? 0 : 1;
+
+    printf("\n%u failures\n", u32(failures));
+    return failures ? 1 : 0;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  size_t threads = 0;
+  u64 budget = 5000000;
+  bool baseline = false;
+  std::vector<problems::Problem> pack;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+      threads = strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--nodes") && i + 1 < argc)
+      budget = strtoull(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--alphabeta"))
+      baseline = true;
+    else if (!strcmp(argv[i], "--verify"))
+      return verify();
+    else
+    {
+      std::ifstream in(argv[i], std::ios::binary);
+      std::stringstream text;
+
+      if (!in)
+      {
+        fprintf(stderr, "chessproblems: can't open %s\n", argv[i]);
+        return 2;
+      }
+
+      text << in.rdbuf();
+      const std::string data = text.str();
+      const std::vector<problems::Problem> problems = problems::read(data.data(), data.size());
+      pack.insert(pack.end(), problems.begin(), problems.end());
+    }
+  }
+
+  if (pack.empty())
+  {
+    fprintf(stderr, "usage: chessproblems [--threads N] [--nodes N] [--alphabeta] pack.pgn...\n       chessproblems --verify\n");
+    return 2;
+  }
+
+  ThreadPool pool(threads);
+
+  const auto start = clock_type::now();
+  const std::vector<problems::Solution> solutions = problems::solve(pack, pool, budget);
+  const double wall = seconds(start);
+
+  double total = 0.0, totalBaseline = 0.0;
+  size_t sound = 0, mismatches = 0;
+
+  printf("%-32s %4s  %-8s  %-16s %10s %10s", "problem", "", "verdict", "keys", "nodes", "ms");
+  if (baseline)
+    printf(" %12s %10s", "ab nodes", "ab ms");
+  printf("\n");
+
+  for (size_t i = 0; i < pack.size(); ++i)
+  {
+    const problems::Problem& problem = pack[i];
+    const problems::Solution& solution = solutions[i];
+
+    printf("%-32.32s  #%-2u  %-8s  %-16s %10llu %10.2f", problem.name.c_str(), problem.moves, problems::name(solution.verdict),
+      keys(problem, solution).c_str(), (unsigned long long)solution.nodes, solution.seconds * 1000.0);
+
+    if (baseline && solution.verdict != problems::Solution::Verdict::Unsolved && solution.verdict != problems::Solution::Verdict::Invalid)
+    {
+      const Baseline reference = alphaBeta(problem);
+      const bool agrees = reference.keys == solution.keys.size();
+
+      printf(" %12llu %10.2f%s", (unsigned long long)reference.nodes, reference.seconds * 1000.0, agrees ? "" : "  MISMATCH");
+      totalBaseline += reference.seconds;
+      mismatches += agrees ? 0 : 1;
+    }
+
+    printf("\n");
+
+    total += solution.seconds;
+    sound += solution.verdict == problems::Solution::Verdict::Sound ? 1 : 0;
+  }
+
+  printf("\n%u of %u sound, %.1f ms of solving in %.1f ms on %u threads\n", u32(sound), u32(pack.size()), total * 1000.0, wall * 1000.0, u32(pool.size()));
+  if (baseline)
+    printf("alpha-beta: %.1f ms, %u verdicts differ\n", totalBaseline * 1000.0, u32(mismatches));
+
+  return sound == pack.size() && mismatches == 0 ? 0 : 1;
+}
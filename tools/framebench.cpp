@@ -0,0 +1,282 @@
+/* replays scripted input on each renderer in a headless software renderer and
+   reports how long frames take to draw and how many draw calls they need,
+   optionally dumping reference images of marked frames
+
+   usage: framebench [--repeat N] [--full] [--framebuffer] [--dump directory] [--trace file.json] [--json file]
+   --framebuffer draws with SoftwareRenderer instead of SDL_Renderer, running it
+   both ways with --dump compares the two paths, --trace writes the zones of the
+   run as Chrome trace JSON and --json the table, laid out like the output of
+   enigmistica_bench so that runs can be compared the same way; run it from the
+   directory holding assets.bin or the PNGs, no display is needed */
+
+#include "gfx/ViewManager.h"
+#include "gfx/MainView.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace ui;
+
+namespace
+{
+  enum class Input { None, Key, Motion, Click };
+
+  struct Step
+  {
+    Input input;
+    s32 a, b; // key or coordinates
+    const char* dump; // name of the reference image taken after the step
+  };
+
+  struct Scene
+  {
+    const char* name;
+    GameRenderer* (*create)();
+    bool keyboard; // KeyboardView pushed over the game
+    std::vector<Step> script;
+  };
+
+  Step key(SDL_Keycode sym, const char* dump = nullptr) { return { Input::Key, s32(sym), 0, dump }; }
+  Step motion(s32 x, s32 y, const char* dump = nullptr) { return { Input::Motion, x, y, dump }; }
+  Step click(s32 x, s32 y, const char* dump = nullptr) { return { Input::Click, x, y, dump }; }
+  Step idle(const char* dump = nullptr) { return { Input::None, 0, 0, dump }; }
+
+  /* ends where it started so that repeating it draws the same frames */
+  std::vector<Step> boardScript()
+  {
+    return {
+      idle("initial"),
+      key(SDLK_RIGHT), key(SDLK_RIGHT), key(SDLK_DOWN), key(SDLK_DOWN, "cursor"),
+      key(SDLK_LCTRL, "held"), key(SDLK_UP), key(SDLK_UP, "dragged"), key(SDLK_LCTRL, "dropped"),
+      key(SDLK_LEFT), key(SDLK_LEFT),
+      motion(60, 60), motion(90, 60), motion(120, 90), motion(150, 120)
+    };
+  }
+
+  std::vector<Step> crosswordScript()
+  {
+    return {
+      idle("initial"),
+      key('c'), key('a'), key('s'), key('s'), key('e', "typed"),
+      key(SDLK_BACKSPACE), key(SDLK_BACKSPACE), key(SDLK_BACKSPACE), key(SDLK_BACKSPACE), key(SDLK_BACKSPACE),
+      key(SDLK_LCTRL, "vertical"), key(SDLK_DOWN), key(SDLK_UP), key(SDLK_LCTRL),
+      motion(20, 20), motion(40, 20), motion(40, 40)
+    };
+  }
+
+  std::vector<Step> keyboardScript()
+  {
+    return {
+      idle("initial"),
+      motion(30, 140), motion(50, 140, "hover"), motion(70, 160), motion(90, 180), motion(200, 30)
+    };
+  }
+
+  SDL_Event event(const Step& step, bool pressed)
+  {
+    SDL_Event event;
+    memset(&event, 0, sizeof(event));
+
+    switch (step.input)
+    {
+      case Input::Key:
+        event.type = pressed ? SDL_KEYDOWN : SDL_KEYUP;
+        event.key.keysym.sym = step.a;
+        break;
+      case Input::Motion:
+        event.type = SDL_MOUSEMOTION;
+        event.motion.x = step.a;
+        event.motion.y = step.b;
+        break;
+      case Input::Click:
+        event.type = pressed ? SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP;
+        event.button.button = SDL_BUTTON_LEFT;
+        event.button.x = step.a;
+        event.button.y = step.b;
+        break;
+      case Input::None:
+        break;
+    }
+
+    return event;
+  }
+
+  struct Measure
+  {
+    float wall; // ms spent recording and flushing the frame
+    float cpu; // ms of process time for the same
+    u32 drawCalls;
+    u32 primitives;
+    u32 allocations; // operator new calls while drawing
+    bool warm; // after the first run of the script, caches are filled
+  };
+
+  float percentile(std::vector<float> values, float p)
+  {
+    if (values.empty())
+      return 0.0f;
+
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, size_t(p * values.size()))];
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  u32 repeat = 20;
+  bool full = false;
+  bool framebuffer = false;
+  const char* dump = nullptr;
+  const char* traceFile = nullptr;
+  const char* jsonFile = nullptr;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+
+    if (arg == "--repeat" && i + 1 < argc)
+      repeat = std::max(atoi(argv[++i]), 1);
+    else if (arg == "--full")
+      full = true;
+    else if (arg == "--framebuffer")
+      framebuffer = true;
+    else if (arg == "--dump" && i + 1 < argc)
+      dump = argv[++i];
+    else if (arg == "--trace" && i + 1 < argc)
+      traceFile = argv[++i];
+    else if (arg == "--json" && i + 1 < argc)
+      jsonFile = argv[++i];
+    else
+    {
+      printf("usage: %s [--repeat N] [--full] [--framebuffer] [--dump directory] [--trace file.json] [--json file]\n", argv[0]);
+      return -1;
+    }
+  }
+
+  ViewManager ui;
+  ui.setSoftwareFramebuffer(framebuffer);
+
+  if (!ui.init(true))
+    return -1;
+
+  if (!ui.loadData())
+  {
+    printf("Error while loading and initializing data.\n");
+    ui.deinit();
+    return -1;
+  }
+
+  const std::vector<Scene> scenes = {
+    { "chess", createChessRenderer, false, boardScript() },
+    { "checkers", createCheckersRenderer, false, boardScript() },
+    { "crossword", createCrosswordRenderer, false, crosswordScript() },
+    { "keyboard", createChessRenderer, true, keyboardScript() }
+  };
+
+  KeyboardView keyboard(&ui);
+  bool success = true;
+  std::string json;
+
+  printf("%-10s %6s %8s %8s %8s %8s %8s %8s %8s\n", "scene", "frames", "p50 ms", "p95 ms", "max ms", "cpu ms", "calls", "prims", "allocs");
+
+  for (const Scene& scene : scenes)
+  {
+    /* the view doesn't own its renderer, this one lives as long as the scene */
+    std::unique_ptr<GameRenderer> renderer(scene.create());
+    MainView view(&ui, renderer.get());
+
+    ui.change(&view);
+    if (scene.keyboard)
+      ui.push(&keyboard);
+
+    std::vector<Measure> measures;
+
+    for (u32 r = 0; r < repeat; ++r)
+    {
+      for (const Step& step : scene.script)
+      {
+        if (step.input == Input::Key)
+        {
+          ui.handleKeyboardEvent(event(step, true));
+          ui.handleKeyboardEvent(event(step, false));
+        }
+        /* straight to the views, the loop drops mouse events on the handheld */
+        else if (step.input == Input::Click)
+        {
+          ui.handleMouseEvent(event(step, true));
+          ui.handleMouseEvent(event(step, false));
+        }
+        else if (step.input == Input::Motion)
+          ui.handleMouseEvent(event(step, true));
+
+        if (full || (r == 0 && step.dump))
+          ui.invalidate();
+
+        const std::clock_t cpu = std::clock();
+
+        if (ui.update())
+        {
+          const float cpuMs = 1000.0f * (std::clock() - cpu) / CLOCKS_PER_SEC;
+          measures.push_back({ ui.lastSample()[FrameStats::Render], cpuMs, ui.renderStats().drawCalls, ui.renderStats().primitives, ui.lastFrameAllocations(), r > 0 });
+        }
+
+        if (r == 0 && step.dump && dump)
+        {
+          char file[256];
+          snprintf(file, sizeof(file), "%s/%s_%s.bmp", dump, scene.name, step.dump);
+          success = ui.screenshot(file) && success;
+        }
+      }
+    }
+
+    if (scene.keyboard)
+      ui.pop();
+
+    std::vector<float> wall;
+    double cpu = 0.0, calls = 0.0, primitives = 0.0;
+    u32 allocations = 0;
+
+    for (const Measure& m : measures)
+    {
+      wall.push_back(m.wall);
+      cpu += m.cpu;
+      if (m.warm)
+        allocations = std::max(allocations, m.allocations);
+      calls += m.drawCalls;
+      primitives += m.primitives;
+    }
+
+    const double frames = std::max<double>(measures.size(), 1.0);
+
+    /* the worst frame once caches are warm, anything but 0 is an allocation to chase */
+    printf("%-10s %6u %8.3f %8.3f %8.3f %8.3f %8.1f %8.1f %8u\n", scene.name, u32(measures.size()),
+      percentile(wall, 0.50f), percentile(wall, 0.95f), percentile(wall, 1.0f), cpu / frames, calls / frames, primitives / frames, allocations);
+
+    char line[320];
+    snprintf(line, sizeof(line), "%s{\"name\":\"frame/%s\",\"frames\":%u,\"median\":%.4f,\"p95\":%.4f,\"max\":%.4f,\"cpu\":%.4f,\"calls\":%.1f,\"primitives\":%.1f,\"allocations\":%u}",
+      json.empty() ? "" : ",\n", scene.name, u32(measures.size()), percentile(wall, 0.50f), percentile(wall, 0.95f), percentile(wall, 1.0f), cpu / frames, calls / frames, primitives / frames, allocations);
+    json += line;
+  }
+
+  ui.deinit();
+
+  if (traceFile)
+    success = trace::write(traceFile) && success;
+
+  if (jsonFile)
+  {
+    FILE* out = fopen(jsonFile, "wb");
+    success = out && fprintf(out, "{\n\"renderer\":\"%s\",\n\"unit\":\"ms\",\n\"benchmarks\":[\n%s\n]\n}\n", framebuffer ? "framebuffer" : "sdl", json.c_str()) > 0 && success;
+    if (out)
+      success = fclose(out) == 0 && success;
+  }
+
+  return success ? 0 : -1;
+}
@@ -0,0 +1,207 @@
+/* checks crossword packs before they are published: every scheme of every pack is
+   validated on the pool by CrosswordValidator, errors are printed and the whole
+   report can be written as JSON for whatever builds the packs; the exit code is 1
+   if any scheme has an error, warnings alone don't fail a pack
+
+   usage: packlint [--dictionary words.txt] [--threads N] [--warnings] [--json report.json] pack.bin...
+   the dictionary is read as the game reads it, with answers missing from it
+   reported as warnings; --warnings prints those too and not only the errors */
+
+#include "Common.h"
+#include "ThreadPool.h"
+
+#include "games/CrosswordPack.h"
+#include "games/CrosswordValidator.h"
+#include "games/Dictionary.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace games;
+
+namespace
+{
+  using clock_type = std::chrono::steady_clock;
+
+  double seconds(clock_type::time_point start) { return std::chrono::duration<double>(clock_type::now() - start).count(); }
+
+  struct Result
+  {
+    std::string path;
+    u32 schemes;
+    double seconds;
+    std::vector<CrosswordReport> reports;
+  };
+
+  std::string escape(const std::string& text)
+  {
+    std::string escaped;
+
+    for (char c : text)
+    {
+      if (c == '"' || c == '\\')
+        escaped += std::string("\\") + c;
+      else if (u8(c) < 0x20)
+      {
+        char code[8];
+        snprintf(code, sizeof(code), "\\u%04x", u8(c));
+        escaped += code;
+      }
+      else
+        escaped += c;
+    }
+
+    return escaped;
+  }
+
+  /* only the schemes with issues are listed, a clean pack is just its counts */
+  bool writeJson(const char* path, const std::vector<Result>& results)
+  {
+    FILE* out = fopen(path, "w");
+    if (!out)
+      return false;
+
+    fprintf(out, "{\n  \"packs\": [");
+
+    for (size_t p = 0; p < results.size(); ++p)
+    {
+      const Result& result = results[p];
+      size_t errors = 0, warnings = 0;
+
+      for (const CrosswordReport& report : result.reports)
+      {
+        errors += report.errors();
+        warnings += report.warnings();
+      }
+
+      fprintf(out, "%s\n    { \"path\": \"%s\", \"schemes\": %u, \"errors\": %u, \"warnings\": %u, \"seconds\": %.6f, \"schemesPerSecond\": %.1f, \"reports\": [",
+        p ? "," : "", escape(result.path).c_str(), result.schemes, u32(errors), u32(warnings), result.seconds,
+        result.seconds > 0 ? result.schemes / result.seconds : 0.0);
+
+      bool first = true;
+      for (const CrosswordReport& report : result.reports)
+      {
+        if (report.issues.empty())
+          continue;
+
+        fprintf(out, "%s\n      { \"scheme\": %u, \"issues\": [", first ? "" : ",", report.scheme);
+        first = false;
+
+        for (size_t i = 0; i < report.issues.size(); ++i)
+        {
+          const CrosswordIssue& issue = report.issues[i];
+
+          fprintf(out, "%s\n        { \"kind\": \"%s\", \"severity\": \"%s\", \"word\": %d, \"x\": %d, \"y\": %d, \"detail\": \"%s\" }",
+            i ? "," : "", CrosswordValidator::name(issue.kind), issue.error ? "error" : "warning", issue.word, issue.cell.x, issue.cell.y,
+            escape(issue.detail).c_str());
+        }
+
+        fprintf(out, "\n      ] }");
+      }
+
+      fprintf(out, "\n    ] }");
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+    return fclose(out) == 0;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  size_t threads = 0;
+  bool verbose = false;
+  const char* json = nullptr;
+  const char* words = nullptr;
+  std::vector<std::string> paths;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+      threads = strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--dictionary") && i + 1 < argc)
+      words = argv[++i];
+    else if (!strcmp(argv[i], "--json") && i + 1 < argc)
+      json = argv[++i];
+    else if (!strcmp(argv[i], "--warnings"))
+      verbose = true;
+    else
+      paths.push_back(argv[i]);
+  }
+
+  if (paths.empty())
+  {
+    fprintf(stderr, "usage: packlint [--dictionary words.txt] [--threads N] [--warnings] [--json report.json] pack.bin...\n");
+    return 2;
+  }
+
+  Dictionary dictionary;
+  if (words)
+  {
+    if (!dictionary.load(words))
+    {
+      fprintf(stderr, "packlint: can't read %s\n", words);
+      return 2;
+    }
+
+    dictionary.build();
+  }
+
+  ThreadPool pool(threads);
+  const CrosswordValidator validator(words ? &dictionary : nullptr);
+
+  std::vector<Result> results;
+  size_t schemes = 0, failed = 0;
+  const auto start = clock_type::now();
+
+  for (const std::string& path : paths)
+  {
+    CrosswordPack pack;
+
+    if (!pack.open(path))
+    {
+      fprintf(stderr, "packlint: can't open %s\n", path.c_str());
+      return 2;
+    }
+
+    const auto opened = clock_type::now();
+    Result result = { path, pack.size(), 0.0, validator.validate(pack, pool) };
+    result.seconds = seconds(opened);
+
+    size_t errors = 0, warnings = 0;
+
+    for (const CrosswordReport& report : result.reports)
+    {
+      for (const CrosswordIssue& issue : report.issues)
+        if (issue.error || verbose)
+          printf("%s:%u: %s %s, word %d at %d,%d: %s\n", path.c_str(), report.scheme, issue.error ? "error" : "warning",
+            CrosswordValidator::name(issue.kind), issue.word, issue.cell.x, issue.cell.y, issue.detail.c_str());
+
+      errors += report.errors();
+      warnings += report.warnings();
+      failed += report.errors() ? 1 : 0;
+    }
+
+    printf("%s: %u schemes, %u errors, %u warnings in %.1f ms, %.0f schemes/s\n", path.c_str(), result.schemes, u32(errors), u32(warnings),
+      result.seconds * 1000.0, result.seconds > 0 ? result.schemes / result.seconds : 0.0);
+
+    schemes += result.schemes;
+    results.push_back(std::move(result));
+  }
+
+  const double wall = seconds(start);
+  printf("\n%u packs, %u of %u schemes failed, %.1f ms on %u threads, %.1f packs/s\n", u32(results.size()), u32(failed), u32(schemes),
+    wall * 1000.0, u32(pool.size()), wall > 0 ? results.size() / wall : 0.0);
+
+  if (json && !writeJson(json, results))
+  {
+    fprintf(stderr, "packlint: can't write %s\n", json);
+    return 2;
+  }
+
+  return failed ? 1 : 0;
+}